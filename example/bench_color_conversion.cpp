@@ -0,0 +1,183 @@
+// YUV 4:2:0 -> BGR / RGB / gray conversion speed and correctness, no device needed.
+//
+//   bench_color_conversion [frames]
+//
+// First every layout, format and downscale combination is compared to a
+// scalar reference with the same 6-bit coefficients, on a width that leaves
+// a SIMD tail and a padded stride. The SSE2 / NEON path must match it
+// exactly, returns 1 otherwise. Then 1080p and 4K frames are converted on
+// 1 thread and on the parallel_for pool.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "depthai/color_conversion.hpp"
+#include "depthai/parallel_for.hpp"
+
+
+using Clock = std::chrono::steady_clock;
+
+
+static double average_ms(int frames, const std::function<void()> &run)
+{
+    run();
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        run();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / frames;
+}
+
+static uint8_t clamp_u8(int value)
+{
+    return (uint8_t) std::min(255, std::max(0, value));
+}
+
+// BT.601 limited range, same coefficients and rounding as convert_yuv420()
+static void reference_pixel(int y, int u, int v, PixelFormat format, uint8_t *dst)
+{
+    const int luma = (y - 16) * 74 + 32;
+    u -= 128;
+    v -= 128;
+    const uint8_t r = clamp_u8((luma + 102 * v) >> 6);
+    const uint8_t g = clamp_u8((luma - 52 * v - 25 * u) >> 6);
+    const uint8_t b = clamp_u8((luma + 129 * u) >> 6);
+    dst[0] = format == PixelFormat::RGB ? r : b;
+    dst[1] = g;
+    dst[2] = format == PixelFormat::RGB ? b : r;
+}
+
+static void reference_convert(const uint8_t *yuv, YuvLayout layout, int width, int height, int stride,
+    uint8_t *dst, PixelFormat format, bool downscale)
+{
+    const uint8_t *chroma = yuv + stride * height;
+    const int channels = get_pixel_format_channels(format);
+    const int out_width = downscale ? width / 2 : width;
+    const int out_height = downscale ? height / 2 : height;
+
+    for (int oy = 0; oy < out_height; oy++)
+    {
+        for (int ox = 0; ox < out_width; ox++)
+        {
+            int y;
+            if (downscale)
+            {
+                const uint8_t *p = &yuv[2 * oy * stride + 2 * ox];
+                y = (p[0] + p[1] + p[stride] + p[stride + 1] + 2) >> 2;
+            }
+            else
+            {
+                y = yuv[oy * stride + ox];
+            }
+
+            uint8_t *out = &dst[(oy * out_width + ox) * channels];
+            if (format == PixelFormat::GRAY)
+            {
+                out[0] = (uint8_t) y;
+                continue;
+            }
+
+            const int cx = downscale ? ox : ox / 2;
+            const int cy = downscale ? oy : oy / 2;
+            int u;
+            int v;
+            if (layout == YuvLayout::NV12)
+            {
+                u = chroma[cy * stride + 2 * cx];
+                v = chroma[cy * stride + 2 * cx + 1];
+            }
+            else
+            {
+                u = chroma[cy * (stride / 2) + cx];
+                v = chroma[(stride / 2) * (height / 2) + cy * (stride / 2) + cx];
+            }
+            reference_pixel(y, u, v, format, out);
+        }
+    }
+}
+
+static bool check_equivalence()
+{
+    static constexpr int width = 70;
+    static constexpr int height = 34;
+    static constexpr int stride = 80;
+
+    std::vector<uint8_t> yuv(stride * height * 3 / 2);
+    for (size_t i = 0; i < yuv.size(); i++)
+    {
+        yuv[i] = (uint8_t) (i * 2654435761u >> 24);
+    }
+
+    bool equal = true;
+    for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12})
+    {
+        for (PixelFormat format : {PixelFormat::BGR, PixelFormat::RGB, PixelFormat::GRAY})
+        {
+            for (bool downscale : {false, true})
+            {
+                std::vector<uint8_t> out(get_converted_size(width, height, format, downscale));
+                std::vector<uint8_t> expected(out.size());
+                convert_yuv420(yuv.data(), layout, width, height, stride, out.data(), format, downscale);
+                reference_convert(yuv.data(), layout, width, height, stride, expected.data(), format, downscale);
+                if (out != expected)
+                {
+                    printf("mismatch: layout %d, format %d, downscale %d\n", (int) layout, (int) format, (int) downscale);
+                    equal = false;
+                }
+            }
+        }
+    }
+    return equal;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 20;
+
+    const bool equal = check_equivalence();
+    printf("scalar reference check: %s\n", equal ? "ok" : "FAILED");
+
+    struct Size
+    {
+        const char *name;
+        int width;
+        int height;
+    };
+    const Size sizes[] = {
+        {"1080p", 1920, 1080},
+        {"4K",    3840, 2160},
+    };
+
+    printf("NV12 -> BGR, %d frames\n", frames);
+    printf("size   downscale  1 thread ms  all threads ms\n");
+    for (const Size &size : sizes)
+    {
+        std::vector<uint8_t> yuv(size.width * size.height * 3 / 2, 100);
+        std::vector<uint8_t> bgr(size.width * size.height * 3);
+        for (bool downscale : {false, true})
+        {
+            const auto run = [&]()
+            {
+                convert_yuv420(yuv.data(), YuvLayout::NV12, size.width, size.height, size.width, bgr.data(), PixelFormat::BGR, downscale);
+            };
+
+            ParallelForConfig config;
+            config.threads = 1;
+            set_parallel_for_config(config);
+            const double serial_ms = average_ms(frames, run);
+
+            config.threads = 0;
+            set_parallel_for_config(config);
+            const double parallel_ms = average_ms(frames, run);
+
+            printf("%-5s  %9d  %11.2f  %14.2f\n", size.name, (int) downscale, serial_ms, parallel_ms);
+        }
+    }
+    return equal ? 0 : 1;
+}
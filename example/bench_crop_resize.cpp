@@ -0,0 +1,234 @@
+// Batched crop-resize speed and correctness, no device needed.
+//
+//   bench_crop_resize [frames]
+//
+// First crop_resize_batch_f32() and crop_resize_batch_u8() are compared to
+// a direct 2D float reference (cv::resize pixel centers) for every
+// interpolation, both layouts and swap_rb, with boxes whose spans leave a
+// SIMD tail. f32 must match within float rounding, u8 within 1, returns 1
+// otherwise. Then 32 boxes of a 1080p BGR frame are resized to a 256x128
+// NCHW batch on 1 thread and on the parallel_for pool.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "depthai/crop_resize.hpp"
+#include "depthai/parallel_for.hpp"
+
+
+using Clock = std::chrono::steady_clock;
+
+using Weights = std::vector<std::pair<int, float>>;
+
+
+static double average_ms(int frames, const std::function<void()> &run)
+{
+    run();
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        run();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / frames;
+}
+
+// Source pixels and weights of output i along one axis
+static Weights reference_weights(float min_n, float max_n, int src_size, int dst_size, int i, ResizeInterpolation interpolation)
+{
+    float start = std::min(min_n, max_n) * src_size;
+    float length = std::fabs(max_n - min_n) * src_size;
+    if (length < 1.f)
+    {
+        start = std::min(start, src_size - 1.f);
+        length = 1.f;
+    }
+    const float step = length / dst_size;
+
+    Weights weights;
+    if (interpolation == ResizeInterpolation::NEAREST)
+    {
+        const int s = (int) std::floor(start + (i + 0.5f) * step);
+        weights.emplace_back(std::min(std::max(s, 0), src_size - 1), 1.f);
+    }
+    else if (interpolation == ResizeInterpolation::BILINEAR || step <= 1.f)
+    {
+        const float s = std::min(std::max(start + (i + 0.5f) * step - 0.5f, 0.f), (float) (src_size - 1));
+        const int s0 = (int) s;
+        weights.emplace_back(s0, 1.f - (s - s0));
+        weights.emplace_back(std::min(s0 + 1, src_size - 1), s - s0);
+    }
+    else
+    {
+        const float f0 = start + i * step;
+        const float f1 = f0 + step;
+        for (int s = 0; s < src_size; s++)
+        {
+            const float cover = std::min(f1, s + 1.f) - std::max(f0, (float) s);
+            if (cover > 0.f)
+            {
+                weights.emplace_back(s, cover / step);
+            }
+        }
+    }
+    return weights;
+}
+
+static void reference_crop_resize(const std::vector<uint8_t> &hwc, int channels, int height, int width,
+    const CropBox &box, int dst_height, int dst_width, ResizeInterpolation interpolation, bool swap_rb,
+    std::vector<float> &dst_hwc)
+{
+    dst_hwc.assign((size_t) channels * dst_height * dst_width, 0.f);
+    for (int oy = 0; oy < dst_height; oy++)
+    {
+        const Weights wy = reference_weights(box.y_min, box.y_max, height, dst_height, oy, interpolation);
+        for (int ox = 0; ox < dst_width; ox++)
+        {
+            const Weights wx = reference_weights(box.x_min, box.x_max, width, dst_width, ox, interpolation);
+            for (int c = 0; c < channels; c++)
+            {
+                const int sc = swap_rb && channels == 3 ? 2 - c : c;
+                float value = 0.f;
+                for (const auto &y : wy)
+                {
+                    for (const auto &x : wx)
+                    {
+                        value += y.second * x.second * hwc[((size_t) y.first * width + x.first) * channels + sc];
+                    }
+                }
+                dst_hwc[((size_t) oy * dst_width + ox) * channels + c] = value;
+            }
+        }
+    }
+}
+
+static bool check_equivalence()
+{
+    static constexpr int channels = 3;
+    static constexpr int height = 120;
+    static constexpr int width = 160;
+    static constexpr int dst_height = 23;
+    static constexpr int dst_width = 37;
+    const CropBox boxes[] = {
+        {0.13f, 0.27f, 0.71f, 0.9f},     // downscale
+        {0.5f,  0.5f,  0.55f, 0.58f},    // upscale
+        {0.f,   0.f,   1.f,   1.f},
+    };
+    const int box_count = sizeof(boxes) / sizeof(boxes[0]);
+    const size_t image_size = (size_t) channels * dst_height * dst_width;
+    const size_t plane = (size_t) height * width;
+
+    std::vector<uint8_t> hwc(channels * plane);
+    std::vector<uint8_t> chw(hwc.size());
+    for (size_t i = 0; i < plane; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            hwc[i * channels + c] = (uint8_t) ((i * channels + c) * 2654435761u >> 24);
+            chw[c * plane + i] = hwc[i * channels + c];
+        }
+    }
+
+    bool equal = true;
+    for (ResizeInterpolation interpolation : {ResizeInterpolation::NEAREST, ResizeInterpolation::BILINEAR, ResizeInterpolation::AREA})
+    {
+        for (TensorLayout layout : {TensorLayout::HWC, TensorLayout::CHW})
+        {
+            for (bool swap_rb : {false, true})
+            {
+                const std::vector<uint8_t> &src = layout == TensorLayout::HWC ? hwc : chw;
+                std::vector<float> resized(box_count * image_size);
+                std::vector<uint8_t> resized_u8(resized.size());
+                crop_resize_batch_f32(src.data(), layout, channels, height, width, boxes, box_count,
+                    resized.data(), layout, dst_height, dst_width, interpolation, nullptr, nullptr, swap_rb);
+                crop_resize_batch_u8(src.data(), layout, channels, height, width, boxes, box_count,
+                    resized_u8.data(), layout, dst_height, dst_width, interpolation, swap_rb);
+
+                double error = 0;
+                double error_u8 = 0;
+                std::vector<float> expected;
+                for (int b = 0; b < box_count; b++)
+                {
+                    reference_crop_resize(hwc, channels, height, width, boxes[b], dst_height, dst_width, interpolation, swap_rb, expected);
+                    for (int i = 0; i < dst_height * dst_width; i++)
+                    {
+                        for (int c = 0; c < channels; c++)
+                        {
+                            const size_t index = b * image_size + (layout == TensorLayout::HWC
+                                ? (size_t) i * channels + c
+                                : (size_t) c * dst_height * dst_width + i);
+                            const float value = expected[(size_t) i * channels + c];
+                            error = std::max(error, (double) std::fabs(resized[index] - value));
+                            error_u8 = std::max(error_u8, (double) std::fabs(resized_u8[index] - value));
+                        }
+                    }
+                }
+                if (error > 1e-3 || error_u8 > 1.0)
+                {
+                    printf("mismatch: interpolation %d, layout %d, swap_rb %d: f32 error %g, u8 error %g\n",
+                        (int) interpolation, (int) layout, (int) swap_rb, error, error_u8);
+                    equal = false;
+                }
+            }
+        }
+    }
+    return equal;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 20;
+
+    const bool equal = check_equivalence();
+    printf("reference check: %s\n", equal ? "ok" : "FAILED");
+
+    static constexpr int height = 1080;
+    static constexpr int width = 1920;
+    static constexpr int box_count = 32;
+    static constexpr int dst_height = 256;
+    static constexpr int dst_width = 128;
+
+    std::vector<uint8_t> frame(3 * height * width, 100);
+    std::vector<CropBox> boxes;
+    for (int i = 0; i < box_count; i++)
+    {
+        const float x = (i % 8) * 0.1f;
+        const float y = (i / 8) * 0.2f;
+        boxes.push_back({x, y, x + 0.12f, y + 0.3f});
+    }
+    std::vector<float> batch((size_t) box_count * 3 * dst_height * dst_width);
+
+    printf("1080p BGR, %d boxes -> %dx%d f32 NCHW, %d frames\n", box_count, dst_width, dst_height, frames);
+    printf("interpolation  1 thread ms  all threads ms\n");
+    const std::pair<const char*, ResizeInterpolation> interpolations[] = {
+        {"nearest",  ResizeInterpolation::NEAREST},
+        {"bilinear", ResizeInterpolation::BILINEAR},
+        {"area",     ResizeInterpolation::AREA},
+    };
+    for (const auto &interpolation : interpolations)
+    {
+        const auto run = [&]()
+        {
+            crop_resize_batch_f32(frame.data(), TensorLayout::HWC, 3, height, width, boxes.data(), box_count,
+                batch.data(), TensorLayout::CHW, dst_height, dst_width, interpolation.second);
+        };
+
+        ParallelForConfig config;
+        config.threads = 1;
+        set_parallel_for_config(config);
+        const double serial_ms = average_ms(frames, run);
+
+        config.threads = 0;
+        set_parallel_for_config(config);
+        const double parallel_ms = average_ms(frames, run);
+
+        printf("%-13s  %11.2f  %14.2f\n", interpolation.first, serial_ms, parallel_ms);
+    }
+    return equal ? 0 : 1;
+}
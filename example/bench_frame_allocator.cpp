@@ -0,0 +1,127 @@
+// Frame buffer alignment and huge page comparison, no device needed.
+//
+//   bench_frame_allocator [frames]
+//
+// For each FrameAllocConfig mode a 4K NV12 frame and its BGR output are
+// allocated, first touched and processed by three kernels on one thread:
+// convert_yuv420() (SIMD), the disparity colorization of
+// DisparityStreamPostProcessor (a lookup table, the Y plane taken as the
+// disparity) and a column walk that touches a new 4 KiB page on every row,
+// which is where huge pages save TLB misses. "unaligned"
+// offsets both buffers by a few bytes from the 64 byte alignment. EXPLICIT
+// needs reserved huge pages (vm.nr_hugepages), TRANSPARENT needs THP
+// "madvise" or "always", otherwise they fall back to normal pages.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "depthai/color_conversion.hpp"
+#include "depthai/frame_allocator.hpp"
+#include "depthai/parallel_for.hpp"
+#include "depthai-shared/disparity_luts.hpp"
+
+
+static constexpr int c_width = 3840;
+static constexpr int c_height = 2160;
+
+using Clock = std::chrono::steady_clock;
+
+static volatile unsigned g_sink;    // keeps the column walk from being optimized out
+
+
+static double average_ms(int frames, const std::function<void()> &run)
+{
+    run();
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        run();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / frames;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 20;
+
+    // memory effects only, not thread scaling
+    ParallelForConfig parallel_config;
+    parallel_config.threads = 1;
+    set_parallel_for_config(parallel_config);
+
+    struct Mode
+    {
+        const char *name;
+        FrameHugePages huge_pages;
+        size_t offset;
+    };
+    const Mode modes[] = {
+        {"unaligned",   FrameHugePages::OFF,         3},
+        {"aligned",     FrameHugePages::OFF,         0},
+        {"transparent", FrameHugePages::TRANSPARENT, 0},
+        {"explicit",    FrameHugePages::EXPLICIT,    0},
+    };
+
+    const size_t yuv_size = c_width * c_height * 3 / 2;
+    const size_t bgr_size = c_width * c_height * 3;
+
+    printf("%dx%d NV12 -> BGR, %d frames per kernel, 1 thread\n", c_width, c_height, frames);
+    printf("mode          alloc+touch ms  nv12->bgr ms  colorize ms  column walk ms\n");
+    for (const Mode &mode : modes)
+    {
+        FrameAllocConfig config;
+        config.huge_pages = mode.huge_pages;
+        set_frame_alloc_config(config);
+
+        // first touch faults in every page, huge pages need far fewer faults
+        const auto alloc_begin = Clock::now();
+        FrameBuffer yuv(yuv_size + c_frame_alignment);
+        FrameBuffer bgr(bgr_size + c_frame_alignment);
+        const double alloc_ms = std::chrono::duration<double, std::milli>(Clock::now() - alloc_begin).count();
+
+        uint8_t *src = yuv.data() + mode.offset;
+        uint8_t *dst = bgr.data() + mode.offset;
+        for (size_t i = 0; i < yuv_size; i++)
+        {
+            src[i] = (uint8_t) (i * 2654435761u >> 24);
+        }
+
+        const double convert_ms = average_ms(frames, [&]()
+        {
+            convert_yuv420(src, YuvLayout::NV12, c_width, c_height, c_width, dst, PixelFormat::BGR);
+        });
+
+        const double colorize_ms = average_ms(frames, [&]()
+        {
+            for (int i = 0; i < c_width * c_height; i++)
+            {
+                const uint8_t disparity = src[i];
+                dst[3 * i + 0] = c_disp_to_color[disparity][0];
+                dst[3 * i + 1] = c_disp_to_color[disparity][1];
+                dst[3 * i + 2] = c_disp_to_color[disparity][2];
+            }
+        });
+
+        // 3 * c_width bytes per row: every step lands on another page
+        const double walk_ms = average_ms(frames, [&]()
+        {
+            unsigned sum = 0;
+            for (int x = 0; x < 3 * c_width; x += 64)
+            {
+                for (int y = 0; y < c_height; y++)
+                {
+                    sum += dst[(size_t) y * 3 * c_width + x];
+                }
+            }
+            g_sink = sum;
+        });
+
+        printf("%-12s  %14.2f  %12.2f  %11.2f  %14.2f\n", mode.name, alloc_ms, convert_ms, colorize_ms, walk_ms);
+    }
+    return 0;
+}
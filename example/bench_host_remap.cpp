@@ -0,0 +1,117 @@
+// Host rectification remap throughput and accuracy, no device needed.
+//
+//   bench_host_remap [frames]
+//
+// A 1280x800 mono frame is remapped with a distortion model, on 1 thread and
+// on the parallel_for pool. The SSE2 / NEON output is compared to a float
+// bilinear reference computed from RectificationModel::mapRow(), the 7-bit
+// fixed point coordinates and weights allow an error of 1. Returns 1 if it is exceeded.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "depthai/host_remap.hpp"
+#include "depthai/parallel_for.hpp"
+
+
+static constexpr int c_width = 1280;
+static constexpr int c_height = 800;
+
+using Clock = std::chrono::steady_clock;
+
+
+static double remap_ms(const RemapTable &table, const std::vector<uint8_t> &src, std::vector<uint8_t> &dst, int frames)
+{
+    table.remap(src.data(), dst.data());
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        table.remap(src.data(), dst.data());
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / frames;
+}
+
+// Largest difference to a float bilinear remap, pixels mapped outside the source must be 0
+static double max_error(const RectificationModel &model, const std::vector<uint8_t> &src, const std::vector<uint8_t> &dst)
+{
+    std::vector<float> xs(c_width);
+    std::vector<float> src_x(c_width);
+    std::vector<float> src_y(c_width);
+    for (int x = 0; x < c_width; x++)
+    {
+        xs[x] = (float) x;
+    }
+
+    double error = 0;
+    for (int y = 0; y < c_height; y++)
+    {
+        model.mapRow(xs.data(), c_width, (float) y, src_x.data(), src_y.data());
+        for (int x = 0; x < c_width; x++)
+        {
+            const float fx = src_x[x];
+            const float fy = src_y[x];
+            const uint8_t value = dst[y * c_width + x];
+            if (fx < 0 || fy < 0 || fx > c_width - 1 || fy > c_height - 1)
+            {
+                error = std::max(error, (double) value);
+                continue;
+            }
+
+            const int x0 = std::min((int) fx, c_width - 2);
+            const int y0 = std::min((int) fy, c_height - 2);
+            const float ax = fx - x0;
+            const float ay = fy - y0;
+            const uint8_t *p = &src[y0 * c_width + x0];
+            const float expected = (p[0] * (1 - ax) + p[1] * ax) * (1 - ay) + (p[c_width] * (1 - ax) + p[c_width + 1] * ax) * ay;
+            error = std::max(error, (double) std::fabs(expected - value));
+        }
+    }
+    return error;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 100;
+
+    const Mat3f M(800.f, 0.f, 640.f,
+                  0.f, 800.f, 400.f,
+                  0.f, 0.f, 1.f);
+    const RectificationModel model(M, Mat3f::identity(), M, {0.1f, -0.05f, 0.001f, 0.002f, 0.01f});
+
+    std::vector<uint8_t> src(c_width * c_height);
+    std::vector<uint8_t> dst(c_width * c_height);
+    // smooth, the 1/128 pixel table coordinates would fail on hard edges
+    for (int y = 0; y < c_height; y++)
+    {
+        for (int x = 0; x < c_width; x++)
+        {
+            src[y * c_width + x] = (uint8_t) (128 + 100 * std::sin(x / 17.f) * std::cos(y / 23.f));
+        }
+    }
+
+    const auto init_begin = Clock::now();
+    RemapTable table;
+    table.init(model, c_width, c_height);
+    const double init_ms = std::chrono::duration<double, std::milli>(Clock::now() - init_begin).count();
+
+    ParallelForConfig config;
+    config.threads = 1;
+    set_parallel_for_config(config);
+    const double serial_ms = remap_ms(table, src, dst, frames);
+    const double error = max_error(model, src, dst);
+
+    config.threads = 0;
+    set_parallel_for_config(config);
+    const double parallel_ms = remap_ms(table, src, dst, frames);
+
+    printf("%dx%d remap, table init %.2f ms\n", c_width, c_height, init_ms);
+    printf("  1 thread     %.3f ms/frame\n", serial_ms);
+    printf("  all threads  %.3f ms/frame\n", parallel_ms);
+    printf("  max error vs float reference %.2f\n", error);
+    return error <= 1.0 ? 0 : 1;
+}
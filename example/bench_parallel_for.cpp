@@ -0,0 +1,117 @@
+// Throughput of parallel_for() for 1 .. max_threads pool threads, no device needed.
+//
+//   bench_parallel_for [max_threads] [frames]
+//
+// Two row kernels on a 4K frame: a lookup table (memory bound, like the
+// disparity colorization) and a 5x5 box filter (compute bound). Speedup is
+// relative to 1 thread, which runs the rows on the calling thread only.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "depthai/parallel_for.hpp"
+
+
+static constexpr int c_width = 3840;
+static constexpr int c_height = 2160;
+
+using Clock = std::chrono::steady_clock;
+
+
+static double run_frames(int frames, const std::function<void(int, int)> &rows)
+{
+    parallel_for(0, c_height, rows, 16);   // warm-up, starts the workers
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        parallel_for(0, c_height, rows, 16);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / frames;
+}
+
+int main(int argc, char **argv)
+{
+    const int max_threads = argc > 1 ? atoi(argv[1]) : 16;
+    const int frames = argc > 2 ? atoi(argv[2]) : 20;
+
+    std::vector<uint8_t> input(c_width * c_height);
+    for (size_t i = 0; i < input.size(); i++)
+    {
+        input[i] = (uint8_t) (i * 2654435761u >> 24);
+    }
+    std::vector<uint8_t> color(3 * input.size());
+    std::vector<uint8_t> filtered(input.size());
+
+    uint8_t lut[256][3];
+    for (int i = 0; i < 256; i++)
+    {
+        lut[i][0] = (uint8_t) i;
+        lut[i][1] = (uint8_t) (255 - i);
+        lut[i][2] = (uint8_t) (i * 7);
+    }
+
+    const auto colorize_rows = [&](int begin, int end)
+    {
+        for (int y = begin; y < end; y++)
+        {
+            const uint8_t *src = &input[y * c_width];
+            uint8_t *dst = &color[3 * y * c_width];
+            for (int x = 0; x < c_width; x++)
+            {
+                dst[3 * x + 0] = lut[src[x]][0];
+                dst[3 * x + 1] = lut[src[x]][1];
+                dst[3 * x + 2] = lut[src[x]][2];
+            }
+        }
+    };
+
+    const auto box_filter_rows = [&](int begin, int end)
+    {
+        for (int y = begin; y < end; y++)
+        {
+            for (int x = 0; x < c_width; x++)
+            {
+                int sum = 0;
+                for (int dy = -2; dy <= 2; dy++)
+                {
+                    const int row = std::min(std::max(y + dy, 0), c_height - 1);
+                    for (int dx = -2; dx <= 2; dx++)
+                    {
+                        const int column = std::min(std::max(x + dx, 0), c_width - 1);
+                        sum += input[row * c_width + column];
+                    }
+                }
+                filtered[y * c_width + x] = (uint8_t) (sum / 25);
+            }
+        }
+    };
+
+    printf("%u hardware threads, %dx%d, %d frames per run\n", std::thread::hardware_concurrency(), c_width, c_height, frames);
+    printf("threads   colorize ms  speedup   box 5x5 ms  speedup\n");
+
+    double colorize_base = 0;
+    double box_base = 0;
+    for (int threads = 1; threads <= max_threads; threads = threads < 4 ? threads + 1 : threads + 4)
+    {
+        ParallelForConfig config;
+        config.threads = threads;
+        set_parallel_for_config(config);
+
+        const double colorize_ms = run_frames(frames, colorize_rows);
+        const double box_ms = run_frames(frames, box_filter_rows);
+        if (threads == 1)
+        {
+            colorize_base = colorize_ms;
+            box_base = box_ms;
+        }
+        printf("%7d  %11.2f  %7.2f  %11.2f  %7.2f\n",
+            threads, colorize_ms, colorize_base / colorize_ms, box_ms, box_base / box_ms);
+    }
+    return 0;
+}
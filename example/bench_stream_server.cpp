@@ -0,0 +1,227 @@
+// Loopback throughput and latency of StreamServer, no device needed.
+//
+//   bench_stream_server [frame_bytes] [frames] [interval_us]
+//
+// Throughput: frames of frame_bytes (default 1080p NV12) are pushed every
+// interval_us to one client that reads as fast as it can, and one that
+// sleeps 5 ms per frame and gets frames skipped. Latency: 64 byte packets,
+// from onPacket() to the end of the read in the client.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "depthai/stream_server.hpp"
+
+
+static const char *c_socket_path = "/tmp/depthai_bench_stream_server.sock";
+
+using Clock = std::chrono::steady_clock;
+
+
+static bool read_all(int fd, void *data, size_t size)
+{
+    uint8_t *bytes = static_cast<uint8_t*>(data);
+    while (size > 0)
+    {
+        const ssize_t received = recv(fd, bytes, size, 0);
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+static int connect_client(const std::string &commands)
+{
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, c_socket_path, sizeof(address.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        perror("connect");
+        close(fd);
+        return -1;
+    }
+    send(fd, commands.data(), commands.size(), 0);
+    return fd;
+}
+
+// Next DATA message, false when the connection is closed
+static bool read_data(int fd, StreamPacketHeader &header, std::vector<uint8_t> &payload)
+{
+    do
+    {
+        if (!read_all(fd, &header, sizeof(header)))
+        {
+            return false;
+        }
+        payload.resize(header.payload_size);
+        if (!read_all(fd, payload.data(), payload.size()))
+        {
+            return false;
+        }
+    }
+    while (header.type != (uint16_t) StreamPacketType::DATA);
+    return true;
+}
+
+static std::shared_ptr<HostDataPacket> make_packet(const std::string &stream_name, size_t size, uint64_t sequence)
+{
+    // device packets end with their FrameMetadata
+    std::vector<uint8_t> data(size + sizeof(FrameMetadata));
+    FrameMetadata metadata = {};
+    metadata.frameSize = size;
+    memcpy(data.data() + size, &metadata, sizeof(metadata));
+    memcpy(data.data(), &sequence, std::min(size, sizeof(sequence)));
+    return std::make_shared<HostDataPacket>(data.size(), data.data(), StreamInfo(stream_name.c_str(), data.size(), {(int) size}));
+}
+
+static void bench_throughput(StreamServer &server, size_t frame_bytes, int frames, int interval_us)
+{
+    struct Result
+    {
+        int received = 0;
+        uint64_t gaps = 0;
+        uint64_t bytes = 0;
+        double seconds = 0;
+    };
+    Result fast;
+    Result slow;
+
+    const auto client = [frames](Result &result, int sleep_ms)
+    {
+        const int fd = connect_client("subscribe frames\n");
+        if (fd < 0)
+        {
+            return;
+        }
+        StreamPacketHeader header;
+        std::vector<uint8_t> payload;
+        uint64_t last = 0;
+        const auto begin = Clock::now();
+        while (read_data(fd, header, payload))
+        {
+            if (result.received > 0 && header.sequence > last + 1)
+            {
+                result.gaps += header.sequence - last - 1;
+            }
+            last = header.sequence;
+            result.received++;
+            result.bytes += sizeof(header) + header.payload_size;
+            if (sleep_ms > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+            }
+            if (last + 1 >= (uint64_t) frames)
+            {
+                break;
+            }
+        }
+        result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        close(fd);
+    };
+
+    std::thread fast_thread(client, std::ref(fast), 0);
+    std::thread slow_thread(client, std::ref(slow), 5);
+    while (server.getClientCount() < 2)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));   // subscriptions
+
+    std::vector<std::shared_ptr<HostDataPacket>> packets;
+    for (int i = 0; i < frames; i++)
+    {
+        packets.push_back(make_packet("frames", frame_bytes, i));
+    }
+
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        server.onPacket(packets[i]);
+        packets[i] = nullptr;
+        if (interval_us > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+        }
+    }
+    const double push_seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    fast_thread.join();
+    slow_thread.join();
+
+    printf("throughput: %d frames of %zu bytes pushed in %.0f ms\n", frames, frame_bytes, push_seconds * 1000);
+    printf("  fast client: %d received, %llu skipped, %.2f GB/s\n",
+        fast.received, (unsigned long long) fast.gaps, fast.bytes / std::max(fast.seconds, 1e-9) / 1e9);
+    printf("  slow client: %d received, %llu skipped\n",
+        slow.received, (unsigned long long) slow.gaps);
+}
+
+static void bench_latency(StreamServer &server, int count)
+{
+    const int fd = connect_client("subscribe latency\n");
+    if (fd < 0)
+    {
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    StreamPacketHeader header;
+    std::vector<uint8_t> payload;
+    std::vector<double> latency_us;
+    for (int i = 0; i < count; i++)
+    {
+        std::shared_ptr<HostDataPacket> packet = make_packet("latency", 64, i);
+        const auto begin = Clock::now();
+        server.onPacket(packet);
+        if (!read_data(fd, header, payload))
+        {
+            break;
+        }
+        latency_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+    }
+    close(fd);
+
+    if (latency_us.empty())
+    {
+        return;
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+    printf("latency: %zu packets of 64 bytes, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+        latency_us.size(),
+        latency_us[latency_us.size() / 2],
+        latency_us[latency_us.size() * 99 / 100],
+        latency_us.back());
+}
+
+int main(int argc, char **argv)
+{
+    const size_t frame_bytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1920 * 1080 * 3 / 2;
+    const int frames = argc > 2 ? atoi(argv[2]) : 600;
+    const int interval_us = argc > 3 ? atoi(argv[3]) : 2000;
+
+    StreamServer server(c_socket_path, 4);
+    if (!server.isRunning())
+    {
+        fprintf(stderr, "can't start the server on %s\n", c_socket_path);
+        return 1;
+    }
+
+    bench_throughput(server, frame_bytes, frames, interval_us);
+    bench_latency(server, 2000);
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Tensor packing speed and correctness, no device needed.
+//
+//   bench_tensor_packing [frames]
+//
+// First pack_tensor_u8() and pack_tensor_f32() are compared to a scalar
+// reference for 1, 3 and 4 channels, every layout pair and swap_rb, on a
+// width that leaves a SIMD tail. u8 must match exactly, f32 within float
+// rounding, returns 1 otherwise. Then 300x300 (previewout) and 1080p BGR
+// frames are packed on 1 thread and on the parallel_for pool.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "depthai/parallel_for.hpp"
+#include "depthai/tensor_packing.hpp"
+
+
+using Clock = std::chrono::steady_clock;
+
+
+static double average_ms(int frames, const std::function<void()> &run)
+{
+    run();
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        run();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count() / frames;
+}
+
+static size_t tensor_index(TensorLayout layout, int channel, size_t pixel, int channels, size_t pixels)
+{
+    return layout == TensorLayout::CHW ? channel * pixels + pixel : pixel * channels + channel;
+}
+
+static bool check_equivalence()
+{
+    static constexpr int height = 37;
+    static constexpr int width = 29;
+    static const float mean[4] = {1.f, 2.f, 3.f, 4.f};
+    static const float scale[4] = {0.5f, 0.25f, 2.f, 1.f};
+
+    const size_t pixels = height * width;
+    bool equal = true;
+    for (int channels : {1, 3, 4})
+    {
+        std::vector<uint8_t> src(pixels * channels);
+        for (size_t i = 0; i < src.size(); i++)
+        {
+            src[i] = (uint8_t) (i * 2654435761u >> 24);
+        }
+
+        for (TensorLayout src_layout : {TensorLayout::CHW, TensorLayout::HWC})
+        {
+            for (TensorLayout dst_layout : {TensorLayout::CHW, TensorLayout::HWC})
+            {
+                for (bool swap_rb : {false, true})
+                {
+                    std::vector<uint8_t> packed(src.size());
+                    std::vector<float> normalized(src.size());
+                    pack_tensor_u8(src.data(), src_layout, packed.data(), dst_layout, channels, height, width, swap_rb);
+                    pack_tensor_f32(src.data(), src_layout, normalized.data(), dst_layout, channels, height, width, mean, scale, swap_rb);
+
+                    int mismatches = 0;
+                    for (size_t pixel = 0; pixel < pixels; pixel++)
+                    {
+                        for (int c = 0; c < channels; c++)
+                        {
+                            const int src_channel = swap_rb && channels == 3 ? 2 - c : c;
+                            const uint8_t value = src[tensor_index(src_layout, src_channel, pixel, channels, pixels)];
+                            const size_t dst_index = tensor_index(dst_layout, c, pixel, channels, pixels);
+                            const float expected = (value - mean[c]) * scale[c];
+                            if (packed[dst_index] != value || std::fabs(normalized[dst_index] - expected) > 1e-3f)
+                            {
+                                mismatches++;
+                            }
+                        }
+                    }
+                    if (mismatches > 0)
+                    {
+                        printf("mismatch: %d channels, layout %d -> %d, swap_rb %d: %d values\n",
+                            channels, (int) src_layout, (int) dst_layout, (int) swap_rb, mismatches);
+                        equal = false;
+                    }
+                }
+            }
+        }
+    }
+    return equal;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? atoi(argv[1]) : 50;
+
+    const bool equal = check_equivalence();
+    printf("scalar reference check: %s\n", equal ? "ok" : "FAILED");
+
+    struct Size
+    {
+        const char *name;
+        int width;
+        int height;
+    };
+    const Size sizes[] = {
+        {"300x300", 300, 300},
+        {"1080p",   1920, 1080},
+    };
+    static const float mean[3] = {127.5f, 127.5f, 127.5f};
+    static const float scale[3] = {1 / 127.5f, 1 / 127.5f, 1 / 127.5f};
+
+    printf("3 channels, %d frames\n", frames);
+    printf("size     packing                  1 thread ms  all threads ms\n");
+    for (const Size &size : sizes)
+    {
+        const size_t values = 3 * size.width * size.height;
+        std::vector<uint8_t> src(values, 100);
+        std::vector<uint8_t> packed(values);
+        std::vector<float> normalized(values);
+
+        struct Packing
+        {
+            const char *name;
+            std::function<void()> run;
+        };
+        const Packing packings[] = {
+            {"u8 CHW -> HWC", [&]()
+            {
+                pack_tensor_u8(src.data(), TensorLayout::CHW, packed.data(), TensorLayout::HWC, 3, size.height, size.width);
+            }},
+            {"u8 HWC -> CHW swap_rb", [&]()
+            {
+                pack_tensor_u8(src.data(), TensorLayout::HWC, packed.data(), TensorLayout::CHW, 3, size.height, size.width, true);
+            }},
+            {"f32 HWC -> CHW normalized", [&]()
+            {
+                pack_tensor_f32(src.data(), TensorLayout::HWC, normalized.data(), TensorLayout::CHW, 3, size.height, size.width, mean, scale, true);
+            }},
+        };
+
+        for (const Packing &packing : packings)
+        {
+            ParallelForConfig config;
+            config.threads = 1;
+            set_parallel_for_config(config);
+            const double serial_ms = average_ms(frames, packing.run);
+
+            config.threads = 0;
+            set_parallel_for_config(config);
+            const double parallel_ms = average_ms(frames, packing.run);
+
+            printf("%-7s  %-25s  %10.3f  %14.3f\n", size.name, packing.name, serial_ms, parallel_ms);
+        }
+    }
+    return equal ? 0 : 1;
+}
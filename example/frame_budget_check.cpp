@@ -0,0 +1,98 @@
+// Checks the FrameBudget accounting while packets are admitted and consumed
+// at the same time, no device needed. Returns 1 if bytes stay charged after
+// everything was consumed, or if a consumed packet was counted as evicted.
+//
+//   frame_budget_check [packets]
+//
+// One thread feeds "left" frames through onNewData() under a limit of a few
+// frames, so admit() keeps evicting, while another thread consumes them with
+// consumeAvailablePackets(). The limit is below the pipeline queue size, so
+// every admitted packet is either consumed or evicted.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "depthai/frame_budget.hpp"
+#include "depthai/logger.hpp"
+#include "depthai/pipeline/host_pipeline.hpp"
+
+
+static constexpr size_t c_frame_size = 64 * 1024;
+static constexpr size_t c_limit_frames = 4;
+
+// Stands in for XLinkWrapper
+class SyntheticStreams
+    : public DataSubject<StreamInfo, StreamData>
+{
+public:
+    void send(const StreamInfo &info, std::vector<uint8_t> &packet, unsigned packet_number)
+    {
+        StreamData data;
+        data.packet_number = packet_number;
+        data.data = packet.data();
+        data.size = packet.size();
+        notifyObservers(info, data);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    const int packets = argc > 1 ? atoi(argv[1]) : 50000;
+
+    // device packets end with their FrameMetadata
+    std::vector<uint8_t> left_packet(c_frame_size + sizeof(FrameMetadata), 0x80);
+    FrameMetadata metadata = {};
+    metadata.frameSize = c_frame_size;
+    memcpy(left_packet.data() + c_frame_size, &metadata, sizeof(metadata));
+
+    // evictions are expected
+    Logger::instance().setLevel(LogLevel::error);
+
+    FrameBudget &budget = FrameBudget::instance();
+    budget.setLimit(c_limit_frames * left_packet.size());
+
+    uint64_t consumed = 0;
+    {
+        HostPipeline pipeline;
+        SyntheticStreams streams;
+        const StreamInfo left("left", left_packet.size(), {256, 256});
+        pipeline.observe(streams, left);
+
+        std::atomic<bool> done(false);
+        std::thread consumer([&]()
+        {
+            const auto count = [&consumed](std::shared_ptr<HostDataPacket> &)
+            {
+                consumed++;
+            };
+            while (!done.load())
+            {
+                pipeline.consumeAvailablePackets(count);
+            }
+            pipeline.consumeAvailablePackets(count);
+        });
+
+        for (int i = 0; i < packets; i++)
+        {
+            streams.send(left, left_packet, i);
+        }
+        done = true;
+        consumer.join();
+    }
+
+    const FrameBudgetStats stats = budget.getStats();
+    printf("%d packets, %llu admitted, %llu consumed, %llu evicted, %llu denied, %zu bytes still charged, high water %zu of %zu\n",
+        packets,
+        (unsigned long long) stats.admitted,
+        (unsigned long long) consumed,
+        (unsigned long long) stats.evicted,
+        (unsigned long long) stats.denied,
+        stats.used_bytes,
+        stats.high_water_bytes,
+        stats.limit_bytes);
+    return stats.used_bytes == 0 && stats.admitted == consumed + stats.evicted ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// Checks that the frame path of HostPipeline::enableRealtime() does not
+// allocate, no device needed. Built only with the DEPTHAI_ALLOCATION_HOOK
+// CMake option, returns 1 if the armed hook saw a frame path allocation.
+//
+//   realtime_allocation_check [iterations]
+//
+// Synthetic "left" frames, H.264 "video" access units and "metaout" packets
+// are fed through onNewData() with a frame budget, a NalParser, a cursor and
+// a packet listener, and consumed with consumeAvailablePackets(). The hook
+// is armed after a warm-up.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "depthai/allocation_hook.hpp"
+#include "depthai/frame_allocator.hpp"
+#include "depthai/frame_budget.hpp"
+#include "depthai/nal_parser.hpp"
+#include "depthai/pipeline/host_pipeline.hpp"
+
+
+static constexpr int c_warm_up_iterations = 200;
+
+// Stands in for XLinkWrapper
+class SyntheticStreams
+    : public DataSubject<StreamInfo, StreamData>
+{
+public:
+    void send(const StreamInfo &info, std::vector<uint8_t> &packet, unsigned packet_number)
+    {
+        StreamData data;
+        data.packet_number = packet_number;
+        data.data = packet.data();
+        data.size = packet.size();
+        notifyObservers(info, data);
+    }
+};
+
+// Device packets end with their FrameMetadata
+static std::vector<uint8_t> make_device_packet(size_t frame_size)
+{
+    std::vector<uint8_t> packet(frame_size + sizeof(FrameMetadata), 0x80);
+    FrameMetadata metadata = {};
+    metadata.frameSize = frame_size;
+    memcpy(packet.data() + frame_size, &metadata, sizeof(metadata));
+    return packet;
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = argc > 1 ? atoi(argv[1]) : 5000;
+
+    FrameAllocConfig alloc_config;
+    alloc_config.recycle = true;
+    set_frame_alloc_config(alloc_config);
+    FrameBudget::instance().setLimit(64 * 1024 * 1024);
+
+    const StreamInfo left("left", 1280 * 800 + sizeof(FrameMetadata), {800, 1280});
+    const StreamInfo metaout("metaout", 4096, {1024});
+    std::vector<uint8_t> left_packet = make_device_packet(1280 * 800);
+    std::vector<uint8_t> metaout_packet = make_device_packet(1000);
+
+    // IDR slice
+    const StreamInfo video("video", 64 * 1024, {64 * 1024});
+    std::vector<uint8_t> video_packet = make_device_packet(4096);
+    const uint8_t idr_slice[] = {0, 0, 0, 1, 0x65, 0x88, 0x84, 0x00};
+    memcpy(video_packet.data(), idr_slice, sizeof(idr_slice));
+
+    HostPipeline pipeline;
+    pipeline.enableRealtime(8);
+    // NalParser runs outside the frame path and may allocate
+    pipeline.setNalParser("video", std::make_shared<NalParser>(VideoCodec::H264));
+
+    SyntheticStreams streams;
+    pipeline.observe(streams, left);
+    pipeline.observe(streams, video);
+    pipeline.observe(streams, metaout);
+
+    std::shared_ptr<PacketCursor> cursor = pipeline.addCursor("check", CursorPolicy::ALL, 8, "metaout");
+
+    // listeners run outside the frame path and may allocate
+    std::vector<std::shared_ptr<HostDataPacket>> listened;
+    pipeline.addPacketListener("metaout", [&listened](const std::shared_ptr<HostDataPacket> &packet)
+    {
+        listened.push_back(packet);
+        if (listened.size() > 4)
+        {
+            listened.clear();
+        }
+    });
+
+    uint64_t consumed = 0;
+    const auto run = [&](int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            streams.send(left, left_packet, i);
+            streams.send(video, video_packet, i);
+            streams.send(metaout, metaout_packet, i);
+            if (i % 3 == 0)
+            {
+                pipeline.consumeAvailablePackets([&consumed](std::shared_ptr<HostDataPacket> &)
+                {
+                    consumed++;
+                });
+            }
+            if (i % 5 == 0)
+            {
+                while (cursor->next(0))
+                {
+                }
+            }
+        }
+    };
+
+    run(c_warm_up_iterations);
+
+    // count only, the default handler aborts on the first allocation
+    set_allocation_failure_handler(nullptr);
+    arm_allocation_hook(true);
+    run(iterations);
+    arm_allocation_hook(false);
+    listened.clear();
+
+    const uint64_t allocations = get_frame_path_allocations();
+    const FramePoolStats pool_stats = get_frame_pool_stats();
+    printf("%d iterations, %llu packets consumed, %llu frame path allocations, frame pool %llu hits %llu misses\n",
+        iterations,
+        (unsigned long long) consumed,
+        (unsigned long long) allocations,
+        (unsigned long long) pool_stats.hits,
+        (unsigned long long) pool_stats.misses);
+    return allocations == 0 ? 0 : 1;
+}
@@ -1,9 +1,12 @@
 #pragma once
-#include <queue>
+#include <algorithm>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 
+#include "frame_allocator.hpp"
+
 template<typename T>
 class LockingQueue
 {
@@ -14,7 +17,9 @@ public:
     }
 
 
-    void waitAndConsumeAll(std::function<void(T&)> callback){
+    // Callback is a template so lambdas are not wrapped in a std::function
+    template<typename Callback>
+    void waitAndConsumeAll(Callback &&callback){
         std::unique_lock<std::mutex> lock(guard);
         while (queue.empty())
         {
@@ -23,15 +28,16 @@ public:
         
         while(!queue.empty()){
             callback(queue.front());
-            queue.pop();
+            queue.pop_front();
         }
     }
 
-    void consumeAll(std::function<void(T&)> callback){
+    template<typename Callback>
+    void consumeAll(Callback &&callback){
         std::lock_guard<std::mutex> lock(guard);
         while(!queue.empty()){
             callback(queue.front());
-            queue.pop();
+            queue.pop_front();
         }
     }
 
@@ -42,7 +48,7 @@ public:
             if(queue.size() >= maxsize){
                 return false;
             }
-            queue.push(_data);
+            queue.push_back(_data);
         }
         signal.notify_one();
         return true;
@@ -63,7 +69,21 @@ public:
         }
 
         _value = queue.front();
-        queue.pop();
+        queue.pop_front();
+        return true;
+    }
+
+    // Removes the first element that matches predicate
+    template<typename Predicate>
+    bool eraseFirst(Predicate &&predicate)
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        auto it = std::find_if(queue.begin(), queue.end(), predicate);
+        if (it == queue.end())
+        {
+            return false;
+        }
+        queue.erase(it);
         return true;
     }
 
@@ -76,7 +96,7 @@ public:
         }
 
         _value = queue.front();
-        queue.pop();
+        queue.pop_front();
     }
 
     bool tryWaitAndPop(T& _value, int _milli)
@@ -89,13 +109,13 @@ public:
         }
 
         _value = queue.front();
-        queue.pop();
+        queue.pop_front();
         return true;
     }
 
 private:
     int maxsize = 0;
-    std::queue<T> queue;
+    std::deque<T, FrameAllocator<T>> queue;    // recycled blocks, see FrameAllocConfig::recycle
     mutable std::mutex guard;
     std::condition_variable signal;
 };
\ No newline at end of file
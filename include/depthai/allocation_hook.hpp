@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Test support for the allocation free frame path of HostPipeline::enableRealtime().
+//
+// FramePathScope marks code that runs for every packet. In builds with the
+// DEPTHAI_ALLOCATION_HOOK CMake option the library replaces the global
+// operator new, and once armed every heap allocation made inside a scope,
+// as well as every frame pool miss, is counted and passed to the failure
+// handler (default: logs and aborts). Without the option the scope is
+// empty and the functions do nothing.
+//
+//   // after create_pipeline() and a few frames of warm-up
+//   arm_allocation_hook(true);
+//   ...
+//   assert(get_frame_path_allocations() == 0);
+
+using AllocationFailureHandler = void (*)(size_t size);
+
+#ifdef DEPTHAI_ALLOCATION_HOOK
+
+class FramePathScope
+{
+public:
+    FramePathScope();
+    ~FramePathScope();
+
+    FramePathScope(const FramePathScope&) = delete;
+    FramePathScope& operator=(const FramePathScope&) = delete;
+};
+
+// Leaves the enclosing scopes, for code on the frame path that is allowed
+// to allocate after reporting it through check_frame_path_allocation()
+class FramePathExit
+{
+public:
+    FramePathExit();
+    ~FramePathExit();
+
+    FramePathExit(const FramePathExit&) = delete;
+    FramePathExit& operator=(const FramePathExit&) = delete;
+
+private:
+    int _depth;
+};
+
+void arm_allocation_hook(bool armed);
+// nullptr: count only
+void set_allocation_failure_handler(AllocationFailureHandler handler);
+uint64_t get_frame_path_allocations();
+
+// Called by the library pools when they have to allocate
+void check_frame_path_allocation(size_t size);
+
+#else
+
+class FramePathScope
+{
+public:
+    FramePathScope() {}
+};
+
+class FramePathExit
+{
+public:
+    FramePathExit() {}
+};
+
+inline void arm_allocation_hook(bool) {}
+inline void set_allocation_failure_handler(AllocationFailureHandler) {}
+inline uint64_t get_frame_path_allocations() { return 0; }
+inline void check_frame_path_allocation(size_t) {}
+
+#endif
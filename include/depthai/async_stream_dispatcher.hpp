@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "depthai-shared/general/data_observer.hpp"
+#include "depthai-shared/general/data_subject.hpp"
+#include "depthai-shared/stream/stream_info.hpp"
+#include "depthai-shared/stream/stream_data.hpp"
+
+
+enum class OverflowPolicy
+{
+    DROP_OLDEST,    // a full inbox drops its oldest packet
+    DROP_NEWEST,    // a full inbox rejects the new packet
+    BLOCK,          // the reader thread waits, stalls the device stream
+};
+
+struct AsyncObserverStats
+{
+    std::string name;
+    size_t      queued;
+    uint64_t    delivered;
+    uint64_t    dropped;
+    double      lag_s;          // time the last delivered packet waited in the inbox
+    double      max_lag_s;
+};
+
+// Runs observers of a subject (XLink) on their own threads instead of the
+// reader thread. The reader thread copies a packet once into a ref-counted
+// buffer and enqueues it in the bounded inbox of each observer of the
+// stream, every observer is notified by its own executor thread.
+//
+//   dispatcher.addObserver(*g_xlink, "disparity", *post_proc, {disparity_info});
+//
+// Observers must outlive the dispatcher, stop() joins the executors.
+class AsyncStreamDispatcher
+    : public DataObserver<StreamInfo, StreamData>
+{
+public:
+    AsyncStreamDispatcher() = default;
+    ~AsyncStreamDispatcher();
+
+    AsyncStreamDispatcher(const AsyncStreamDispatcher&) = delete;
+    AsyncStreamDispatcher& operator=(const AsyncStreamDispatcher&) = delete;
+
+    // observer gets the streams of subject on a new executor thread
+    void addObserver(
+        DataSubject<StreamInfo, StreamData> &subject,
+        const std::string &name,
+        DataObserver<StreamInfo, StreamData> &observer,
+        const std::vector<StreamInfo> &streams,
+        size_t inbox_size = 4,
+        OverflowPolicy policy = OverflowPolicy::DROP_OLDEST
+    );
+
+    std::vector<AsyncObserverStats> getStats();
+
+    void stop();
+
+private:
+    struct Packet
+    {
+        std::shared_ptr<const StreamInfo> info;
+        unsigned packet_number;
+        std::vector<unsigned char> data;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    // DataSubject of one observer, notified from its executor thread
+    class Inbox
+        : public DataSubject<StreamInfo, StreamData>
+    {
+    public:
+        Inbox(const std::string &name, const std::vector<StreamInfo> &streams, size_t size, OverflowPolicy policy);
+
+        bool accepts(const std::string &stream_name) const { return _streams.count(stream_name) > 0; }
+        void push(const std::shared_ptr<const Packet> &packet);
+        void start();
+        void stop();
+        AsyncObserverStats getStats();
+
+    private:
+        void executorThread();
+
+        const std::string           _name;
+        const std::set<std::string> _streams;
+        const size_t                _size;
+        const OverflowPolicy        _policy;
+
+        std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::condition_variable _not_full;
+        std::deque<std::shared_ptr<const Packet>> _queue;
+        bool _stop = false;
+        std::thread _thread;
+
+        uint64_t _delivered = 0;
+        uint64_t _dropped = 0;
+        double   _lag_s = 0;
+        double   _max_lag_s = 0;
+    };
+
+    // from DataObserver<StreamInfo, StreamData>, called on the reader threads
+    virtual void onNewData(const StreamInfo &info, const StreamData &data) final;
+    virtual void onNewDataSubject(const StreamInfo &info) final;
+
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<Inbox>> _inboxes;
+    std::map<std::string, std::shared_ptr<const StreamInfo>> _stream_infos;   // observed streams
+};
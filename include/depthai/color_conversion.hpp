@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// 4:2:0 layouts, both start with the full resolution Y plane
+enum class YuvLayout
+{
+    I420,   // U plane, then V plane, each (stride / 2) x (height / 2)
+    NV12,   // interleaved UV plane, stride x (height / 2)
+};
+
+enum class PixelFormat
+{
+    BGR,    // interleaved, 3 bytes per pixel
+    RGB,
+    GRAY,
+};
+
+int get_pixel_format_channels(PixelFormat format);
+
+// Size of the converted image, tightly packed
+size_t get_converted_size(int width, int height, PixelFormat format, bool downscale);
+
+// BT.601 limited range YUV 4:2:0 -> BGR / RGB / gray, with 6-bit fixed point
+// coefficients (SSE2 / NEON, scalar fallback). width and height must be even,
+// stride is the row size of the Y plane. With downscale each 2x2 block becomes
+// one output pixel (Y averaged), output is (width / 2) x (height / 2).
+// Row pairs are processed in parallel.
+void convert_yuv420(
+    const uint8_t *yuv,
+    YuvLayout layout,
+    int width,
+    int height,
+    int stride,
+    uint8_t *dst,
+    PixelFormat format,
+    bool downscale = false
+);
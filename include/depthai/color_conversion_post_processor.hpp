@@ -0,0 +1,48 @@
+#pragma once
+// Host side conversion of the YUV 4:2:0 device streams:
+// "color" -> "color_bgr", "color_rgb", "color_gray"
+
+// Std
+#include <string>
+#include <vector>
+
+// Shared
+#include "depthai-shared/general/data_observer.hpp"
+#include "depthai-shared/general/data_subject.hpp"
+#include "depthai-shared/stream/stream_info.hpp"
+#include "depthai-shared/stream/stream_data.hpp"
+
+// Project
+#include "color_conversion.hpp"
+
+
+class ColorConversionPostProcessor
+    : public DataSubject<StreamInfo, StreamData>
+    , public DataObserver<StreamInfo, StreamData>
+{
+public:
+    // "color_bgr" -> "color", BGR. false if stream_name is not a conversion of a YUV stream
+    static bool parseStreamName(const std::string &stream_name, std::string &input_name, PixelFormat &format);
+
+    // false if stream_name is not a YUV 4:2:0 device stream
+    static bool getYuvLayout(const std::string &stream_name, YuvLayout &layout);
+
+    // Outputs are added before the input streams are observed
+    void addOutput(const std::string &input_name, const std::string &output_name, PixelFormat format, bool downscale);
+
+protected:
+    // class DataObserver
+    virtual void onNewData(const StreamInfo &data_info, const StreamData &data);
+
+private:
+    struct Output
+    {
+        std::string                input_name;
+        std::string                output_name;
+        PixelFormat                format;
+        bool                       downscale;
+        std::vector<unsigned char> buffer;  // reused for every frame
+    };
+
+    std::vector<Output> _outputs;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "depthai-shared/cnn_info.hpp"
+#include "tensor_packing.hpp"
+
+
+enum class ResizeInterpolation
+{
+    NEAREST,
+    BILINEAR,
+    AREA,       // box filter, bilinear when upscaling
+};
+
+// Normalized [0, 1] coordinates, as in dai::Detection
+struct CropBox
+{
+    float x_min;
+    float y_min;
+    float x_max;
+    float y_max;
+};
+
+// Boxes of the detections with confidence >= min_confidence, clamped to [0, 1]
+std::vector<CropBox> get_detection_boxes(const dai::Detections &detections, float min_confidence = 0.f);
+
+// Crops each box from a uint8 frame (channels x height x width in src_layout)
+// and resizes it to dst_width x dst_height. Crop b is written to
+// dst + b * channels * dst_height * dst_width in dst_layout, so dst holds one
+// NCHW / NHWC batch of box_count images. Pixel centers are aligned as in
+// cv::resize. swap_rb reverses the channel order of 3 channel frames.
+// Boxes are processed in parallel, the row passes use SSE2 / NEON.
+void crop_resize_batch_u8(
+    const uint8_t *src, TensorLayout src_layout,
+    int channels, int height, int width,
+    const CropBox *boxes, int box_count,
+    uint8_t *dst, TensorLayout dst_layout,
+    int dst_height, int dst_width,
+    ResizeInterpolation interpolation,
+    bool swap_rb = false
+);
+
+// Same as crop_resize_batch_u8 with float output normalized as in
+// pack_tensor_f32: (value - mean[c]) * scale[c], nullptr means 0 / 1.
+void crop_resize_batch_f32(
+    const uint8_t *src, TensorLayout src_layout,
+    int channels, int height, int width,
+    const CropBox *boxes, int box_count,
+    float *dst, TensorLayout dst_layout,
+    int dst_height, int dst_width,
+    ResizeInterpolation interpolation,
+    const float *mean = nullptr,
+    const float *scale = nullptr,
+    bool swap_rb = false
+);
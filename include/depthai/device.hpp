@@ -1,6 +1,11 @@
 #pragma once
 
 //std
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
@@ -13,8 +18,16 @@
 #include "pipeline/cnn_host_pipeline.hpp"
 #include "pipeline/host_pipeline.hpp"
 #include "disparity_stream_post_processor.hpp"
+#include "rectified_stream_post_processor.hpp"
+#include "color_conversion_post_processor.hpp"
+#include "async_stream_dispatcher.hpp"
 #include "device_support_listener.hpp"
+#include "device_telemetry.hpp"
 #include "host_capture_command.hpp"
+#include "nal_parser.hpp"
+#include "matrix_types.hpp"
+#include "startup_report.hpp"
+#include "thread_settings.hpp"
 
 
 // RAII for specific Device device
@@ -22,18 +35,46 @@ class Device{
 
 public:
 
+    // Phases of device boot and pipeline creation, reported through StartupProgressCallback
+    enum class StartupPhase
+    {
+        BOOT,           // usb boot of the device side binary
+        CONFIG_D2H,     // config_d2h read and eeprom parsing
+        BLOB_UPLOAD,    // inBlob / outBlob exchange for each NN stage
+        STREAM_OPEN,    // opening of the requested device streams
+    };
+
+    // progress is in range [0 .. 1], 1 is reported once the phase is done
+    using StartupProgressCallback = std::function<void(StartupPhase phase, float progress)>;
+
     Device();
 
     Device(std::string usb_device, bool usb2_mode = false);
 
+    Device(std::string usb_device, bool usb2_mode, StartupProgressCallback progress_cb);
+
     // Basically init_device but RAII
     Device(std::string cmd_file, std::string usb_device);
 
     // Basically deinit_device but RAII
     ~Device();
 
+    // Boots the device on a separate thread, future throws if device can't be initialized
+    static std::future<std::shared_ptr<Device>> open_async(
+        std::string usb_device,
+        bool usb2_mode = false,
+        StartupProgressCallback progress_cb = nullptr
+    );
+
+    // progress_cb runs on the calling thread, watchdog reboots recreate the pipeline without it
     std::shared_ptr<CNNHostPipeline> create_pipeline(
-        const std::string &config_json_str
+        const std::string &config_json_str,
+        const StartupProgressCallback &progress_cb = nullptr
+    );
+    // create_pipeline on a separate thread, future holds nullptr if pipeline creation failed
+    std::future<std::shared_ptr<CNNHostPipeline>> create_pipeline_async(
+        const std::string &config_json_str,
+        StartupProgressCallback progress_cb = nullptr
     );
     std::shared_ptr<CNNHostPipeline> get_pipeline();
     std::vector<std::string> get_available_streams();
@@ -65,6 +106,33 @@ public:
     
     std::map<std::string, int> get_nn_to_depth_bbox_mapping();
 
+    // Timings of the last device boot and the last create_pipeline call
+    StartupReport get_startup_report();
+
+    // Device temperatures and load, received while the "meta_d2h" stream is requested.
+    // get_telemetry() returns a report with NaN fields if none was received yet
+    DeviceTelemetry get_telemetry();
+    std::vector<DeviceTelemetry> get_telemetry_history();
+    // Callback runs on the XLink thread, returns id for remove_telemetry_threshold()
+    int add_telemetry_threshold(
+        TelemetryMetric metric,
+        float threshold,
+        float hysteresis,
+        TelemetryThresholdCallback callback
+    );
+    void remove_telemetry_threshold(int id);
+
+    // Inbox state of the post processors with "async_post_processing", empty otherwise
+    std::vector<AsyncObserverStats> get_async_observer_stats();
+
+    // Host threads configured by "app"/"threads" with their CPU time
+    std::vector<ThreadStats> get_thread_stats();
+
+    // Recent keyframes and current parameter sets of the encoded "video" stream,
+    // empty / nullptr if it is not requested or not H.264 / H.265
+    std::vector<KeyframeIndexEntry> get_video_keyframe_index();
+    std::shared_ptr<const VideoParameterSets> get_video_parameter_sets();
+
 private:
     
     std::vector<uint8_t> patched_cmd;
@@ -80,14 +148,19 @@ private:
         const std::string &device_cmd_file,
         const std::string &usb_device,
         uint8_t* binary = nullptr,
-        long binary_size = 0
+        long binary_size = 0,
+        const StartupProgressCallback &progress_cb = nullptr
     );
     void soft_deinit_device()
     {
         if(g_host_capture_command != nullptr)
             g_host_capture_command->sendCustomDeviceResetRequest();
         g_xlink = nullptr;
+        g_async_dispatcher = nullptr;
         g_disparity_post_proc = nullptr;
+        g_rectified_post_proc = nullptr;
+        g_color_conversion_post_proc = nullptr;
+        g_video_parser = nullptr;
         g_device_support_listener = nullptr;
         g_host_capture_command = nullptr;
     };
@@ -99,18 +172,28 @@ private:
     int read_and_parse_config_d2h(void);
     void load_and_print_config_d2h(void);
 
+    std::mutex startup_report_mutex;
+    StartupReport startup_report;
+    std::chrono::steady_clock::time_point device_startup_begin;
+    std::chrono::steady_clock::time_point pipeline_startup_begin;
+    void begin_device_startup_report();
+    void begin_pipeline_startup_report();
+    void add_device_startup_phase(const std::string &name, std::chrono::steady_clock::time_point phase_begin);
+    void add_pipeline_startup_phase(const std::string &name, std::chrono::steady_clock::time_point phase_begin);
+
 
     std::shared_ptr<CNNHostPipeline> gl_result = nullptr;
-    std::vector<std::vector<float>> R1_l;
-    std::vector<std::vector<float>> R2_r;
-    std::vector<std::vector<float>> H1_l;
-    std::vector<std::vector<float>> H2_r;
-    std::vector<std::vector<float>> M1_l;
-    std::vector<std::vector<float>> M2_r;
-    std::vector<std::vector<float>> R;
-    std::vector<float> T;
+    Mat3f R1_l;
+    Mat3f R2_r;
+    Mat3f H1_l;
+    Mat3f H2_r;
+    Mat3f M1_l;
+    Mat3f M2_r;
+    Mat3f R;
+    Vec3f T;
     std::vector<float> d1_l;
     std::vector<float> d2_r;
+    bool intrinsics_loaded = false; // M1_l, M2_r, R, T are valid
     int32_t version;
     bool device_changed = true;
     std::string config_backup;
@@ -128,8 +211,14 @@ private:
     nlohmann::json g_config_d2h;
 
     std::unique_ptr<DisparityStreamPostProcessor> g_disparity_post_proc;
+    std::unique_ptr<RectifiedStreamPostProcessor> g_rectified_post_proc;
+    std::unique_ptr<ColorConversionPostProcessor> g_color_conversion_post_proc;
     std::unique_ptr<DeviceSupportListener>        g_device_support_listener;
     std::unique_ptr<HostCaptureCommand>           g_host_capture_command;
+    std::shared_ptr<NalParser>                    g_video_parser;
+    std::unique_ptr<AsyncStreamDispatcher>        g_async_dispatcher;   // destroyed before the post processors
+
+    DeviceTelemetryMonitor telemetry_monitor;
 
     std::map<std::string, int> nn_to_depth_mapping = {
         { "off_x", 0 },
@@ -4,14 +4,20 @@
 #include "depthai-shared/general/data_observer.hpp"
 #include "depthai-shared/stream/stream_data.hpp"
 
+#include "device_telemetry.hpp"
+
 
 class DeviceSupportListener
     : public DataObserver<StreamInfo, StreamData>
 {
 public:
+    explicit DeviceSupportListener(DeviceTelemetryMonitor &telemetry_monitor);
 
 protected:
     // class DataObserver
     virtual void onNewData(const StreamInfo &data_info, const StreamData &data) final;
 
+private:
+    DeviceTelemetryMonitor &_telemetry_monitor;
+    std::function<void(const char*, size_t)> _on_device_log;
 };
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+
+// One meta_d2h report. Fields not present in the report are NaN.
+//
+//   sensors.temperature.{css, mss, upa0, upa1}  chip temperatures, Celsius
+//   sensors.cpu_usage.{leon_os, leon_rt}        load of the Leon cores, percent
+//   sensors.memory.{ddr_used, ddr_total,
+//                   cmx_used, cmx_total}        memory usage, bytes
+struct DeviceTelemetry
+{
+    double host_timestamp = 0.0;    // seconds, host steady clock when the report arrived
+
+    float temperature_css;
+    float temperature_mss;
+    float temperature_upa0;
+    float temperature_upa1;
+
+    float cpu_usage_leon_os;
+    float cpu_usage_leon_rt;
+
+    float ddr_used;
+    float ddr_total;
+    float cmx_used;
+    float cmx_total;
+
+    DeviceTelemetry();
+
+    // highest of the reported temperatures, NaN if none is reported
+    float maxTemperature() const;
+};
+
+enum class TelemetryMetric
+{
+    TEMPERATURE_MAX,
+    TEMPERATURE_CSS,
+    TEMPERATURE_MSS,
+    TEMPERATURE_UPA0,
+    TEMPERATURE_UPA1,
+    CPU_USAGE_LEON_OS,
+    CPU_USAGE_LEON_RT,
+    DDR_USAGE,          // used / total, [0 .. 1]
+    CMX_USAGE,          // used / total, [0 .. 1]
+};
+
+float get_telemetry_metric(const DeviceTelemetry &telemetry, TelemetryMetric metric);
+
+// Called with above == true when the metric reaches the threshold, and with
+// above == false once it drops below threshold - hysteresis.
+using TelemetryThresholdCallback = std::function<void(TelemetryMetric metric, float value, bool above)>;
+
+
+constexpr size_t c_max_device_log_length = 512;
+
+// Parses a meta_d2h json report without building a DOM and without allocating.
+// Strings of the "logs" array are passed to on_log, unescaped and truncated to
+// c_max_device_log_length; the pointer is valid only during the call.
+// Returns false if the json is malformed, fields parsed so far are kept.
+bool parse_device_telemetry(
+    const char *json, size_t size,
+    DeviceTelemetry &telemetry,
+    const std::function<void(const char *log, size_t length)> &on_log
+);
+
+
+// Time series of the device telemetry, written from the XLink thread
+class DeviceTelemetryMonitor
+{
+public:
+    static constexpr int c_history_size = 1024;
+
+    DeviceTelemetryMonitor();
+
+    void add(const DeviceTelemetry &telemetry);
+
+    // false if no report was received yet
+    bool getLatest(DeviceTelemetry &telemetry);
+    // oldest first, up to c_history_size reports
+    std::vector<DeviceTelemetry> getHistory();
+    void clear();
+
+    // Callbacks run on the XLink thread, they must not add or remove thresholds
+    int addThreshold(TelemetryMetric metric, float threshold, float hysteresis, TelemetryThresholdCallback callback);
+    void removeThreshold(int id);
+
+private:
+    struct Threshold
+    {
+        int                        id;
+        TelemetryMetric            metric;
+        float                      threshold;
+        float                      hysteresis;
+        bool                       above;
+        TelemetryThresholdCallback callback;
+    };
+
+    std::mutex                   _history_mutex;
+    std::vector<DeviceTelemetry> _history;        // ring, preallocated
+    size_t                       _history_next  = 0;
+    size_t                       _history_count = 0;
+
+    std::mutex                   _thresholds_mutex;
+    std::vector<Threshold>       _thresholds;
+    int                          _next_threshold_id = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+// Storage of HostDataPacket frames. Buffers of 4 KiB and more start on a
+// c_frame_alignment boundary, so SIMD kernels need no unaligned head, and
+// large ones can be backed by huge pages to reduce TLB misses on 4K frames.
+// Smaller blocks, the container nodes, get a malloc sized header only.
+//
+// With FrameAllocConfig::recycle freed blocks are kept in per size class free
+// lists and reused, up to recycle_max_bytes, so a steady stream of packets
+// does not touch the heap.
+// The library containers on the frame path use FrameAllocator for the same
+// reason, see HostPipeline::enableRealtime().
+
+static constexpr size_t c_frame_alignment = 64;
+
+enum class FrameHugePages
+{
+    OFF,
+    TRANSPARENT,    // 2 MiB aligned, madvise(MADV_HUGEPAGE), needs THP "madvise" or "always"
+    EXPLICIT,       // MAP_HUGETLB from the reserved pool, falls back to TRANSPARENT when it is empty
+};
+
+struct FrameAllocConfig
+{
+    FrameHugePages huge_pages = FrameHugePages::OFF;
+    size_t huge_page_min_size = 2 * 1024 * 1024;   // smaller buffers use the heap
+    bool   recycle = false;                         // keep freed blocks for reuse, false frees the kept ones
+    size_t recycle_max_bytes = 256 * 1024 * 1024;   // kept at most, further freed blocks go to the heap
+};
+
+struct FramePoolStats
+{
+    uint64_t hits = 0;          // allocations served from the free lists
+    uint64_t misses = 0;        // allocations that went to the heap while recycling
+    size_t   cached_bytes = 0;  // in the free lists
+    uint64_t released = 0;      // freed blocks that didn't fit recycle_max_bytes or a free list
+};
+
+// Applies to buffers allocated later, Linux only for huge pages
+void set_frame_alloc_config(const FrameAllocConfig &config);
+FrameAllocConfig get_frame_alloc_config();
+
+// c_frame_alignment aligned from 4 KiB, nullptr on failure
+void* frame_alloc(size_t size);
+void frame_free(void *data);
+
+// Preallocates count blocks for allocations of size bytes, used with recycle,
+// not limited by recycle_max_bytes
+void frame_pool_reserve(size_t size, size_t count);
+// Frees the kept blocks
+void frame_pool_trim();
+FramePoolStats get_frame_pool_stats();
+
+
+template<typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+
+    FrameAllocator() = default;
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        void *data = frame_alloc(n * sizeof(T));
+        if (data == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(data);
+    }
+
+    void deallocate(T *data, size_t) { frame_free(data); }
+};
+
+template<typename T, typename U>
+bool operator==(const FrameAllocator<T>&, const FrameAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const FrameAllocator<T>&, const FrameAllocator<U>&) { return false; }
+
+using FrameBuffer = std::vector<unsigned char, FrameAllocator<unsigned char>>;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "depthai/frame_allocator.hpp"
+#include "depthai/host_data_packet.hpp"
+
+
+struct FrameBudgetStats
+{
+    size_t   limit_bytes = 0;       // 0: unlimited
+    size_t   used_bytes = 0;
+    size_t   high_water_bytes = 0;
+    uint64_t admitted = 0;
+    uint64_t evicted = 0;           // queued packets removed for newer or higher priority ones
+    uint64_t denied = 0;            // packets not queued, only higher priority packets were queued
+};
+
+// Process wide byte limit for the packets queued by all HostPipelines.
+//
+// A packet that doesn't fit evicts queued packets of the same or a lower
+// stream priority, lowest priority first and oldest first within a priority.
+// When only higher priority packets are queued the new packet is denied
+// instead, the budget is never exceeded.
+//
+// Only the HostPipeline queue is charged. Packets referenced elsewhere, by
+// PacketCursors, Mp4Writer, StreamServer or the application, are not, they
+// are bounded by the queue sizes of those consumers. Without a limit
+// packets are not tracked and admit() takes no lock, the stats then count
+// only the packets admitted while a limit was set.
+class FrameBudget
+{
+public:
+    // Queue that holds admitted packets
+    class Queue
+    {
+    public:
+        // Removes packet if it is still queued, called with the budget locked.
+        // false if a consumer already took it, it is then released by the consumer
+        virtual bool evictQueued(const HostDataPacket *packet) = 0;
+
+    protected:
+        ~Queue() = default;
+    };
+
+    static FrameBudget& instance();
+
+    // 0 disables the limit, queued packets over a lower limit are evicted
+    // by the next admit()
+    void setLimit(size_t bytes);
+    size_t getLimit();
+
+    // Higher priority packets are kept longer, default 0
+    void setStreamPriority(const std::string &stream_name, int priority);
+    int getStreamPriority(const std::string &stream_name);
+
+    // Charges packet to queue, evicting as described above, and calls
+    // enqueue with the budget locked, without a limit it only calls enqueue.
+    // enqueue must not call the budget.
+    // Returns false if the packet was denied or enqueue returned false.
+    bool admit(Queue &queue, const std::shared_ptr<HostDataPacket> &packet, const std::function<bool()> &enqueue);
+
+    // Packet left its queue, called after the queue pop while the caller
+    // still holds the packet, so its address can't be reused meanwhile
+    void release(const HostDataPacket *packet);
+    // Queue is destroyed, releases all its packets
+    void releaseQueue(Queue &queue);
+
+    FrameBudgetStats getStats();
+
+private:
+    FrameBudget() = default;
+
+    using EvictionKey = std::pair<int, uint64_t>;   // priority, admission order
+
+    struct Entry
+    {
+        Queue *queue;
+        size_t bytes;
+        EvictionKey key;
+    };
+
+    // nodes from FrameAllocator, recycled on the frame path
+    using Entries = std::unordered_map<const HostDataPacket*, Entry, std::hash<const HostDataPacket*>,
+                                       std::equal_to<const HostDataPacket*>,
+                                       FrameAllocator<std::pair<const HostDataPacket* const, Entry>>>;
+    using EvictionOrder = std::map<EvictionKey, const HostDataPacket*, std::less<EvictionKey>,
+                                   FrameAllocator<std::pair<const EvictionKey, const HostDataPacket*>>>;
+
+    void erase(Entries::iterator entry);
+
+    std::atomic<size_t> _limit_bytes{0};        // _stats.limit_bytes, for the unlimited fast path
+    std::atomic<size_t> _tracked_packets{0};    // _entries.size(), raised before the packet is queued
+
+    std::mutex _mutex;
+    std::map<std::string, int> _stream_priorities;
+    Entries _entries;
+    EvictionOrder _eviction_order;
+    uint64_t _next_admission = 0;
+    FrameBudgetStats _stats;
+};
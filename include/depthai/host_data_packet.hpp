@@ -4,8 +4,10 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include <functional>
 #include <memory>
 #include <numeric>
+#include <string>
 #include <vector>
 
 #include "boost/optional.hpp"
@@ -16,22 +18,63 @@
 #include "depthai-shared/object_tracker/object_tracker.hpp"
 #include "depthai-shared/stream/stream_info.hpp"
 
+#include "frame_allocator.hpp"
+#include "video_frame_info.hpp"
+
+
+// Application memory for the data of one frame, see HostPipeline::setBufferProvider()
+struct FrameDestination
+{
+    unsigned char *data = nullptr;
+    std::function<void()> release;  // called when the packet is destroyed, may be empty
+};
+
+// Fills destination with size bytes for a frame of stream_name, false to use
+// a library buffer. Called on the stream thread.
+using FrameBufferProvider = std::function<bool(const std::string &stream_name, size_t size, FrameDestination &destination)>;
+
 
 struct HostDataPacket
 {
     HostDataPacket(
         unsigned size,
         void* in_data,
-        StreamInfo streamInfo
+        StreamInfo streamInfo,
+        const FrameBufferProvider &provider = nullptr
+    )
+    {
+        assign(size, in_data, streamInfo, provider);
+    }
+
+    // Empty packet for a pool, filled by assign()
+    HostDataPacket()
+        : elem_size(0)
+    {}
+
+    // Fills the packet with a device packet. A recycled packet keeps the
+    // capacity of its buffers, so refilling it does not allocate once it saw
+    // a packet of the same size. dims, if given, replaces
+    // streamInfo.getDimensionsForSize().
+    void assign(
+        unsigned size,
+        const void* in_data,
+        const StreamInfo &streamInfo,
+        const FrameBufferProvider &provider = nullptr,
+        const std::vector<int> *dims = nullptr
     )
-        : stream_name(streamInfo.name)
-        , elem_size(streamInfo.elem_size)
     {
+        stream_name.assign(streamInfo.name);
+        elem_size = streamInfo.elem_size;
+        opt_metadata = boost::none;
+        video_info = nullptr;
+        external_data = nullptr;
+        external_size = 0;
+
         int frameSize = size;
 
         FrameMetadata metadata;
         // Copy metadata structure from end of packet
-        memcpy( &metadata, ((uint8_t*) in_data) + size - sizeof(FrameMetadata), sizeof(FrameMetadata) );
+        memcpy( &metadata, ((const uint8_t*) in_data) + size - sizeof(FrameMetadata), sizeof(FrameMetadata) );
         // Check if metadata is valid
         if(metadata.isValid()){
             
@@ -52,24 +95,101 @@ struct HostDataPacket
 
 
         // set dimensions
-        dimensions = streamInfo.getDimensionsForSize(frameSize);
+        if (dims != nullptr)
+        {
+            dimensions.assign(dims->begin(), dims->end());
+        }
+        else
+        {
+            StreamInfo info = streamInfo;
+            dimensions = info.getDimensionsForSize(frameSize);
+        }
 
-        std::uint8_t* pData = (std::uint8_t*) in_data;
+        const std::uint8_t* pData = (const std::uint8_t*) in_data;
 
-        // Regular copy (1 allocation only)
-        data = std::make_shared<std::vector<std::uint8_t>>(pData, pData + frameSize);
+        FrameDestination destination;
+        const bool provided = provider && provider(stream_name, frameSize, destination);
+        if (provided && destination.data == nullptr && destination.release)
+        {
+            // nothing to copy into, the provider still gets its release
+            destination.release();
+        }
+
+        if (provided && destination.data != nullptr)
+        {
+            // the only copy, straight into application memory
+            memcpy(destination.data, pData, frameSize);
+            if (data && data.use_count() == 1)
+            {
+                // recycled packet, the buffer keeps its capacity for the next library copy
+                data->clear();
+            }
+            else
+            {
+                data = nullptr;
+            }
+            external_data = std::shared_ptr<unsigned char>(destination.data,
+                                                           ReleaseDestination{std::move(destination.release)},
+                                                           FrameAllocator<unsigned char>());
+            external_size = frameSize;
+        }
+        else if (data && data.use_count() == 1)
+        {
+            // recycled packet, nobody else sees the buffer
+            data->assign(pData, pData + frameSize);
+        }
+        else
+        {
+            // Regular copy (1 allocation only)
+            data = std::allocate_shared<FrameBuffer>(FrameAllocator<FrameBuffer>(), pData, pData + frameSize);
+        }
 
         constructor_timer = Timer();
     }
 
-    unsigned size()
+    // Packet produced on the host, takes the buffer without copying
+    HostDataPacket(
+        const std::string &name,
+        std::shared_ptr<FrameBuffer> buffer,
+        const std::vector<int> &dims,
+        int elem_size_,
+        const boost::optional<FrameMetadata> &metadata
+    )
+        : opt_metadata(metadata)
+        , data(std::move(buffer))
+        , stream_name(name)
+        , dimensions(dims)
+        , elem_size(elem_size_)
+    {}
+
+    unsigned size() const
     {
-        return data->size();
+        if (external_data)
+        {
+            return external_size;
+        }
+        return data ? data->size() : 0;
     }
 
+    // Aligned to c_frame_alignment (64 bytes) from 4 KiB, see FrameAllocator.
+    // Frames in application buffers keep the alignment of the application.
     const unsigned char* getData() const
     {
-        return data->data();
+        if (external_data)
+        {
+            return external_data.get();
+        }
+        return data ? data->data() : nullptr;
+    }
+
+    // Keeps the frame data alive, for aliasing shared_ptrs
+    std::shared_ptr<const void> getDataOwner() const
+    {
+        if (external_data)
+        {
+            return external_data;
+        }
+        return data;
     }
 
     std::string getDataAsString()
@@ -90,8 +210,25 @@ struct HostDataPacket
         return ot_tracklets;
     }
 
+private:
+    struct ReleaseDestination
+    {
+        std::function<void()> release;
+        void operator()(unsigned char*) const
+        {
+            if (release)
+            {
+                release();
+            }
+        }
+    };
+
+public:
     boost::optional<FrameMetadata> opt_metadata;
-    std::shared_ptr<std::vector<unsigned char>> data;
+    std::shared_ptr<const VideoFrameInfo> video_info; // encoded video streams, set by NalParser
+    std::shared_ptr<FrameBuffer> data;              // empty or nullptr if the frame is in an application buffer
+    std::shared_ptr<unsigned char> external_data;   // FrameDestination, released with the last reference
+    size_t external_size = 0;
     std::string stream_name;
     std::vector<int> dimensions;
     int elem_size;
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rectification_mesh.hpp"
+
+
+// Precomputed fixed-point remap table for 8-bit single channel images.
+// Each destination pixel stores the offset of its top-left source pixel and
+// 7-bit bilinear weights. Pixels mapped outside the source image are set to 0.
+class RemapTable
+{
+public:
+    static constexpr int c_frac_bits = 7;
+
+    // Builds the table for a width x height image, source and destination have the same size
+    void init(const RectificationModel &model, int width, int height);
+
+    bool matches(int width, int height) const { return _width == width && _height == height; }
+
+    // src and dst are width x height, tightly packed. Rows are processed in parallel
+    void remap(const uint8_t *src, uint8_t *dst) const;
+
+private:
+    int _width  = 0;
+    int _height = 0;
+
+    std::vector<int32_t>  _offset;
+    std::vector<uint16_t> _wx;
+    std::vector<uint16_t> _wy;
+    std::vector<uint8_t>  _mask;
+
+    void remapRows(const uint8_t *src, uint8_t *dst, int row_begin, int row_end) const;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DEPTHAI_PRINTF_FORMAT(fmt_idx, args_idx) __attribute__((format(printf, fmt_idx, args_idx)))
+#else
+#define DEPTHAI_PRINTF_FORMAT(fmt_idx, args_idx)
+#endif
+
+
+enum class LogLevel
+{
+    debug = 0,
+    info,
+    warn,
+    error,
+    off
+};
+
+
+// Asynchronous logger, safe to use from the XLink reader threads.
+//
+// log() formats the message into a preallocated slot of a bounded lock-free
+// ring buffer, a background thread writes the messages out. When the ring is
+// full the message is dropped and counted instead of blocking the caller.
+//
+// count() is for events that can repeat at frame rate: occurrences are only
+// counted and reported once per aggregation period, e.g.
+// "dropped 412 previewout frames in last 1s". A slot that saw no occurrence
+// in a whole period is freed for other events.
+//
+// The level is read from $DEPTHAI_LOG_LEVEL (debug, info, warn, error, off),
+// default is info. Messages below warn go to stdout, the rest to stderr.
+class Logger
+{
+public:
+    using Sink = std::function<void(LogLevel level, const char *message)>;
+
+    static constexpr int c_ring_size          = 1024; // power of 2
+    static constexpr int c_message_size       = 256;  // longer messages are allocated on the heap
+    static constexpr int c_aggregate_slots    = 64;
+    static constexpr int c_aggregate_key_size = 48;
+
+    static Logger& instance();
+
+    void setLevel(LogLevel level) { _level.store(level, std::memory_order_relaxed); }
+    LogLevel getLevel() const { return _level.load(std::memory_order_relaxed); }
+    bool isEnabled(LogLevel level) const { return level != LogLevel::off && level >= getLevel(); }
+
+    void log(LogLevel level, const char *format, ...) DEPTHAI_PRINTF_FORMAT(3, 4);
+    void vlog(LogLevel level, const char *format, va_list args);
+
+    // format takes the number of occurrences (%u) followed by subject (%s).
+    // format must have static storage duration, subject is copied (truncated).
+    void count(LogLevel level, const char *format, const char *subject);
+
+    void setAggregationPeriod(std::chrono::milliseconds period);
+
+    // Replaces the stdout/stderr output, called from the logger thread
+    void setSink(Sink sink);
+
+    // Blocks until everything logged before the call is written out
+    void flush();
+
+    // Stops the logger thread, later messages are written synchronously.
+    // Called at exit.
+    void shutdown();
+
+private:
+    Logger();
+
+    struct Message
+    {
+        std::atomic<size_t> sequence;
+        LogLevel            level;
+        std::string        *long_text; // set when the text does not fit
+        char                text[c_message_size];
+    };
+
+    struct Aggregate
+    {
+        std::atomic<uint64_t> key;
+        std::atomic<bool>     ready;
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> users;    // count() calls reading the slot, it is not freed meanwhile
+        LogLevel              level;
+        const char           *format;
+        char                  subject[c_aggregate_key_size];
+    };
+
+    std::atomic<LogLevel> _level;
+
+    std::unique_ptr<Message[]> _ring;
+    std::atomic<size_t>        _enqueue_pos;
+    size_t                     _dequeue_pos = 0;   // logger thread only
+    std::atomic<uint32_t>      _dropped_messages;
+
+    std::unique_ptr<Aggregate[]> _aggregates;
+    std::atomic<int64_t>         _aggregation_period_ms;
+
+    std::mutex              _sink_mutex;
+    Sink                    _sink;
+
+    std::mutex              _thread_mutex;
+    std::condition_variable _wake_cv;
+    std::condition_variable _flushed_cv;
+    bool                    _wake     = false;
+    bool                    _stop     = false;
+    size_t                  _written_pos = 0;
+    std::atomic<bool>       _synchronous;
+    std::thread             _thread;
+
+    void threadLoop();
+    bool writeNext();
+    void writeAggregates();
+    void write(LogLevel level, const char *text);
+    void wake();
+};
+
+
+void log_debug(const char *format, ...) DEPTHAI_PRINTF_FORMAT(1, 2);
+void log_info(const char *format, ...) DEPTHAI_PRINTF_FORMAT(1, 2);
+void log_warn(const char *format, ...) DEPTHAI_PRINTF_FORMAT(1, 2);
+void log_error(const char *format, ...) DEPTHAI_PRINTF_FORMAT(1, 2);
@@ -2,6 +2,11 @@
 
 #include <vector>
 
+#include "matrix_types.hpp"
+
+// std::vector based API, kept for compatibility.
+// 3x3 and 4x4 inputs are forwarded to Mat3f / Mat4f.
+
 std::vector<std::vector<float>> mat_mul(std::vector<std::vector<float>>& firstMatrix, 
                                         std::vector<std::vector<float>>& secondMatrix);
 
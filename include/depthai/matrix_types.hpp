@@ -0,0 +1,328 @@
+#pragma once
+
+// Fixed-size float matrices for calibration data and per-pixel reprojection.
+// Rows are padded to 4 floats and 16 byte aligned, so that a row maps to
+// one SSE / NEON register. Padding elements are always 0.
+
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define DEPTHAI_MATRIX_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTHAI_MATRIX_NEON
+#endif
+
+
+struct Vec3f
+{
+    alignas(16) float v[4];
+
+    constexpr Vec3f() : v{0.f, 0.f, 0.f, 0.f} {}
+    constexpr Vec3f(float x, float y, float z) : v{x, y, z, 0.f} {}
+
+    constexpr float x() const { return v[0]; }
+    constexpr float y() const { return v[1]; }
+    constexpr float z() const { return v[2]; }
+
+    constexpr const float& operator[](int i) const { return v[i]; }
+    float& operator[](int i) { return v[i]; }
+
+    static Vec3f fromVector(const std::vector<float> &vec)
+    {
+        return Vec3f(vec.at(0), vec.at(1), vec.at(2));
+    }
+
+    std::vector<float> toVector() const
+    {
+        return {v[0], v[1], v[2]};
+    }
+};
+
+
+struct Mat3f
+{
+    alignas(16) float m[3][4];
+
+    constexpr Mat3f() : m{{0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}} {}
+    constexpr Mat3f(
+        float a00, float a01, float a02,
+        float a10, float a11, float a12,
+        float a20, float a21, float a22
+    )
+        : m{{a00, a01, a02, 0.f}, {a10, a11, a12, 0.f}, {a20, a21, a22, 0.f}}
+    {}
+
+    static constexpr Mat3f identity()
+    {
+        return Mat3f(1.f, 0.f, 0.f,
+                     0.f, 1.f, 0.f,
+                     0.f, 0.f, 1.f);
+    }
+
+    // data must hold 9 floats, row-major
+    static Mat3f fromRowMajor(const float *data)
+    {
+        return Mat3f(data[0], data[1], data[2],
+                     data[3], data[4], data[5],
+                     data[6], data[7], data[8]);
+    }
+
+    static Mat3f fromVector(const std::vector<std::vector<float>> &mat)
+    {
+        Mat3f res;
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                res.m[r][c] = mat.at(r).at(c);
+        return res;
+    }
+
+    std::vector<std::vector<float>> toVector() const
+    {
+        return {
+            {m[0][0], m[0][1], m[0][2]},
+            {m[1][0], m[1][1], m[1][2]},
+            {m[2][0], m[2][1], m[2][2]},
+        };
+    }
+
+    constexpr float operator()(int r, int c) const { return m[r][c]; }
+    float& operator()(int r, int c) { return m[r][c]; }
+
+    constexpr float determinant() const
+    {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+             - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    constexpr Mat3f transposed() const
+    {
+        return Mat3f(m[0][0], m[1][0], m[2][0],
+                     m[0][1], m[1][1], m[2][1],
+                     m[0][2], m[1][2], m[2][2]);
+    }
+};
+
+
+struct Mat4f
+{
+    alignas(16) float m[4][4];
+
+    constexpr Mat4f() : m{{0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}, {0.f, 0.f, 0.f, 0.f}} {}
+    constexpr Mat4f(
+        float a00, float a01, float a02, float a03,
+        float a10, float a11, float a12, float a13,
+        float a20, float a21, float a22, float a23,
+        float a30, float a31, float a32, float a33
+    )
+        : m{{a00, a01, a02, a03}, {a10, a11, a12, a13}, {a20, a21, a22, a23}, {a30, a31, a32, a33}}
+    {}
+
+    static constexpr Mat4f identity()
+    {
+        return Mat4f(1.f, 0.f, 0.f, 0.f,
+                     0.f, 1.f, 0.f, 0.f,
+                     0.f, 0.f, 1.f, 0.f,
+                     0.f, 0.f, 0.f, 1.f);
+    }
+
+    // [R | T] with bottom row [0 0 0 1]
+    static Mat4f fromRotationTranslation(const Mat3f &R, const Vec3f &T)
+    {
+        return Mat4f(R.m[0][0], R.m[0][1], R.m[0][2], T.v[0],
+                     R.m[1][0], R.m[1][1], R.m[1][2], T.v[1],
+                     R.m[2][0], R.m[2][1], R.m[2][2], T.v[2],
+                     0.f,       0.f,       0.f,       1.f);
+    }
+
+    static Mat4f fromVector(const std::vector<std::vector<float>> &mat)
+    {
+        Mat4f res;
+        for (int r = 0; r < 4; r++)
+            for (int c = 0; c < 4; c++)
+                res.m[r][c] = mat.at(r).at(c);
+        return res;
+    }
+
+    std::vector<std::vector<float>> toVector() const
+    {
+        return {
+            {m[0][0], m[0][1], m[0][2], m[0][3]},
+            {m[1][0], m[1][1], m[1][2], m[1][3]},
+            {m[2][0], m[2][1], m[2][2], m[2][3]},
+            {m[3][0], m[3][1], m[3][2], m[3][3]},
+        };
+    }
+
+    constexpr float operator()(int r, int c) const { return m[r][c]; }
+    float& operator()(int r, int c) { return m[r][c]; }
+};
+
+
+inline Mat3f mat_mul(const Mat3f &a, const Mat3f &b)
+{
+    Mat3f res;
+#if defined(DEPTHAI_MATRIX_SSE)
+    const __m128 b0 = _mm_load_ps(b.m[0]);
+    const __m128 b1 = _mm_load_ps(b.m[1]);
+    const __m128 b2 = _mm_load_ps(b.m[2]);
+    for (int r = 0; r < 3; r++)
+    {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a.m[r][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][2]), b2));
+        _mm_store_ps(res.m[r], row);
+    }
+#elif defined(DEPTHAI_MATRIX_NEON)
+    const float32x4_t b0 = vld1q_f32(b.m[0]);
+    const float32x4_t b1 = vld1q_f32(b.m[1]);
+    const float32x4_t b2 = vld1q_f32(b.m[2]);
+    for (int r = 0; r < 3; r++)
+    {
+        float32x4_t row = vmulq_n_f32(b0, a.m[r][0]);
+        row = vmlaq_n_f32(row, b1, a.m[r][1]);
+        row = vmlaq_n_f32(row, b2, a.m[r][2]);
+        vst1q_f32(res.m[r], row);
+    }
+#else
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            res.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c];
+#endif
+    return res;
+}
+
+inline Vec3f mat_mul(const Mat3f &a, const Vec3f &v)
+{
+    Vec3f res;
+#if defined(DEPTHAI_MATRIX_SSE)
+    __m128 p0 = _mm_mul_ps(_mm_load_ps(a.m[0]), _mm_load_ps(v.v));
+    __m128 p1 = _mm_mul_ps(_mm_load_ps(a.m[1]), _mm_load_ps(v.v));
+    __m128 p2 = _mm_mul_ps(_mm_load_ps(a.m[2]), _mm_load_ps(v.v));
+    __m128 p3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    _mm_store_ps(res.v, _mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
+#else
+    for (int r = 0; r < 3; r++)
+        res.v[r] = a.m[r][0] * v.v[0] + a.m[r][1] * v.v[1] + a.m[r][2] * v.v[2];
+#endif
+    return res;
+}
+
+inline Mat4f mat_mul(const Mat4f &a, const Mat4f &b)
+{
+    Mat4f res;
+#if defined(DEPTHAI_MATRIX_SSE)
+    const __m128 b0 = _mm_load_ps(b.m[0]);
+    const __m128 b1 = _mm_load_ps(b.m[1]);
+    const __m128 b2 = _mm_load_ps(b.m[2]);
+    const __m128 b3 = _mm_load_ps(b.m[3]);
+    for (int r = 0; r < 4; r++)
+    {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a.m[r][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a.m[r][3]), b3));
+        _mm_store_ps(res.m[r], row);
+    }
+#elif defined(DEPTHAI_MATRIX_NEON)
+    const float32x4_t b0 = vld1q_f32(b.m[0]);
+    const float32x4_t b1 = vld1q_f32(b.m[1]);
+    const float32x4_t b2 = vld1q_f32(b.m[2]);
+    const float32x4_t b3 = vld1q_f32(b.m[3]);
+    for (int r = 0; r < 4; r++)
+    {
+        float32x4_t row = vmulq_n_f32(b0, a.m[r][0]);
+        row = vmlaq_n_f32(row, b1, a.m[r][1]);
+        row = vmlaq_n_f32(row, b2, a.m[r][2]);
+        row = vmlaq_n_f32(row, b3, a.m[r][3]);
+        vst1q_f32(res.m[r], row);
+    }
+#else
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            res.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+#endif
+    return res;
+}
+
+inline Mat3f operator*(const Mat3f &a, const Mat3f &b) { return mat_mul(a, b); }
+inline Vec3f operator*(const Mat3f &a, const Vec3f &v) { return mat_mul(a, v); }
+inline Mat4f operator*(const Mat4f &a, const Mat4f &b) { return mat_mul(a, b); }
+
+
+// Closed-form inverse (adjugate / determinant), returns false if matrix is singular
+inline bool mat_inv(const Mat3f &a, Mat3f &inverse)
+{
+    const float det = a.determinant();
+    if (det == 0.f)
+    {
+        return false;
+    }
+    const float inv_det = 1.f / det;
+
+    inverse = Mat3f(
+        (a.m[1][1] * a.m[2][2] - a.m[1][2] * a.m[2][1]) * inv_det,
+        (a.m[0][2] * a.m[2][1] - a.m[0][1] * a.m[2][2]) * inv_det,
+        (a.m[0][1] * a.m[1][2] - a.m[0][2] * a.m[1][1]) * inv_det,
+        (a.m[1][2] * a.m[2][0] - a.m[1][0] * a.m[2][2]) * inv_det,
+        (a.m[0][0] * a.m[2][2] - a.m[0][2] * a.m[2][0]) * inv_det,
+        (a.m[0][2] * a.m[1][0] - a.m[0][0] * a.m[1][2]) * inv_det,
+        (a.m[1][0] * a.m[2][1] - a.m[1][1] * a.m[2][0]) * inv_det,
+        (a.m[0][1] * a.m[2][0] - a.m[0][0] * a.m[2][1]) * inv_det,
+        (a.m[0][0] * a.m[1][1] - a.m[0][1] * a.m[1][0]) * inv_det
+    );
+    return true;
+}
+
+// Closed-form inverse using 2x2 sub-determinants, returns false if matrix is singular
+inline bool mat_inv(const Mat4f &a, Mat4f &inverse)
+{
+    const float (&m)[4][4] = a.m;
+
+    const float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    const float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    const float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    const float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    const float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    const float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    const float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    const float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    const float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    const float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    const float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    const float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (det == 0.f)
+    {
+        return false;
+    }
+    const float inv_det = 1.f / det;
+
+    inverse = Mat4f(
+        ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv_det,
+        (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv_det,
+        ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv_det,
+        (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv_det,
+
+        (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv_det,
+        ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv_det,
+        (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv_det,
+        ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv_det,
+
+        ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv_det,
+        (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv_det,
+        ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv_det,
+        (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv_det,
+
+        (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv_det,
+        ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv_det,
+        (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv_det,
+        ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv_det
+    );
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host_data_packet.hpp"
+#include "video_frame_info.hpp"
+
+
+struct Mp4WriterConfig
+{
+    // printf pattern with the segment index, e.g. "video_%04u.mp4". Without
+    // a pattern the index is added before the extension, to every segment
+    // with rotation, else to the files started after a write error
+    std::string path = "video.mp4";
+    int width = 1920;                   // used when the SPS size can't be parsed
+    int height = 1080;
+    float fps = 30.f;                   // sample timing of packets without FrameMetadata
+    double fragment_duration_s = 1.0;   // a fragment starts at every keyframe, or after this
+    double segment_duration_s = 0.0;    // 0: single file, else rotate at the next keyframe
+};
+
+// Fragmented MP4 (ISO BMFF) writer for H.264 / H.265 packets tagged by
+// NalParser. Samples are timed from the FrameMetadata device timestamps.
+// Packets are only referenced: a fragment is collected on the stream thread
+// and written with vectored I/O straight from the packet buffers on a writer
+// thread. At most one finished fragment waits for the writer, if the writer
+// falls behind the next fragment is dropped and writing resumes at a keyframe.
+//
+//   auto writer = std::make_shared<Mp4Writer>(config);
+//   pipeline->addPacketListener("video",
+//       [writer](const std::shared_ptr<HostDataPacket> &p) { writer->onPacket(p); });
+class Mp4Writer
+{
+public:
+    explicit Mp4Writer(const Mp4WriterConfig &config);
+    ~Mp4Writer();
+
+    Mp4Writer(const Mp4Writer&) = delete;
+    Mp4Writer& operator=(const Mp4Writer&) = delete;
+
+    void onPacket(const std::shared_ptr<HostDataPacket> &packet);
+
+    // Writes the last fragment and closes the file, packets are ignored afterwards
+    void stop();
+
+    uint64_t getWrittenBytes() const { return _written_bytes; }
+    uint64_t getWrittenFragments() const { return _written_fragments; }
+    uint64_t getDroppedFragments() const { return _dropped_fragments; }
+    // Fragments lost to file errors. After an error the writer skips the
+    // fragments up to the next keyframe, which starts a new segment file
+    uint64_t getFailedFragments() const { return _failed_fragments; }
+
+private:
+    struct Sample
+    {
+        std::shared_ptr<HostDataPacket> packet;
+        uint32_t duration;
+        uint32_t size;          // length prefixed NAL units
+        bool     keyframe;
+    };
+
+    struct Fragment
+    {
+        std::vector<Sample> samples;
+        uint64_t base_decode_time = 0;
+        bool     new_segment = false;      // opens file segment_index first
+        unsigned segment_index = 0;
+        std::shared_ptr<const VideoParameterSets> parameter_sets;
+    };
+
+    void closeFragment();
+    void writerThread();
+    bool writeFragment(Fragment &fragment);
+    bool openSegment(const Fragment &fragment);
+
+    const Mp4WriterConfig _config;
+    const uint32_t        _default_duration;
+
+    // stream thread state
+    std::unique_ptr<Fragment> _fragment;
+    bool     _started = false;
+    bool     _synced = false;           // waiting for a keyframe with parameter sets otherwise
+    bool     _need_segment = true;
+    bool     _stopped = false;
+    unsigned _segment_index = 0;
+    int64_t  _last_tick = 0;
+    uint64_t _decode_time = 0;          // since the segment start, 90 kHz
+    uint64_t _fragment_time = 0;        // duration of the current fragment
+    std::mutex _packet_mutex;
+
+    // writer thread
+    std::mutex                _mutex;
+    std::condition_variable   _cv;
+    std::unique_ptr<Fragment> _pending;
+    bool                      _quit = false;
+    std::thread               _thread;
+
+    int       _fd = -1;
+    uint32_t  _fragment_sequence = 0;
+    bool      _failed = false;          // until a new segment opens
+    std::atomic<bool> _resync;          // set after a write error, the stream thread starts a new segment
+
+    std::vector<uint8_t>  _header;      // moof + mdat header of the fragment being written
+    std::vector<uint32_t> _lengths;     // big endian NAL unit lengths
+
+    std::atomic<uint64_t> _written_bytes;
+    std::atomic<uint64_t> _written_fragments;
+    std::atomic<uint64_t> _dropped_fragments;
+    std::atomic<uint64_t> _failed_fragments;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "host_data_packet.hpp"
+#include "video_frame_info.hpp"
+
+
+// Position of the first Annex B start code (00 00 01, or 00 00 00 01) at or
+// after pos, size if there is none. start_code_size is set to 3 or 4.
+// SSE2 / NEON.
+size_t find_start_code(const uint8_t *data, size_t size, size_t pos, size_t &start_code_size);
+
+struct KeyframeIndexEntry
+{
+    uint64_t sequence;          // VideoFrameInfo::sequence of the keyframe packet
+    uint64_t stream_offset;     // VideoFrameInfo::stream_offset
+    double   timestamp;         // device timestamp [s], -1 without metadata
+};
+
+// Splits the packets of an encoded video stream into NAL units in place,
+// tags them with VideoFrameInfo and keeps an index of the recent keyframes.
+// parse() is called from the stream thread, getters are thread safe.
+class NalParser
+{
+public:
+    explicit NalParser(VideoCodec codec, size_t keyframe_index_capacity = 64);
+
+    // Codec of a video_config "profile", false if not H.264 / H.265 (e.g. mjpeg)
+    static bool getCodecFromProfile(const std::string &profile, VideoCodec &codec);
+
+    void parse(HostDataPacket &packet);
+
+    VideoCodec getCodec() const { return _codec; }
+    std::vector<KeyframeIndexEntry> getKeyframeIndex() const;
+    bool getLastKeyframe(KeyframeIndexEntry &entry) const;
+    std::shared_ptr<const VideoParameterSets> getParameterSets() const;
+
+private:
+    void parseNalUnit(const uint8_t *data, size_t offset, size_t size, VideoFrameInfo &info);
+    VideoFrameType parseSliceType(const uint8_t *nal, size_t size, uint8_t type);
+
+    const VideoCodec _codec;
+    const size_t     _keyframe_index_capacity;
+
+    // H.265 num_extra_slice_header_bits per PPS id, needed to reach slice_type
+    uint8_t _pps_extra_slice_header_bits[64] = {};
+
+    uint64_t _sequence = 0;
+    uint64_t _stream_offset = 0;
+
+    mutable std::mutex _mutex;
+    std::deque<KeyframeIndexEntry> _keyframe_index;
+    std::shared_ptr<const VideoParameterSets> _parameter_sets;
+
+    // parameter sets changed by the packet being parsed, parse thread only
+    std::shared_ptr<VideoParameterSets> _pending_sets;
+};
@@ -45,10 +45,11 @@ public:
                 throw std::runtime_error("getDetectedObjects should be used only when [\"NN_config\"][\"output_format\"] is set to detection! https://docs.luxonis.com/api/#creating-blob-configuration-file");
             }
         }
-        std::shared_ptr<std::vector<unsigned char>> data = _tensors_raw_data->data;
         //copy-less return, wrapped in shared_ptr
         std::shared_ptr<dai::Detections> detections;
-        detections = std::shared_ptr<dai::Detections>(data, reinterpret_cast<dai::Detections *>(data->data()));
+        detections = std::shared_ptr<dai::Detections>(
+            std::const_pointer_cast<void>(_tensors_raw_data->getDataOwner()),
+            reinterpret_cast<dai::Detections *>(const_cast<unsigned char *>(_tensors_raw_data->getData())));
         return detections;
     }
 
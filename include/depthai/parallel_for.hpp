@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+
+// Set to stop a parallel_for() early: ranges that did not start yet are
+// skipped, long running bodies may poll isCancelled() themselves.
+class ParallelForCancel
+{
+public:
+    void cancel() { _cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> _cancelled{false};
+};
+
+struct ParallelForConfig
+{
+    int  threads = 0;                   // including the calling thread, 0: hardware_concurrency, 1: serial
+    bool inline_when_saturated = true;  // no idle worker: run on the calling thread only
+};
+
+// Resizes the library owned pool, calls in progress complete
+void set_parallel_for_config(const ParallelForConfig &config);
+ParallelForConfig get_parallel_for_config();
+
+// Splits [begin, end) into contiguous ranges and runs body(range_begin, range_end)
+// for each of them on a shared work-stealing pool, the calling thread takes
+// part. Ranges are never smaller than min_range. Calls from inside a body run
+// inline. Returns when all ranges are done, false if cancel stopped it first.
+bool parallel_for(
+    int begin,
+    int end,
+    const std::function<void(int range_begin, int range_end)> &body,
+    int min_range = 1,
+    const ParallelForCancel *cancel = nullptr
+);
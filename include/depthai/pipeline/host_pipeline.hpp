@@ -1,7 +1,11 @@
 #pragma once
 
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <tuple>
@@ -11,7 +15,12 @@
 #include <boost/lockfree/spsc_queue.hpp>
 #include <boost/lockfree/queue.hpp>
 
+#include "depthai/allocation_hook.hpp"
+#include "depthai/frame_budget.hpp"
 #include "depthai/host_data_packet.hpp"
+#include "depthai/nal_parser.hpp"
+#include "depthai/ready_fd.hpp"
+#include "depthai/pipeline/packet_cursor.hpp"
 
 #include "depthai-shared/stream/stream_info.hpp"
 #include "depthai-shared/general/data_observer.hpp"
@@ -22,7 +31,12 @@
 
 class HostPipeline
     : public DataObserver<StreamInfo, StreamData>
+    , private FrameBudget::Queue
 {
+public:
+    // Called on the stream thread for every packet of a stream, before it is queued
+    using PacketListener = std::function<void(const std::shared_ptr<HostDataPacket>&)>;
+
 protected:
     const unsigned c_data_queue_size = 30;
 
@@ -32,17 +46,156 @@ protected:
     std::set<std::string> _public_stream_names;    // streams that are passed to public methods
     std::set<std::string> _observing_stream_names; // all streams that pipeline is subscribed
 
+    std::map<std::string, std::shared_ptr<NalParser>> _nal_parsers; // encoded video streams
+
+    // called without the lock, removePacketListener() waits for running calls
+    struct PacketListenerEntry
+    {
+        std::string       stream_name;
+        PacketListener    listener;
+        int               calls = 0;        // running, under _packet_listeners_mutex
+        std::atomic<bool> removed{false};
+    };
+    std::mutex _packet_listeners_mutex;
+    std::condition_variable _packet_listeners_cv;
+    std::map<int, std::shared_ptr<PacketListenerEntry>> _packet_listeners;
+    int _next_packet_listener_id = 0;
+
+    std::mutex _cursors_mutex;
+    std::map<std::string, std::shared_ptr<PacketCursor>> _cursors;
+
+    // shared, a provider runs without the lock and may replace itself
+    std::mutex _buffer_providers_mutex;
+    std::map<std::string, std::shared_ptr<const FrameBufferProvider>> _buffer_providers;
+    std::atomic<bool> _has_buffer_providers{false};
+
+    ReadyFd _ready_fd;
+
+    // enableRealtime()
+    struct PacketPool
+    {
+        std::mutex mutex;
+        std::vector<HostDataPacket*> free;  // reserved for all packets of the stream
+        int frame_size = -1;                // of dims, used by the stream thread only
+        std::vector<int> dims;
+
+        ~PacketPool();
+    };
+
+    // Deleter of pooled packets, returns them to their pool
+    struct PacketRecycler
+    {
+        std::shared_ptr<PacketPool> pool;
+        void operator()(HostDataPacket *packet) const;
+    };
+
+    size_t _realtime_packets_per_stream = 0;
+    std::mutex _packet_pools_mutex;
+    std::map<std::string, std::shared_ptr<PacketPool>> _packet_pools;
+
+    std::mutex _consume_mutex;
+    std::vector<std::shared_ptr<HostDataPacket>> _consume_buffer;
+
 public:
     using DataObserver<StreamInfo, StreamData>::observe;
 
 
     HostPipeline();
-    virtual ~HostPipeline() {}
+    virtual ~HostPipeline();
 
     std::list<std::shared_ptr<HostDataPacket>> getAvailableDataPackets(bool blocking = false);
 
+    // Becomes readable when packets are queued for getAvailableDataPackets()
+    // and consumePackets(), which reset it. For epoll (EPOLLET too) or poll
+    // loops, -1 if not supported. Per stream descriptors: a cursor with a
+    // stream name and PacketCursor::getReadyFd().
+    int getReadyFd() { return _ready_fd.getFd(); }
+
     void makeStreamPublic(const std::string& stream_name) { _public_stream_names.insert(stream_name); }
 
+    // Packets of stream_name get HostDataPacket::video_info, set before the stream is observed
+    void setNalParser(const std::string& stream_name, std::shared_ptr<NalParser> parser) { _nal_parsers[stream_name] = parser; }
+
+    // Frames of stream_name are copied from the XLink buffer straight into
+    // the memory returned by provider, the packet data points there until the
+    // last reference to the packet is dropped, then FrameDestination::release
+    // is called. nullptr removes the provider.
+    void setBufferProvider(const std::string& stream_name, FrameBufferProvider provider);
+
+    // Empty stream_name listens to all streams. Listeners of different
+    // streams run in parallel on their reader threads and may add or remove
+    // listeners. Returns id for removePacketListener(), which waits for the
+    // running calls of the listener, no calls are made once it returns.
+    // Called from a listener it doesn't wait, a running call may still finish.
+    int addPacketListener(const std::string& stream_name, PacketListener listener);
+    void removePacketListener(int id);
+
+    // Named consumer that gets the packets of stream_name (empty: all
+    // streams) independently of getAvailableDataPackets() and of other
+    // cursors. capacity is the queue size of CursorPolicy::ALL. Replaces an
+    // existing cursor of the same name.
+    std::shared_ptr<PacketCursor> addCursor(const std::string& name, CursorPolicy policy,
+                                            size_t capacity = 30, const std::string& stream_name = "");
+    std::shared_ptr<PacketCursor> getCursor(const std::string& name);
+    // Closes the cursor, blocked readers return
+    void removeCursor(const std::string& name);
+
+    // Allocation free steady state. Every stream observed afterwards gets
+    // packets_per_stream preallocated packets that are refilled in place,
+    // the containers on the frame path use FrameAllocator (enable
+    // FrameAllocConfig::recycle). Call before the streams are observed. The
+    // frame path is the packet reception, queueing and
+    // consumeAvailablePackets(), see FramePathScope. An empty pool is
+    // reported like a frame pool miss. The list returning getters, packet
+    // listeners and NalParser still allocate, they run outside the scopes.
+    void enableRealtime(size_t packets_per_stream);
+
+    // Calls callback(std::shared_ptr<HostDataPacket>&) for every queued
+    // packet, oldest first, without building a list. blocking waits for at
+    // least one packet.
+    template<typename Callback>
+    void consumeAvailablePackets(Callback &&callback, bool blocking = false)
+    {
+        std::lock_guard<std::mutex> lock(_consume_mutex);
+        {
+            FramePathScope frame_path;
+            _ready_fd.clear();
+            auto take = [this](std::shared_ptr<HostDataPacket> &packet)
+            {
+                _consume_buffer.push_back(std::move(packet));
+            };
+            if (blocking)
+            {
+                _data_queue_lf.waitAndConsumeAll(take);
+            }
+            else
+            {
+                _data_queue_lf.consumeAll(take);
+            }
+
+            // outside of the queue lock, admit() locks the budget first
+            FrameBudget &budget = FrameBudget::instance();
+            for (const auto &packet : _consume_buffer)
+            {
+                budget.release(packet.get());
+            }
+        }
+
+        try
+        {
+            for (auto &packet : _consume_buffer)
+            {
+                callback(packet);
+            }
+        }
+        catch (...)
+        {
+            _consume_buffer.clear();
+            throw;
+        }
+        _consume_buffer.clear();
+    }
+
     // TODO: temporary solution
     void consumePackets(bool blocking);
     std::list<std::shared_ptr<HostDataPacket>> getConsumedDataPackets();
@@ -52,4 +205,9 @@ private:
     virtual void onNewData(const StreamInfo& info, const StreamData& data) final;
     // from DataObserver<StreamInfo, StreamData>
     virtual void onNewDataSubject(const StreamInfo &info) final;
+    // from FrameBudget::Queue
+    virtual bool evictQueued(const HostDataPacket *packet) final;
+
+    void releaseConsumed(const std::list<std::shared_ptr<HostDataPacket>> &packets);
+    std::shared_ptr<HostDataPacket> makePacket(const StreamInfo& info, const StreamData& data);
 };
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "depthai-shared/json_helper.hpp"
+#include "depthai/frame_allocator.hpp"
+#include "depthai/thread_settings.hpp"
 
 
 struct HostPipelineConfig
@@ -12,6 +15,7 @@ struct HostPipelineConfig
         std::string name;
         std::string data_type;
         float       max_fps   = 0.f;
+        bool        downscale = false; // host converted streams (color_bgr, ...): half resolution
 
         StreamRequest(const std::string &name_) : name(name_) {}
     };
@@ -90,6 +94,20 @@ struct HostPipelineConfig
         bool sync_sequence_numbers = false;
         bool enable_reconfig = true; // Allow reopening config_d2h and config_h2d after the initial setup
         uint32_t usb_chunk_KiB = 64; // Increase to improve throughput, 0 to disable chunking
+        bool async_post_processing = false; // Host post processors run on their own threads, not on the XLink readers
+        uint32_t async_inbox_size = 4;      // Packets queued per post processor, the oldest is dropped
+        int parallel_for_threads = 0;       // Threads of the per pixel kernels including the caller, 0: one per core
+        uint32_t frame_budget_MiB = 0;      // Process wide limit of the queued packets, see FrameBudget, 0: unlimited
+        std::map<std::string, int> stream_priorities;   // FrameBudget eviction priority, higher is kept longer, default 0
+        FrameHugePages frame_huge_pages = FrameHugePages::OFF;  // "off", "transparent" or "explicit", frames >= 2 MiB
+        uint32_t realtime_packets_per_stream = 0;   // Preallocated packets, no heap allocation on the frame path, 0: off
+
+        // host side only, "threads": {"stream_reader": {"cpus": [2, 3], "fifo_priority": 10, "nice": 0, "name": "dai_rx"}, ...}
+        struct Threads {
+            ThreadSettings watchdog;
+            ThreadSettings stream_reader;
+            ThreadSettings post_processing;
+        } threads;
     } app_config;
 
     bool initWithJSON(const nlohmann::json &json_obj);
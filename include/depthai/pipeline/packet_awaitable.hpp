@@ -0,0 +1,426 @@
+#pragma once
+
+// Opt-in C++20 coroutine layer over HostPipeline. The library itself is built
+// as C++11, this header is self contained and only compiles to something in
+// translation units built with coroutine support:
+//
+//   PacketAwaitSource source(*pipeline, [&loop](std::coroutine_handle<> h) { loop.post(h); });
+//
+//   // one packet: the next one of the stream after the co_await
+//   std::shared_ptr<HostDataPacket> detections = co_await source.next("metaout");
+//
+//   // every packet: subscriptions queue the packets between two co_awaits
+//   auto frames = source.subscribe("previewout", 8);
+//   while (auto frame = co_await frames->next())
+//   {
+//       ...
+//   }
+//
+// Waiting coroutines hold no thread. The stream thread that receives a packet
+// passes the waiting coroutine handles to the scheduler, which resumes them,
+// usually on an event loop. Without a scheduler they are resumed on the stream
+// thread, inside the HostPipeline packet listener: they must not destroy the
+// source there and should return quickly.
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <algorithm>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "depthai/host_data_packet.hpp"
+#include "depthai/pipeline/host_pipeline.hpp"
+
+
+using PacketScheduler = std::function<void(std::coroutine_handle<>)>;
+
+namespace packet_awaitable_detail
+{
+
+inline void resume(const PacketScheduler &scheduler, std::coroutine_handle<> handle)
+{
+    if (scheduler)
+    {
+        scheduler(handle);
+    }
+    else
+    {
+        handle.resume();
+    }
+}
+
+} // namespace packet_awaitable_detail
+
+
+// Packets of one stream (empty: all streams) for a single consumer, see
+// PacketAwaitSource::subscribe(). The oldest packet is dropped when capacity
+// packets are queued. Only one coroutine may wait in next() at a time.
+class PacketSubscription
+{
+public:
+    class NextAwaiter
+    {
+    public:
+        explicit NextAwaiter(PacketSubscription &subscription) : _subscription(subscription) {}
+
+        NextAwaiter(const NextAwaiter&) = delete;
+        NextAwaiter& operator=(const NextAwaiter&) = delete;
+
+        // a coroutine destroyed while waiting stops waiting
+        ~NextAwaiter()
+        {
+            std::lock_guard<std::mutex> lock(_subscription._mutex);
+            if (_subscription._waiting == this)
+            {
+                _subscription._waiting = nullptr;
+                _subscription._waiter = nullptr;
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock(_subscription._mutex);
+            if (!_subscription._queue.empty())
+            {
+                _packet = std::move(_subscription._queue.front());
+                _subscription._queue.pop_front();
+                return false;
+            }
+            if (_subscription._closed)
+            {
+                return false;
+            }
+            _subscription._waiter = handle;
+            _subscription._waiting = this;
+            return true;
+        }
+
+        // nullptr once the source is closed and the queue is empty
+        std::shared_ptr<HostDataPacket> await_resume() { return std::move(_packet); }
+
+    private:
+        friend class PacketSubscription;
+
+        PacketSubscription &_subscription;
+        std::shared_ptr<HostDataPacket> _packet;
+    };
+
+    PacketSubscription(const std::string &stream_name, size_t capacity, PacketScheduler scheduler)
+        : _stream_name(stream_name)
+        , _capacity(std::max<size_t>(1, capacity))
+        , _scheduler(std::move(scheduler))
+    {}
+
+    PacketSubscription(const PacketSubscription&) = delete;
+    PacketSubscription& operator=(const PacketSubscription&) = delete;
+
+    const std::string& getStreamName() const { return _stream_name; }
+
+    NextAwaiter next() { return NextAwaiter(*this); }
+
+    // Packets dropped because the consumer did not keep up
+    uint64_t getDroppedPackets()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _dropped_packets;
+    }
+
+    bool isClosed()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _closed;
+    }
+
+private:
+    friend class PacketAwaitSource;
+
+    bool accepts(const std::string &stream_name) const { return _stream_name.empty() || _stream_name == stream_name; }
+
+    void push(const std::shared_ptr<HostDataPacket> &packet)
+    {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_closed)
+            {
+                return;
+            }
+            if (_waiting != nullptr)
+            {
+                _waiting->_packet = packet;
+                waiter = _waiter;
+                _waiting = nullptr;
+            }
+            else
+            {
+                if (_queue.size() >= _capacity)
+                {
+                    _queue.pop_front();
+                    _dropped_packets++;
+                }
+                _queue.push_back(packet);
+            }
+        }
+        if (waiter)
+        {
+            packet_awaitable_detail::resume(_scheduler, waiter);
+        }
+    }
+
+    void close()
+    {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+            if (_waiting != nullptr)
+            {
+                waiter = _waiter;
+                _waiting = nullptr;
+            }
+        }
+        if (waiter)
+        {
+            packet_awaitable_detail::resume(_scheduler, waiter);
+        }
+    }
+
+    const std::string _stream_name;
+    const size_t _capacity;
+    const PacketScheduler _scheduler;
+
+    std::mutex _mutex;
+    std::deque<std::shared_ptr<HostDataPacket>> _queue;
+    std::coroutine_handle<> _waiter;
+    NextAwaiter *_waiting = nullptr;
+    uint64_t _dropped_packets = 0;
+    bool _closed = false;
+};
+
+
+// Awaitable packets of a HostPipeline, through one packet listener for any
+// number of waiting coroutines and subscriptions. The pipeline must outlive
+// the source. Destroying the source resumes the waiting coroutines with
+// nullptr and closes the subscriptions.
+class PacketAwaitSource
+{
+    struct Waiter
+    {
+        std::string stream_name;
+        std::coroutine_handle<> handle;
+        std::shared_ptr<HostDataPacket> packet;
+        bool queued = false;                // guarded by State::mutex
+    };
+
+    struct State
+    {
+        PacketScheduler scheduler;
+
+        std::mutex mutex;
+        std::map<std::string, std::vector<Waiter*>> waiters;  // by stream name, "" for any stream
+        std::vector<std::shared_ptr<PacketSubscription>> subscriptions;
+        bool closed = false;
+
+        // called on the stream thread
+        void deliver(const std::shared_ptr<HostDataPacket> &packet)
+        {
+            std::vector<std::coroutine_handle<>> ready;
+            std::vector<std::shared_ptr<PacketSubscription>> receivers;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const std::string *names[] = {&packet->stream_name, &c_any_stream};
+                for (const std::string *name : names)
+                {
+                    auto it = waiters.find(*name);
+                    if (it == waiters.end())
+                    {
+                        continue;
+                    }
+                    for (Waiter *waiter : it->second)
+                    {
+                        waiter->packet = packet;
+                        waiter->queued = false;
+                        ready.push_back(waiter->handle);
+                    }
+                    it->second.clear();
+                }
+                for (const auto &subscription : subscriptions)
+                {
+                    if (subscription->accepts(packet->stream_name))
+                    {
+                        receivers.push_back(subscription);
+                    }
+                }
+            }
+
+            // the waiters may be destroyed once resumed, only their handles are used
+            for (auto handle : ready)
+            {
+                packet_awaitable_detail::resume(scheduler, handle);
+            }
+            for (const auto &subscription : receivers)
+            {
+                subscription->push(packet);
+            }
+        }
+
+        void close()
+        {
+            std::vector<std::coroutine_handle<>> ready;
+            std::vector<std::shared_ptr<PacketSubscription>> receivers;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+                for (auto &stream_waiters : waiters)
+                {
+                    for (Waiter *waiter : stream_waiters.second)
+                    {
+                        waiter->queued = false;
+                        ready.push_back(waiter->handle);
+                    }
+                }
+                waiters.clear();
+                receivers.swap(subscriptions);
+            }
+
+            for (auto handle : ready)
+            {
+                packet_awaitable_detail::resume(scheduler, handle);
+            }
+            for (const auto &subscription : receivers)
+            {
+                subscription->close();
+            }
+        }
+    };
+
+public:
+    class NextAwaiter
+    {
+    public:
+        NextAwaiter(std::shared_ptr<State> state, std::string stream_name)
+            : _state(std::move(state))
+        {
+            _waiter.stream_name = std::move(stream_name);
+        }
+
+        NextAwaiter(const NextAwaiter&) = delete;
+        NextAwaiter& operator=(const NextAwaiter&) = delete;
+
+        // a coroutine destroyed while waiting stops waiting
+        ~NextAwaiter()
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            if (_waiter.queued)
+            {
+                auto &waiters = _state->waiters[_waiter.stream_name];
+                waiters.erase(std::find(waiters.begin(), waiters.end(), &_waiter));
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            if (_state->closed)
+            {
+                return false;
+            }
+            _waiter.handle = handle;
+            _waiter.queued = true;
+            _state->waiters[_waiter.stream_name].push_back(&_waiter);
+            return true;
+        }
+
+        // nullptr if the source was closed
+        std::shared_ptr<HostDataPacket> await_resume() { return std::move(_waiter.packet); }
+
+    private:
+        std::shared_ptr<State> _state;
+        Waiter _waiter;
+    };
+
+    explicit PacketAwaitSource(HostPipeline &pipeline, PacketScheduler scheduler = nullptr)
+        : _pipeline(pipeline)
+        , _state(std::make_shared<State>())
+    {
+        _state->scheduler = std::move(scheduler);
+        std::shared_ptr<State> state = _state;
+        _listener_id = _pipeline.addPacketListener("", [state](const std::shared_ptr<HostDataPacket> &packet)
+        {
+            state->deliver(packet);
+        });
+    }
+
+    ~PacketAwaitSource()
+    {
+        close();
+    }
+
+    PacketAwaitSource(const PacketAwaitSource&) = delete;
+    PacketAwaitSource& operator=(const PacketAwaitSource&) = delete;
+
+    // Next packet of stream_name (empty: any stream) received after the co_await
+    NextAwaiter next(const std::string &stream_name)
+    {
+        return NextAwaiter(_state, stream_name);
+    }
+
+    // Packets of stream_name (empty: all streams) from now on
+    std::shared_ptr<PacketSubscription> subscribe(const std::string &stream_name, size_t capacity = 8)
+    {
+        auto subscription = std::make_shared<PacketSubscription>(stream_name, capacity, _state->scheduler);
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        if (_state->closed)
+        {
+            subscription->close();
+        }
+        else
+        {
+            _state->subscriptions.push_back(subscription);
+        }
+        return subscription;
+    }
+
+    void unsubscribe(const std::shared_ptr<PacketSubscription> &subscription)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            auto &subscriptions = _state->subscriptions;
+            subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), subscription), subscriptions.end());
+        }
+        subscription->close();
+    }
+
+    // Stops receiving packets, see the destructor
+    void close()
+    {
+        if (_listener_id < 0)
+        {
+            return;
+        }
+        _pipeline.removePacketListener(_listener_id);
+        _listener_id = -1;
+        _state->close();
+    }
+
+private:
+    static inline const std::string c_any_stream;
+
+    HostPipeline &_pipeline;
+    std::shared_ptr<State> _state;
+    int _listener_id = -1;
+};
+
+#endif // __cpp_impl_coroutine
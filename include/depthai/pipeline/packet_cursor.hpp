@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "depthai/frame_allocator.hpp"
+#include "depthai/host_data_packet.hpp"
+#include "depthai/ready_fd.hpp"
+
+
+enum class CursorPolicy
+{
+    ALL,        // every packet, the oldest is dropped when capacity is reached
+    LATEST,     // only the newest packet of each stream
+};
+
+// Named consumer of HostPipeline packets, see HostPipeline::addCursor().
+// Cursors share the packets of the pipeline, delivering one costs a
+// shared_ptr enqueue. Each cursor has its own queue, a slow cursor drops its
+// own packets and never blocks the stream thread or other cursors.
+class PacketCursor
+{
+public:
+    PacketCursor(const std::string &name, CursorPolicy policy, size_t capacity, const std::string &stream_name);
+
+    PacketCursor(const PacketCursor&) = delete;
+    PacketCursor& operator=(const PacketCursor&) = delete;
+
+    const std::string& getName() const { return _name; }
+    CursorPolicy getPolicy() const { return _policy; }
+
+    // Packets queued since the last call, oldest first. blocking waits for
+    // at least one packet or until the cursor is closed.
+    std::list<std::shared_ptr<HostDataPacket>> getAvailableDataPackets(bool blocking = false);
+
+    // Next packet, waits up to timeout_ms (-1: forever). nullptr on timeout
+    // or when the cursor is closed.
+    std::shared_ptr<HostDataPacket> next(int timeout_ms = -1);
+
+    // Packets dropped or replaced before this cursor consumed them
+    uint64_t getDroppedPackets() const { return _dropped_packets; }
+
+    bool isClosed() const { return _closed; }
+
+    // Readable while packets are queued or once the cursor is closed, see
+    // ReadyFd. -1 if not supported.
+    int getReadyFd();
+
+private:
+    friend class HostPipeline;
+
+    bool accepts(const std::string &stream_name) const { return _stream_name.empty() || _stream_name == stream_name; }
+    void push(const std::shared_ptr<HostDataPacket> &packet);
+    void close();
+
+    const std::string  _name;
+    const CursorPolicy _policy;
+    const size_t       _capacity;
+    const std::string  _stream_name;   // empty for all streams
+
+    std::mutex _mutex;
+    std::condition_variable _signal;
+    std::deque<std::shared_ptr<HostDataPacket>, FrameAllocator<std::shared_ptr<HostDataPacket>>> _queue;
+    ReadyFd _ready_fd;
+    std::atomic<uint64_t> _dropped_packets;
+    std::atomic<bool> _closed;
+};
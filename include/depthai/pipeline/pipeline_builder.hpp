@@ -0,0 +1,192 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "depthai/color_conversion.hpp"
+#include "depthai/host_data_packet.hpp"
+#include "depthai/pipeline/host_pipeline.hpp"
+
+
+// Declarative host processing graph. Nodes are added to a PipelineBuilder,
+// build() validates the node types and returns the running HostGraph, which
+// gets its packets from a HostPipeline:
+//
+//   PipelineBuilder builder;
+//   auto disparity = builder.addSource("disparity");
+//   auto colored   = builder.addColorize("disparity_color", disparity);
+//   auto detection = builder.addDecodeNN("detections", builder.addSource("metaout"), 0.5f);
+//   auto synced    = builder.addSync("synced", {colored, detection});
+//   builder.addSink("app", synced, [](const HostFrames &frames) { ... });
+//
+//   std::unique_ptr<HostGraph> graph = builder.build();
+//   graph->attach(*pipeline);
+//   ...
+//   log_info("%s", graph->toString().c_str());
+//
+// Each node has a bounded input queue, the oldest message is dropped when
+// it is full. Nodes run on a pool of workers, independent nodes in parallel,
+// every node processes its messages in order. Chains of per pixel nodes
+// (colorize, convert between GRAY / BGR / RGB) where each output has a single
+// consumer run fused in one pass, without intermediate frames.
+
+using NodeId = int;
+
+// Message between graph nodes: one packet, or one per input of a sync node
+using HostFrames = std::vector<std::shared_ptr<HostDataPacket>>;
+using HostFramesCallback = std::function<void(const HostFrames &frames)>;
+
+enum class HostNodeType
+{
+    SOURCE,         // packets of a HostPipeline stream
+    COLORIZE,       // 8-bit disparity -> BGR false color
+    CONVERT,        // YUV 4:2:0 / GRAY / BGR / RGB -> PixelFormat
+    DECODE_NN,      // "metaout" detection output -> array of dai::Detection
+    SYNC,           // one message per input with the same sequence number
+    SINK,           // callback
+};
+
+// Output type of a node, checked against the inputs by build()
+enum class HostFrameFormat
+{
+    RAW,            // device packet, format known only from its dimensions
+    GRAY,
+    BGR,
+    RGB,
+    YUV420,
+    DETECTIONS,
+    FRAME_SET,      // output of SYNC
+    NONE,           // SINK
+};
+
+class HostGraph;
+
+class PipelineBuilder
+{
+public:
+    NodeId addSource(const std::string &stream_name);
+    NodeId addColorize(const std::string &name, NodeId input);
+    NodeId addConvert(const std::string &name, NodeId input, PixelFormat format, bool downscale = false);
+    NodeId addDecodeNN(const std::string &name, NodeId input, float min_confidence = 0.f);
+    NodeId addSync(const std::string &name, const std::vector<NodeId> &inputs);
+    // callback runs on a graph worker
+    NodeId addSink(const std::string &name, NodeId input, HostFramesCallback callback);
+
+    // Queue size of the nodes added later, default 4
+    void setQueueSize(size_t queue_size) { _queue_size = queue_size; }
+
+    // nullptr if the graph is invalid (logged). worker_count 0: one per
+    // processing stage, up to hardware_concurrency.
+    std::unique_ptr<HostGraph> build(int worker_count = 0) const;
+
+private:
+    friend class HostGraph;
+
+    struct Node
+    {
+        HostNodeType type;
+        std::string name;
+        std::vector<NodeId> inputs;
+        size_t queue_size;
+
+        std::string stream_name;    // SOURCE
+        PixelFormat format;         // CONVERT
+        bool downscale = false;     // CONVERT
+        float min_confidence = 0;   // DECODE_NN
+        HostFramesCallback callback;// SINK
+    };
+
+    NodeId addNode(Node node);
+
+    std::vector<Node> _nodes;
+    size_t _queue_size = 4;
+};
+
+class HostGraph
+{
+public:
+    ~HostGraph();
+
+    HostGraph(const HostGraph&) = delete;
+    HostGraph& operator=(const HostGraph&) = delete;
+
+    // Feeds the graph from pipeline through a packet listener
+    void attach(HostPipeline &pipeline);
+    void detach();
+
+    // Passes the packet to the sources of its stream, called by attach()
+    void push(const std::shared_ptr<HostDataPacket> &packet);
+
+    // Blocks until all queued messages are processed
+    void flush();
+    void stop();
+
+    // Nodes, their connections, fused stages and timing, one line per node
+    std::string toString();
+
+private:
+    friend class PipelineBuilder;
+
+    struct Message
+    {
+        int input;          // index in the inputs of the first stage node
+        HostFrames frames;
+    };
+
+    struct NodeState
+    {
+        PipelineBuilder::Node desc;
+        HostFrameFormat format;
+        int stage = -1;                     // SOURCE: -1
+        std::vector<std::pair<NodeId, int>> consumers;  // node, input index
+
+        // SYNC
+        std::deque<std::pair<int, HostFrames>> pending; // sequence number, frame per input
+        int last_sequence = -1;
+    };
+
+    struct Stage
+    {
+        std::vector<NodeId> nodes;          // fused chain, first node receives the messages
+        size_t queue_size;
+        std::deque<Message> queue;
+        bool scheduled = false;             // in the ready queue or running
+
+        uint64_t runs = 0;
+        uint64_t dropped = 0;               // queue overflow, unmatched SYNC inputs
+        double   total_ms = 0;
+        double   max_ms = 0;
+    };
+
+    HostGraph(const std::vector<PipelineBuilder::Node> &nodes, const std::vector<HostFrameFormat> &formats, int worker_count);
+
+    void deliver(NodeId node, const HostFrames &frames);
+    void enqueue(NodeId node, int input, const HostFrames &frames);
+    void workerThread();
+    bool runStage(Stage &stage, Message &message, HostFrames &output, uint64_t &dropped);
+    bool runPixelChain(const std::vector<NodeId> &chain, const std::shared_ptr<HostDataPacket> &input, HostFrames &output);
+    bool runConvertYuv(const NodeState &node, const std::shared_ptr<HostDataPacket> &input, HostFrames &output);
+    bool runDecodeNN(const NodeState &node, const std::shared_ptr<HostDataPacket> &input, HostFrames &output);
+    bool runSync(NodeState &node, int input, const HostFrames &frames, HostFrames &output, uint64_t &dropped);
+
+    std::vector<NodeState> _nodes;
+    std::vector<Stage> _stages;
+
+    std::mutex _mutex;
+    std::condition_variable _work_cv;
+    std::condition_variable _idle_cv;
+    std::deque<int> _ready;                 // stage indices
+    int _busy = 0;
+    bool _stop = false;
+    std::vector<std::thread> _workers;
+
+    HostPipeline *_pipeline = nullptr;
+    int _listener_id = -1;
+};
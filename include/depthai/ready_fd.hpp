@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+
+// Pollable file descriptor that becomes readable when a queue gets data, for
+// epoll / poll / select loops. eventfd on Linux, a pipe on other POSIX
+// systems, not available on Windows.
+//
+// Wakeups are coalesced: the descriptor is written once until the consumer
+// calls clear(), however many packets arrive meanwhile. The consumer calls
+// clear() before it takes the queued data, so data queued after that signals
+// again, which also makes it safe with EPOLLET.
+class ReadyFd
+{
+public:
+    ReadyFd() = default;
+    ~ReadyFd();
+
+    ReadyFd(const ReadyFd&) = delete;
+    ReadyFd& operator=(const ReadyFd&) = delete;
+
+    // Creates the descriptor on the first call, -1 if it can't be created.
+    // Owned by this object, the caller must not close it.
+    int getFd();
+
+    // Producer side, a no-op until getFd() was called
+    void notify();
+
+    // Consumer side, drains the descriptor
+    void clear();
+
+private:
+    std::mutex _open_mutex;
+    std::atomic<int> _read_fd{-1};
+    int _write_fd = -1;                 // same as _read_fd for eventfd
+    bool _open_failed = false;
+    std::atomic<bool> _pending{false};  // written, not cleared yet
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "matrix_types.hpp"
+
+
+// Undistortion + rectification model, maps rectified (destination) pixels to
+// source pixels of the raw camera image. Uses the 14 coefficient distortion
+// model: k1, k2, p1, p2, k3, k4, k5, k6, s1, s2, s3, s4, tauX, tauY
+class RectificationModel
+{
+public:
+    RectificationModel(
+        const Mat3f &M,                 // intrinsics of the raw camera
+        const Mat3f &R,                 // rectification rotation
+        const Mat3f &M_new,             // intrinsics of the rectified image
+        const std::vector<float> &d     // distortion, missing coefficients are 0
+    );
+
+    // Source coordinates for destination pixels (xs[i], y), i in [0, count)
+    void mapRow(const float *xs, int count, float y, float *src_x, float *src_y) const;
+
+    // Identifies the calibration, used as a cache key
+    uint64_t hash() const { return _hash; }
+
+private:
+    Mat3f _iR;                          // (M_new * R)^-1
+    Mat3f _tilt;
+    float _fx, _fy, _u0, _v0;
+    float _k[14];
+    uint64_t _hash;
+};
+
+
+// Mesh is a grid of (y, x) source coordinates, sampled every cell_size pixels
+// of the rectified image, including the right and bottom image edges.
+// Rows are padded with a (0, 0) pair to an even number of points.
+constexpr int c_mesh_cell_size = 16;
+
+void create_rectification_mesh(
+    const RectificationModel &model,
+    int width, int height,
+    std::vector<float> &mesh,
+    int cell_size = c_mesh_cell_size
+);
+
+// Same as create_rectification_mesh, but looks up / stores the mesh in the
+// on-disk cache, keyed by the calibration hash, resolution and cell size
+void create_rectification_mesh_cached(
+    const RectificationModel &model,
+    int width, int height,
+    std::vector<float> &mesh,
+    int cell_size = c_mesh_cell_size
+);
+
+// Creates mesh from a full-resolution map file (map_w * map_h floats of x
+// coordinates followed by the same amount of y coordinates). The file is
+// memory mapped. Resolutions with half the map height are downscaled,
+// smaller heights are center-cropped.
+bool create_rectification_mesh_from_map_file(
+    const std::string &map_file,
+    int map_w, int map_h,
+    int width, int height,
+    std::vector<float> &mesh,
+    int cell_size = c_mesh_cell_size
+);
+
+// $DEPTHAI_MESH_CACHE_DIR, or the user cache directory + "/depthai/mesh"
+std::string get_mesh_cache_dir();
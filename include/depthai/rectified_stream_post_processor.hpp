@@ -0,0 +1,47 @@
+#pragma once
+// Host side undistortion / rectification of the raw mono streams:
+// "left" -> "left_rect", "right" -> "right_rect"
+
+// Std
+#include <string>
+#include <vector>
+
+// Shared
+#include "depthai-shared/general/data_observer.hpp"
+#include "depthai-shared/general/data_subject.hpp"
+#include "depthai-shared/stream/stream_info.hpp"
+#include "depthai-shared/stream/stream_data.hpp"
+
+// Project
+#include "host_remap.hpp"
+
+
+class RectifiedStreamPostProcessor
+    : public DataSubject<StreamInfo, StreamData>
+    , public DataObserver<StreamInfo, StreamData>
+{
+public:
+    RectifiedStreamPostProcessor(const RectificationModel &left_model, const RectificationModel &right_model);
+
+    // StreamInfo of the rectified stream, for the given raw stream
+    static StreamInfo getOutputStreamInfo(const StreamInfo &raw_stream);
+    static std::string getOutputStreamName(const std::string &raw_stream_name);
+
+protected:
+    // class DataObserver
+    virtual void onNewData(const StreamInfo &data_info, const StreamData &data);
+
+private:
+    // left and right are delivered on different threads, each has its own state
+    struct Channel
+    {
+        Channel(const RectificationModel &model_) : model(model_) {}
+
+        RectificationModel         model;
+        RemapTable                 table;
+        std::vector<unsigned char> output;
+    };
+
+    Channel _left;
+    Channel _right;
+};
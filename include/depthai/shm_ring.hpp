@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "host_data_packet.hpp"
+
+
+// Frames of one stream shared with other local processes through a ring of
+// fixed size slots in shared memory (/dev/shm/depthai_<name> on Linux).
+// One publisher writes, any number of subscribers read in place. Slots are
+// guarded by sequence numbers (seqlock), readers never block the publisher
+// and only lose frames when they fall more than slot_count frames behind.
+// Not available on Windows.
+
+struct ShmRingHeader;
+
+// Frame inside the ring, data points into the shared memory. The publisher
+// may overwrite the slot once the subscriber falls behind, check
+// ShmSubscriber::isValid() after using data (or copy it first).
+struct ShmFrame
+{
+    const uint8_t *data = nullptr;
+    uint32_t size = 0;
+    uint64_t sequence = 0;              // frame number since the publisher started
+    int      elem_size = 1;
+    int      dimensions[4] = {};
+    int      dimension_count = 0;
+    bool     has_metadata = false;
+    FrameMetadata metadata;
+
+private:
+    friend class ShmSubscriber;
+    uint64_t _slot_sequence = 0;
+    const std::atomic<uint64_t> *_slot = nullptr;
+};
+
+class ShmPublisher
+{
+public:
+    // Creates (or replaces) the ring, slot_size is the largest frame payload
+    ShmPublisher(const std::string &name, uint32_t slot_count, uint32_t slot_size);
+    ~ShmPublisher();
+
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    bool isOpen() const { return _header != nullptr; }
+
+    // Copies the packet into the next slot, false if it does not fit
+    bool publish(const HostDataPacket &packet);
+
+    uint64_t getPublishedFrames() const;
+
+private:
+    std::string _path;
+    void       *_mapping = nullptr;
+    size_t      _mapping_size = 0;
+    ShmRingHeader *_header = nullptr;
+};
+
+class ShmSubscriber
+{
+public:
+    explicit ShmSubscriber(const std::string &name);
+    ~ShmSubscriber();
+
+    ShmSubscriber(const ShmSubscriber&) = delete;
+    ShmSubscriber& operator=(const ShmSubscriber&) = delete;
+
+    bool isOpen() const { return _header != nullptr; }
+
+    // Next frame after the last one returned, waits up to timeout_ms for it
+    // (0: don't wait, -1: forever). Starts with the newest frame, skips the
+    // frames that were already overwritten.
+    bool next(ShmFrame &frame, int timeout_ms = -1);
+
+    // frame.data was not overwritten since next() returned it
+    bool isValid(const ShmFrame &frame) const;
+
+    uint64_t getLostFrames() const { return _lost_frames; }
+
+private:
+    void       *_mapping = nullptr;
+    size_t      _mapping_size = 0;
+    const ShmRingHeader *_header = nullptr;
+    uint64_t    _next_sequence = 0;
+    bool        _started = false;
+    uint64_t    _lost_frames = 0;
+};
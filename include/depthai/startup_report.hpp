@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+// Durations of the device boot and pipeline creation phases
+struct StartupReport
+{
+    struct Phase
+    {
+        std::string name;
+        double      offset_ms   = 0.0; // phase start, relative to the start of boot / create_pipeline
+        double      duration_ms = 0.0;
+    };
+
+    // bspatch, init_device, boot, read_and_parse_config_d2h, load_and_print_config_d2h
+    std::vector<Phase> device_phases;
+    // create_pipeline, config_h2d, blob_read, blob_upload[N], out_blob[N], stream_open:<name>, ...
+    std::vector<Phase> pipeline_phases;
+
+    const Phase* findDevicePhase(const std::string &name) const { return find(device_phases, name); }
+    const Phase* findPipelinePhase(const std::string &name) const { return find(pipeline_phases, name); }
+
+private:
+    static const Phase* find(const std::vector<Phase> &phases, const std::string &name)
+    {
+        for (const auto &phase : phases)
+        {
+            if (phase.name == name)
+            {
+                return &phase;
+            }
+        }
+        return nullptr;
+    }
+};
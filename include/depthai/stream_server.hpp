@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "host_data_packet.hpp"
+
+
+// Wire format of StreamServer, native byte order. Each message is a
+// StreamPacketHeader followed by payload_size bytes.
+static constexpr uint32_t c_stream_packet_magic = 0x50494144;  // "DAIP"
+
+enum class StreamPacketType : uint16_t
+{
+    DATA        = 0,    // packet payload
+    STREAM_INFO = 1,    // payload is the stream name of stream_id, sent before its first DATA
+};
+
+struct StreamPacketHeader
+{
+    uint32_t magic;
+    uint16_t type;              // StreamPacketType
+    uint16_t stream_id;
+    uint64_t sequence;          // per stream, gaps are frames skipped for this client
+    double   timestamp;         // device timestamp [s], NaN without FrameMetadata
+    uint32_t payload_size;
+    int32_t  elem_size;
+    int32_t  dimension_count;
+    int32_t  dimensions[4];
+    uint32_t reserved;
+};
+
+// Local streaming server on a Unix domain socket. Clients send text lines
+// "subscribe <stream>" / "unsubscribe <stream>" ("*" for all streams) and
+// receive the packets of their subscriptions. Packets are referenced in
+// per-client bounded queues and sent with sendmsg straight from the
+// HostDataPacket buffer. When a client's queue is full its oldest queued
+// frame is skipped. Not available on Windows.
+//
+//   StreamServer server("/tmp/depthai.sock");
+//   pipeline->addPacketListener("",
+//       [&server](const std::shared_ptr<HostDataPacket> &p) { server.onPacket(p); });
+class StreamServer
+{
+public:
+    explicit StreamServer(const std::string &socket_path, size_t client_queue_size = 8);
+    ~StreamServer();
+
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    bool isRunning() const { return _thread.joinable(); }
+
+    // Queues the packet for the subscribed clients, called on the stream thread
+    void onPacket(const std::shared_ptr<HostDataPacket> &packet);
+
+    void stop();
+
+    size_t getClientCount();
+    uint64_t getSentBytes() const { return _sent_bytes; }
+    uint64_t getSkippedFrames() const { return _skipped_frames; }
+
+private:
+    struct Message
+    {
+        StreamPacketHeader header;
+        std::shared_ptr<HostDataPacket> packet;     // DATA
+        std::string name;                           // STREAM_INFO
+        const uint8_t* payload() const;
+    };
+
+    struct Client
+    {
+        int fd = -1;
+        std::set<std::string> subscriptions;
+        bool subscribed_all = false;
+        std::set<uint16_t> announced;               // streams with STREAM_INFO sent
+        std::list<Message> queue;
+        size_t data_count = 0;                      // DATA messages in queue
+        size_t in_flight = 0;                       // front messages used by sendmsg
+        size_t sent_offset = 0;                     // of the front message
+        std::string input;
+    };
+
+    struct StreamState
+    {
+        uint16_t id;
+        uint64_t sequence;
+    };
+
+    void ioThread();
+    void wake();
+    void acceptClients();
+    bool readClient(Client &client);
+    bool flushClient(Client &client);
+    void closeClient(int fd);
+    static bool isSubscribed(const Client &client, const std::string &stream_name);
+
+    const std::string _socket_path;
+    const size_t      _client_queue_size;
+
+    int _listen_fd = -1;
+    int _wake_fds[2] = {-1, -1};
+    std::atomic<bool> _wake_pending;
+    std::atomic<bool> _quit;
+    std::thread _thread;
+
+    std::mutex _mutex;
+    std::map<int, std::shared_ptr<Client>> _clients;
+    std::map<std::string, StreamState> _streams;
+
+    std::atomic<uint64_t> _sent_bytes;
+    std::atomic<uint64_t> _skipped_frames;
+};
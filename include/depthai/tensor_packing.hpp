@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+
+enum class TensorLayout
+{
+    CHW,    // planar, e.g. previewout
+    HWC,    // interleaved
+};
+
+// Packs a uint8 image into dst, converting between planar and interleaved
+// layouts. With swap_rb and 3 channels the channel order is reversed
+// (BGR <-> RGB), it is ignored for other channel counts. src and dst must not
+// overlap. SSE2 / NEON for 1 and 3 channels, scalar otherwise.
+void pack_tensor_u8(
+    const uint8_t *src, TensorLayout src_layout,
+    uint8_t *dst, TensorLayout dst_layout,
+    int channels, int height, int width,
+    bool swap_rb = false
+);
+
+// Same as pack_tensor_u8, with conversion to float:
+//   dst[c] = (src[c'] - mean[c]) * scale[c]
+// where c is the destination channel and c' the (possibly swapped) source
+// channel. mean and scale hold one value per channel, nullptr means 0 / 1.
+// dst is written directly, e.g. one image of an NCHW / NHWC input tensor.
+void pack_tensor_f32(
+    const uint8_t *src, TensorLayout src_layout,
+    float *dst, TensorLayout dst_layout,
+    int channels, int height, int width,
+    const float *mean = nullptr,
+    const float *scale = nullptr,
+    bool swap_rb = false
+);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+// Scheduling of the host threads of the library. The XLink reader threads
+// are created by the shared code, settings are applied from the threads
+// themselves through apply_thread_settings().
+enum class ThreadClass
+{
+    WATCHDOG = 0,
+    STREAM_READER,      // XLink reader threads, HostPipeline::onNewData
+    POST_PROCESSING,    // reader threads running a stream post processor
+};
+
+struct ThreadSettings
+{
+    std::vector<int> cpu_affinity;  // CPU indices, empty: not changed
+    int fifo_priority = 0;          // SCHED_FIFO priority 1..99, 0: default policy
+    int nice = 0;                   // used without fifo_priority
+    std::string name;               // thread name prefix, empty: default of the class
+};
+
+struct ThreadStats
+{
+    std::string name;
+    ThreadClass thread_class;
+    double      cpu_time_s;         // NaN where not supported
+};
+
+// Applied by the threads of the class on their next apply_thread_settings() call
+void set_thread_settings(ThreadClass thread_class, const ThreadSettings &settings);
+
+// Applies the settings of thread_class to the calling thread when called
+// first and after set_thread_settings(), otherwise only compares a counter.
+// A thread keeps the highest class it was applied with: reader threads that
+// run a post processor stay POST_PROCESSING. The thread is named
+// "<name>_<name_suffix>", truncated to 15 characters.
+void apply_thread_settings(ThreadClass thread_class, const std::string &name_suffix = "");
+
+// Threads that called apply_thread_settings() and are still running
+std::vector<ThreadStats> get_thread_stats();
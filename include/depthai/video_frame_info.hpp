@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+enum class VideoCodec
+{
+    H264,
+    H265,
+};
+
+enum class VideoFrameType
+{
+    UNKNOWN,
+    I,
+    P,
+    B,
+};
+
+// NAL unit inside a packet, offset and size exclude the start code
+struct NalUnit
+{
+    uint32_t offset;
+    uint32_t size;
+    uint8_t  type;
+};
+
+// Latest parameter sets of a stream, each in Annex B form (with start code),
+// vps is empty for H.264
+struct VideoParameterSets
+{
+    std::vector<uint8_t> vps;
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+
+    // picture size from the SPS, after cropping, 0 if it could not be parsed
+    int width = 0;
+    int height = 0;
+};
+
+// Set on HostDataPacket::video_info by NalParser, NAL units point into the
+// packet data
+struct VideoFrameInfo
+{
+    VideoCodec     codec = VideoCodec::H264;
+    VideoFrameType frame_type = VideoFrameType::UNKNOWN;
+    bool           keyframe = false;            // IDR (H.264) / IRAP (H.265) access unit
+    bool           has_parameter_sets = false;  // packet itself carries SPS / PPS (/ VPS)
+    uint64_t       sequence = 0;                // packet number in the stream
+    uint64_t       stream_offset = 0;           // packet position in the concatenated stream
+
+    std::vector<NalUnit> nal_units;
+
+    // parameter sets in effect for this packet, nullptr until first seen
+    std::shared_ptr<const VideoParameterSets> parameter_sets;
+};
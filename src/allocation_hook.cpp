@@ -0,0 +1,128 @@
+#include "allocation_hook.hpp"
+
+#ifdef DEPTHAI_ALLOCATION_HOOK
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+
+namespace
+{
+
+std::atomic<bool> g_armed{false};
+std::atomic<uint64_t> g_allocations{0};
+
+void abort_on_allocation(size_t size)
+{
+    // stdio only, the logger could allocate
+    fprintf(stderr, "heap allocation of %zu bytes on the frame path\n", size);
+    abort();
+}
+
+std::atomic<AllocationFailureHandler> g_handler{&abort_on_allocation};
+
+thread_local int t_frame_path_depth = 0;
+thread_local bool t_in_handler = false;
+
+void* checked_malloc(size_t size)
+{
+    check_frame_path_allocation(size);
+    void *data = malloc(size != 0 ? size : 1);
+    if (data == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return data;
+}
+
+} // namespace
+
+
+FramePathScope::FramePathScope()
+{
+    t_frame_path_depth++;
+}
+
+FramePathScope::~FramePathScope()
+{
+    t_frame_path_depth--;
+}
+
+FramePathExit::FramePathExit()
+    : _depth(t_frame_path_depth)
+{
+    t_frame_path_depth = 0;
+}
+
+FramePathExit::~FramePathExit()
+{
+    t_frame_path_depth = _depth;
+}
+
+void arm_allocation_hook(bool armed)
+{
+    g_armed = armed;
+}
+
+void set_allocation_failure_handler(AllocationFailureHandler handler)
+{
+    g_handler = handler;
+}
+
+uint64_t get_frame_path_allocations()
+{
+    return g_allocations;
+}
+
+void check_frame_path_allocation(size_t size)
+{
+    if (t_frame_path_depth == 0 || t_in_handler || !g_armed.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    g_allocations++;
+    const AllocationFailureHandler handler = g_handler;
+    if (handler != nullptr)
+    {
+        t_in_handler = true;
+        handler(size);
+        t_in_handler = false;
+    }
+}
+
+
+void* operator new(size_t size)
+{
+    return checked_malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    return checked_malloc(size);
+}
+
+void operator delete(void *data) noexcept
+{
+    free(data);
+}
+
+void operator delete[](void *data) noexcept
+{
+    free(data);
+}
+
+void operator delete(void *data, size_t) noexcept
+{
+    free(data);
+}
+
+void operator delete[](void *data, size_t) noexcept
+{
+    free(data);
+}
+
+#endif // DEPTHAI_ALLOCATION_HOOK
@@ -0,0 +1,229 @@
+#include <algorithm>
+
+#include "async_stream_dispatcher.hpp"
+#include "logger.hpp"
+
+
+AsyncStreamDispatcher::Inbox::Inbox(
+    const std::string &name,
+    const std::vector<StreamInfo> &streams,
+    size_t size,
+    OverflowPolicy policy
+)
+    : _name(name)
+    , _streams([&streams] {
+            std::set<std::string> names;
+            for (const auto &info : streams)
+            {
+                names.insert(info.name);
+            }
+            return names;
+        }())
+    , _size(std::max<size_t>(1, size))
+    , _policy(policy)
+{}
+
+void AsyncStreamDispatcher::Inbox::start()
+{
+    _thread = std::thread(&Inbox::executorThread, this);
+}
+
+void AsyncStreamDispatcher::Inbox::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+        _queue.clear();
+    }
+    _not_empty.notify_all();
+    _not_full.notify_all();
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void AsyncStreamDispatcher::Inbox::push(const std::shared_ptr<const Packet> &packet)
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_stop)
+        {
+            return;
+        }
+
+        if (_queue.size() >= _size)
+        {
+            if (_policy == OverflowPolicy::BLOCK)
+            {
+                _not_full.wait(lock, [this] { return _queue.size() < _size || _stop; });
+                if (_stop)
+                {
+                    return;
+                }
+            }
+            else
+            {
+                _dropped++;
+                Logger::instance().count(LogLevel::warn, "async observer dropped %u frames: %s inbox full", _name.c_str());
+                if (_policy == OverflowPolicy::DROP_NEWEST)
+                {
+                    return;
+                }
+                _queue.pop_front();
+            }
+        }
+        _queue.push_back(packet);
+    }
+    _not_empty.notify_one();
+}
+
+AsyncObserverStats AsyncStreamDispatcher::Inbox::getStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    AsyncObserverStats stats;
+    stats.name = _name;
+    stats.queued = _queue.size();
+    stats.delivered = _delivered;
+    stats.dropped = _dropped;
+    stats.lag_s = _lag_s;
+    stats.max_lag_s = _max_lag_s;
+    return stats;
+}
+
+void AsyncStreamDispatcher::Inbox::executorThread()
+{
+    while (true)
+    {
+        std::shared_ptr<const Packet> packet;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _not_empty.wait(lock, [this] { return !_queue.empty() || _stop; });
+            if (_stop)
+            {
+                break;
+            }
+            packet = _queue.front();
+            _queue.pop_front();
+
+            _lag_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - packet->enqueued).count();
+            _max_lag_s = std::max(_max_lag_s, _lag_s);
+        }
+        _not_full.notify_one();
+
+        StreamData data;
+        data.packet_number = packet->packet_number;
+        data.data = const_cast<unsigned char*>(packet->data.data());
+        data.size = packet->data.size();
+        notifyObservers(*packet->info, data);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _delivered++;
+    }
+}
+
+
+AsyncStreamDispatcher::~AsyncStreamDispatcher()
+{
+    stop();
+}
+
+void AsyncStreamDispatcher::addObserver(
+    DataSubject<StreamInfo, StreamData> &subject,
+    const std::string &name,
+    DataObserver<StreamInfo, StreamData> &observer,
+    const std::vector<StreamInfo> &streams,
+    size_t inbox_size,
+    OverflowPolicy policy
+)
+{
+    std::unique_ptr<Inbox> inbox(new Inbox(name, streams, inbox_size, policy));
+    for (const auto &info : streams)
+    {
+        observer.observe(*inbox, info);
+    }
+    inbox->start();
+
+    std::vector<StreamInfo> new_streams;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &info : streams)
+        {
+            if (_stream_infos.count(info.name) == 0)
+            {
+                _stream_infos[info.name] = std::make_shared<const StreamInfo>(info);
+                new_streams.push_back(info);
+            }
+        }
+        _inboxes.push_back(std::move(inbox));
+    }
+
+    // the subject may call onNewDataSubject() from observe()
+    for (const auto &info : new_streams)
+    {
+        observe(subject, info);
+    }
+}
+
+std::vector<AsyncObserverStats> AsyncStreamDispatcher::getStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<AsyncObserverStats> result;
+    for (const auto &inbox : _inboxes)
+    {
+        result.push_back(inbox->getStats());
+    }
+    return result;
+}
+
+void AsyncStreamDispatcher::stop()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto &inbox : _inboxes)
+    {
+        inbox->stop();
+    }
+}
+
+void AsyncStreamDispatcher::onNewDataSubject(const StreamInfo &)
+{
+    // stream infos are registered by addObserver()
+}
+
+void AsyncStreamDispatcher::onNewData(
+    const StreamInfo &info,
+    const StreamData &data
+)
+{
+    std::vector<Inbox*> inboxes;
+    std::shared_ptr<Packet> packet;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto &inbox : _inboxes)
+        {
+            if (inbox->accepts(info.name))
+            {
+                inboxes.push_back(inbox.get());
+            }
+        }
+        if (inboxes.empty())
+        {
+            return;
+        }
+
+        packet = std::make_shared<Packet>();
+        packet->info = _stream_infos[info.name];
+    }
+
+    // the only copy, the inboxes share the packet
+    const unsigned char *bytes = static_cast<const unsigned char*>(data.data);
+    packet->packet_number = data.packet_number;
+    packet->data.assign(bytes, bytes + data.size);
+    packet->enqueued = std::chrono::steady_clock::now();
+
+    // inboxes are only removed in the destructor, after the subject stopped
+    for (Inbox *inbox : inboxes)
+    {
+        inbox->push(packet);
+    }
+}
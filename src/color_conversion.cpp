@@ -0,0 +1,422 @@
+#include <string.h>
+
+#include <algorithm>
+
+#include "color_conversion.hpp"
+#include "parallel_for.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTHAI_YUV_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTHAI_YUV_NEON
+#endif
+
+
+// BT.601 limited range, 6 fractional bits. Intermediate values fit in int16,
+// so SIMD and scalar paths give the same result.
+static constexpr int c_yuv_shift   = 6;
+static constexpr int c_yuv_y_coeff = 74;    // 1.164
+static constexpr int c_yuv_rv      = 102;   // 1.596
+static constexpr int c_yuv_gv      = 52;    // 0.813
+static constexpr int c_yuv_gu      = 25;    // 0.391
+static constexpr int c_yuv_bu      = 129;   // 2.018
+// (Y - 16) * c_yuv_y_coeff + rounding
+static constexpr int c_yuv_y_offset = (1 << (c_yuv_shift - 1)) - 16 * c_yuv_y_coeff;
+
+// row pairs per parallel task
+static constexpr int c_yuv_min_row_pairs = 8;
+
+
+int get_pixel_format_channels(PixelFormat format)
+{
+    return format == PixelFormat::GRAY ? 1 : 3;
+}
+
+size_t get_converted_size(int width, int height, PixelFormat format, bool downscale)
+{
+    const int scale = downscale ? 2 : 1;
+    return (size_t) (width / scale) * (height / scale) * get_pixel_format_channels(format);
+}
+
+
+namespace
+{
+
+struct RowPair
+{
+    const uint8_t *y0;
+    const uint8_t *y1;
+    const uint8_t *u;
+    const uint8_t *v;
+    int            uv_step;     // 1 for planar chroma, 2 for interleaved
+    uint8_t       *dst0;
+    uint8_t       *dst1;        // nullptr with downscale
+};
+
+inline uint8_t clamp_u8(int value)
+{
+    return (uint8_t) std::min(255, std::max(0, value));
+}
+
+inline void yuv_to_pixel(int y, int u, int v, bool rgb, uint8_t *px)
+{
+    const int yy = y * c_yuv_y_coeff + c_yuv_y_offset;
+    u -= 128;
+    v -= 128;
+    const uint8_t r = clamp_u8((yy + c_yuv_rv * v) >> c_yuv_shift);
+    const uint8_t g = clamp_u8((yy - c_yuv_gv * v - c_yuv_gu * u) >> c_yuv_shift);
+    const uint8_t b = clamp_u8((yy + c_yuv_bu * u) >> c_yuv_shift);
+    px[0] = rgb ? r : b;
+    px[1] = g;
+    px[2] = rgb ? b : r;
+}
+
+#if defined(DEPTHAI_YUV_SSE2)
+
+// 8 centered chroma values (int16) of the chroma row starting at x_chroma
+inline void load_chroma_8(const RowPair &rows, int x_chroma, __m128i &u, __m128i &v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    if (rows.uv_step == 2)
+    {
+        const __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows.u + 2 * x_chroma));
+        u = _mm_and_si128(uv, _mm_set1_epi16(0xFF));
+        v = _mm_srli_epi16(uv, 8);
+    }
+    else
+    {
+        u = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows.u + x_chroma)), zero);
+        v = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows.v + x_chroma)), zero);
+    }
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+}
+
+// y: 8 luma values (int16), chroma terms already scaled
+inline void yuv_to_rgb_8(__m128i y, __m128i rc, __m128i gc, __m128i bc, __m128i &r, __m128i &g, __m128i &b)
+{
+    y = _mm_add_epi16(_mm_mullo_epi16(y, _mm_set1_epi16(c_yuv_y_coeff)), _mm_set1_epi16(c_yuv_y_offset));
+    r = _mm_srai_epi16(_mm_adds_epi16(y, rc), c_yuv_shift);
+    g = _mm_srai_epi16(_mm_subs_epi16(y, gc), c_yuv_shift);
+    b = _mm_srai_epi16(_mm_adds_epi16(y, bc), c_yuv_shift);
+}
+
+// SSE2 has no byte shuffle, the interleave goes through the stack
+inline void store_interleaved(uint8_t *dst, __m128i c0, __m128i c1, __m128i c2, int count)
+{
+    alignas(16) uint8_t p0[16], p1[16], p2[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(p0), c0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(p1), c1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(p2), c2);
+    for (int i = 0; i < count; i++)
+    {
+        dst[3 * i + 0] = p0[i];
+        dst[3 * i + 1] = p1[i];
+        dst[3 * i + 2] = p2[i];
+    }
+}
+
+int convert_row_pair_simd(const RowPair &rows, int width, bool rgb)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i u, v;
+        load_chroma_8(rows, x / 2, u, v);
+
+        const __m128i rc = _mm_mullo_epi16(v, _mm_set1_epi16(c_yuv_rv));
+        const __m128i gc = _mm_add_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(c_yuv_gv)), _mm_mullo_epi16(u, _mm_set1_epi16(c_yuv_gu)));
+        const __m128i bc = _mm_mullo_epi16(u, _mm_set1_epi16(c_yuv_bu));
+
+        // each chroma sample covers two horizontal pixels
+        const __m128i rc_lo = _mm_unpacklo_epi16(rc, rc), rc_hi = _mm_unpackhi_epi16(rc, rc);
+        const __m128i gc_lo = _mm_unpacklo_epi16(gc, gc), gc_hi = _mm_unpackhi_epi16(gc, gc);
+        const __m128i bc_lo = _mm_unpacklo_epi16(bc, bc), bc_hi = _mm_unpackhi_epi16(bc, bc);
+
+        const uint8_t *y_rows[2] = {rows.y0, rows.y1};
+        uint8_t *dst_rows[2] = {rows.dst0, rows.dst1};
+        for (int row = 0; row < 2; row++)
+        {
+            const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y_rows[row] + x));
+            __m128i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+            yuv_to_rgb_8(_mm_unpacklo_epi8(y, zero), rc_lo, gc_lo, bc_lo, r_lo, g_lo, b_lo);
+            yuv_to_rgb_8(_mm_unpackhi_epi8(y, zero), rc_hi, gc_hi, bc_hi, r_hi, g_hi, b_hi);
+
+            const __m128i r = _mm_packus_epi16(r_lo, r_hi);
+            const __m128i g = _mm_packus_epi16(g_lo, g_hi);
+            const __m128i b = _mm_packus_epi16(b_lo, b_hi);
+            if (rgb)
+            {
+                store_interleaved(dst_rows[row] + 3 * x, r, g, b, 16);
+            }
+            else
+            {
+                store_interleaved(dst_rows[row] + 3 * x, b, g, r, 16);
+            }
+        }
+    }
+    return x;
+}
+
+// 16 pixels of both rows -> 8 averaged luma values (int16)
+inline __m128i average_2x2_8(const uint8_t *y0, const uint8_t *y1)
+{
+    const __m128i mask = _mm_set1_epi16(0xFF);
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y0));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y1));
+    const __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(_mm_and_si128(a, mask), _mm_srli_epi16(a, 8)),
+        _mm_add_epi16(_mm_and_si128(b, mask), _mm_srli_epi16(b, 8)));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+int convert_row_pair_downscale_simd(const RowPair &rows, int width, bool rgb)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i u, v;
+        load_chroma_8(rows, x / 2, u, v);
+
+        const __m128i rc = _mm_mullo_epi16(v, _mm_set1_epi16(c_yuv_rv));
+        const __m128i gc = _mm_add_epi16(_mm_mullo_epi16(v, _mm_set1_epi16(c_yuv_gv)), _mm_mullo_epi16(u, _mm_set1_epi16(c_yuv_gu)));
+        const __m128i bc = _mm_mullo_epi16(u, _mm_set1_epi16(c_yuv_bu));
+
+        __m128i r, g, b;
+        yuv_to_rgb_8(average_2x2_8(rows.y0 + x, rows.y1 + x), rc, gc, bc, r, g, b);
+        r = _mm_packus_epi16(r, r);
+        g = _mm_packus_epi16(g, g);
+        b = _mm_packus_epi16(b, b);
+        if (rgb)
+        {
+            store_interleaved(rows.dst0 + 3 * (x / 2), r, g, b, 8);
+        }
+        else
+        {
+            store_interleaved(rows.dst0 + 3 * (x / 2), b, g, r, 8);
+        }
+    }
+    return x;
+}
+
+int gray_row_pair_downscale_simd(const RowPair &rows, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i y = average_2x2_8(rows.y0 + x, rows.y1 + x);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(rows.dst0 + x / 2), _mm_packus_epi16(y, y));
+    }
+    return x;
+}
+
+#elif defined(DEPTHAI_YUV_NEON)
+
+inline void load_chroma_8(const RowPair &rows, int x_chroma, int16x8_t &u, int16x8_t &v)
+{
+    uint8x8_t u8, v8;
+    if (rows.uv_step == 2)
+    {
+        const uint8x8x2_t uv = vld2_u8(rows.u + 2 * x_chroma);
+        u8 = uv.val[0];
+        v8 = uv.val[1];
+    }
+    else
+    {
+        u8 = vld1_u8(rows.u + x_chroma);
+        v8 = vld1_u8(rows.v + x_chroma);
+    }
+    u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vdupq_n_s16(128));
+    v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vdupq_n_s16(128));
+}
+
+inline void yuv_to_rgb_8(int16x8_t y, int16x8_t rc, int16x8_t gc, int16x8_t bc, uint8x8_t &r, uint8x8_t &g, uint8x8_t &b)
+{
+    y = vmlaq_n_s16(vdupq_n_s16(c_yuv_y_offset), y, c_yuv_y_coeff);
+    r = vqshrun_n_s16(vqaddq_s16(y, rc), c_yuv_shift);
+    g = vqshrun_n_s16(vqsubq_s16(y, gc), c_yuv_shift);
+    b = vqshrun_n_s16(vqaddq_s16(y, bc), c_yuv_shift);
+}
+
+int convert_row_pair_simd(const RowPair &rows, int width, bool rgb)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        int16x8_t u, v;
+        load_chroma_8(rows, x / 2, u, v);
+
+        const int16x8_t rc = vmulq_n_s16(v, c_yuv_rv);
+        const int16x8_t gc = vmlaq_n_s16(vmulq_n_s16(v, c_yuv_gv), u, c_yuv_gu);
+        const int16x8_t bc = vmulq_n_s16(u, c_yuv_bu);
+
+        // each chroma sample covers two horizontal pixels
+        const int16x8x2_t rc2 = vzipq_s16(rc, rc);
+        const int16x8x2_t gc2 = vzipq_s16(gc, gc);
+        const int16x8x2_t bc2 = vzipq_s16(bc, bc);
+
+        const uint8_t *y_rows[2] = {rows.y0, rows.y1};
+        uint8_t *dst_rows[2] = {rows.dst0, rows.dst1};
+        for (int row = 0; row < 2; row++)
+        {
+            const uint8x16_t y = vld1q_u8(y_rows[row] + x);
+            uint8x8_t r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+            yuv_to_rgb_8(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y))), rc2.val[0], gc2.val[0], bc2.val[0], r_lo, g_lo, b_lo);
+            yuv_to_rgb_8(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(y))), rc2.val[1], gc2.val[1], bc2.val[1], r_hi, g_hi, b_hi);
+
+            uint8x16x3_t px;
+            px.val[0] = rgb ? vcombine_u8(r_lo, r_hi) : vcombine_u8(b_lo, b_hi);
+            px.val[1] = vcombine_u8(g_lo, g_hi);
+            px.val[2] = rgb ? vcombine_u8(b_lo, b_hi) : vcombine_u8(r_lo, r_hi);
+            vst3q_u8(dst_rows[row] + 3 * x, px);
+        }
+    }
+    return x;
+}
+
+inline uint16x8_t average_2x2_8(const uint8_t *y0, const uint8_t *y1)
+{
+    return vrshrq_n_u16(vaddq_u16(vpaddlq_u8(vld1q_u8(y0)), vpaddlq_u8(vld1q_u8(y1))), 2);
+}
+
+int convert_row_pair_downscale_simd(const RowPair &rows, int width, bool rgb)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        int16x8_t u, v;
+        load_chroma_8(rows, x / 2, u, v);
+
+        const int16x8_t rc = vmulq_n_s16(v, c_yuv_rv);
+        const int16x8_t gc = vmlaq_n_s16(vmulq_n_s16(v, c_yuv_gv), u, c_yuv_gu);
+        const int16x8_t bc = vmulq_n_s16(u, c_yuv_bu);
+
+        uint8x8_t r, g, b;
+        yuv_to_rgb_8(vreinterpretq_s16_u16(average_2x2_8(rows.y0 + x, rows.y1 + x)), rc, gc, bc, r, g, b);
+
+        uint8x8x3_t px;
+        px.val[0] = rgb ? r : b;
+        px.val[1] = g;
+        px.val[2] = rgb ? b : r;
+        vst3_u8(rows.dst0 + 3 * (x / 2), px);
+    }
+    return x;
+}
+
+int gray_row_pair_downscale_simd(const RowPair &rows, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        vst1_u8(rows.dst0 + x / 2, vmovn_u16(average_2x2_8(rows.y0 + x, rows.y1 + x)));
+    }
+    return x;
+}
+
+#else
+
+int convert_row_pair_simd(const RowPair &, int, bool) { return 0; }
+int convert_row_pair_downscale_simd(const RowPair &, int, bool) { return 0; }
+int gray_row_pair_downscale_simd(const RowPair &, int) { return 0; }
+
+#endif
+
+void convert_row_pair(const RowPair &rows, int width, PixelFormat format, bool downscale)
+{
+    const bool rgb = (format == PixelFormat::RGB);
+
+    if (format == PixelFormat::GRAY)
+    {
+        if (!downscale)
+        {
+            memcpy(rows.dst0, rows.y0, width);
+            memcpy(rows.dst1, rows.y1, width);
+            return;
+        }
+
+        for (int x = gray_row_pair_downscale_simd(rows, width); x < width; x += 2)
+        {
+            rows.dst0[x / 2] = (uint8_t) ((rows.y0[x] + rows.y0[x + 1] + rows.y1[x] + rows.y1[x + 1] + 2) >> 2);
+        }
+        return;
+    }
+
+    if (downscale)
+    {
+        for (int x = convert_row_pair_downscale_simd(rows, width, rgb); x < width; x += 2)
+        {
+            const int y = (rows.y0[x] + rows.y0[x + 1] + rows.y1[x] + rows.y1[x + 1] + 2) >> 2;
+            const int u = rows.u[(x / 2) * rows.uv_step];
+            const int v = rows.v[(x / 2) * rows.uv_step];
+            yuv_to_pixel(y, u, v, rgb, rows.dst0 + 3 * (x / 2));
+        }
+        return;
+    }
+
+    for (int x = convert_row_pair_simd(rows, width, rgb); x < width; x += 2)
+    {
+        const int u = rows.u[(x / 2) * rows.uv_step];
+        const int v = rows.v[(x / 2) * rows.uv_step];
+        yuv_to_pixel(rows.y0[x],     u, v, rgb, rows.dst0 + 3 * x);
+        yuv_to_pixel(rows.y0[x + 1], u, v, rgb, rows.dst0 + 3 * (x + 1));
+        yuv_to_pixel(rows.y1[x],     u, v, rgb, rows.dst1 + 3 * x);
+        yuv_to_pixel(rows.y1[x + 1], u, v, rgb, rows.dst1 + 3 * (x + 1));
+    }
+}
+
+} // namespace
+
+
+void convert_yuv420(
+    const uint8_t *yuv,
+    YuvLayout layout,
+    int width,
+    int height,
+    int stride,
+    uint8_t *dst,
+    PixelFormat format,
+    bool downscale
+)
+{
+    const uint8_t *chroma = yuv + (size_t) stride * height;
+    const int channels = get_pixel_format_channels(format);
+    const size_t dst_row = (size_t) (downscale ? width / 2 : width) * channels;
+
+    parallel_for(0, height / 2, [&](int pair_begin, int pair_end)
+    {
+        for (int pair = pair_begin; pair < pair_end; pair++)
+        {
+            RowPair rows;
+            rows.y0 = yuv + (size_t) (2 * pair) * stride;
+            rows.y1 = rows.y0 + stride;
+            if (layout == YuvLayout::NV12)
+            {
+                rows.u = chroma + (size_t) pair * stride;
+                rows.v = rows.u + 1;
+                rows.uv_step = 2;
+            }
+            else
+            {
+                rows.u = chroma + (size_t) pair * (stride / 2);
+                rows.v = chroma + (size_t) (stride / 2) * (height / 2) + (size_t) pair * (stride / 2);
+                rows.uv_step = 1;
+            }
+
+            if (downscale)
+            {
+                rows.dst0 = dst + (size_t) pair * dst_row;
+                rows.dst1 = nullptr;
+            }
+            else
+            {
+                rows.dst0 = dst + (size_t) (2 * pair) * dst_row;
+                rows.dst1 = rows.dst0 + dst_row;
+            }
+
+            convert_row_pair(rows, width, format, downscale);
+        }
+    }, c_yuv_min_row_pairs);
+}
@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "color_conversion_post_processor.hpp"
+#include "logger.hpp"
+#include "thread_settings.hpp"
+#include "depthai-shared/metadata/frame_metadata.hpp"
+
+
+namespace
+{
+
+struct YuvStream
+{
+    const char *name;
+    YuvLayout   layout;
+};
+
+// device streams carrying YUV 4:2:0 frames
+const YuvStream c_yuv_streams[] =
+{
+    { "color", YuvLayout::I420 },
+};
+
+struct ConversionSuffix
+{
+    const char *suffix;
+    PixelFormat format;
+};
+
+const ConversionSuffix c_conversion_suffixes[] =
+{
+    { "_bgr",  PixelFormat::BGR  },
+    { "_rgb",  PixelFormat::RGB  },
+    { "_gray", PixelFormat::GRAY },
+};
+
+const YuvStream* find_yuv_stream(const std::string &name)
+{
+    for (const auto &stream : c_yuv_streams)
+    {
+        if (name == stream.name)
+        {
+            return &stream;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+
+bool ColorConversionPostProcessor::parseStreamName(
+    const std::string &stream_name,
+    std::string &input_name,
+    PixelFormat &format
+)
+{
+    for (const auto &it : c_conversion_suffixes)
+    {
+        const size_t suffix_len = strlen(it.suffix);
+        if (stream_name.size() > suffix_len &&
+            stream_name.compare(stream_name.size() - suffix_len, suffix_len, it.suffix) == 0)
+        {
+            const std::string name = stream_name.substr(0, stream_name.size() - suffix_len);
+            if (find_yuv_stream(name) != nullptr)
+            {
+                input_name = name;
+                format = it.format;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ColorConversionPostProcessor::getYuvLayout(
+    const std::string &stream_name,
+    YuvLayout &layout
+)
+{
+    const YuvStream *stream = find_yuv_stream(stream_name);
+    if (stream == nullptr)
+    {
+        return false;
+    }
+    layout = stream->layout;
+    return true;
+}
+
+void ColorConversionPostProcessor::addOutput(
+    const std::string &input_name,
+    const std::string &output_name,
+    PixelFormat format,
+    bool downscale
+)
+{
+    Output output;
+    output.input_name = input_name;
+    output.output_name = output_name;
+    output.format = format;
+    output.downscale = downscale;
+    _outputs.push_back(output);
+}
+
+void ColorConversionPostProcessor::onNewData(
+    const StreamInfo &data_info,
+    const StreamData &data
+)
+{
+    apply_thread_settings(ThreadClass::POST_PROCESSING, data_info.name);
+
+    const YuvStream *yuv_stream = find_yuv_stream(data_info.name);
+    if (yuv_stream == nullptr || data.size < sizeof(FrameMetadata))
+    {
+        return;
+    }
+
+    // frame geometry is only known from the metadata
+    const unsigned char *yuv = (const unsigned char*) data.data;
+    FrameMetadata metadata;
+    memcpy(&metadata, yuv + data.size - sizeof(FrameMetadata), sizeof(FrameMetadata));
+
+    const int width  = metadata.spec.width;
+    const int height = metadata.spec.height;
+    const int stride = metadata.spec.stride != 0 ? metadata.spec.stride : width;
+
+    if (!metadata.isValid() || width <= 0 || height <= 0 || (width | height) & 1 ||
+        data.size < (size_t) stride * height * 3 / 2 + sizeof(FrameMetadata))
+    {
+        Logger::instance().count(LogLevel::warn, "ColorConversionPostProcessor: %u %s frames with invalid metadata", data_info.name.c_str());
+        return;
+    }
+
+    for (auto &output : _outputs)
+    {
+        if (output.input_name != data_info.name)
+        {
+            continue;
+        }
+
+        const int channels  = get_pixel_format_channels(output.format);
+        const int out_w     = output.downscale ? width / 2 : width;
+        const int out_h     = output.downscale ? height / 2 : height;
+        const size_t size   = get_converted_size(width, height, output.format, output.downscale);
+
+        output.buffer.resize(size + sizeof(FrameMetadata));
+        convert_yuv420(yuv, yuv_stream->layout, width, height, stride,
+            output.buffer.data(), output.format, output.downscale);
+
+        FrameMetadata *m = (FrameMetadata *)(output.buffer.data() + size);
+        memcpy(m, &metadata, sizeof(FrameMetadata));
+        m->frameSize    = size;
+        m->spec.width   = out_w;
+        m->spec.height  = out_h;
+        m->spec.stride  = out_w * channels;
+        m->spec.bytesPP = channels;
+
+        std::vector<int> dimensions = {out_h, out_w};
+        if (channels > 1)
+        {
+            dimensions.push_back(channels);
+        }
+
+        StreamInfo out_si(output.output_name.c_str(), output.buffer.size(), dimensions);
+
+        StreamData out_d;
+        out_d.packet_number = data.packet_number;
+        out_d.data = output.buffer.data();
+        out_d.size = output.buffer.size();
+
+        notifyObservers(out_si, out_d);
+    }
+}
@@ -0,0 +1,383 @@
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include "crop_resize.hpp"
+#include "parallel_for.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTHAI_CROP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTHAI_CROP_NEON
+#endif
+
+
+namespace
+{
+
+// All interpolations are separable weighted sums: output index i takes
+// sum(weight[k] * src[index[k]]) for k in [offset[i], offset[i + 1]).
+// Source indices used are in [lo, hi).
+struct SampleTable
+{
+    std::vector<int>   offset;
+    std::vector<int>   index;
+    std::vector<float> weight;
+    int                lo;
+    int                hi;
+
+    void reset()
+    {
+        offset.assign(1, 0);
+        index.clear();
+        weight.clear();
+        lo = 0x7fffffff;
+        hi = 0;
+    }
+
+    void add(int i, float w)
+    {
+        index.push_back(i);
+        weight.push_back(w);
+        lo = std::min(lo, i);
+        hi = std::max(hi, i + 1);
+    }
+
+    void next()
+    {
+        offset.push_back((int) index.size());
+    }
+};
+
+// Maps dst_size outputs onto [start, start + length) source pixels
+void build_table(
+    SampleTable &table,
+    float start, float length,
+    int src_size, int dst_size,
+    ResizeInterpolation interpolation
+)
+{
+    const float step = length / dst_size;
+    if (interpolation == ResizeInterpolation::AREA && step <= 1.f)
+    {
+        interpolation = ResizeInterpolation::BILINEAR;
+    }
+
+    table.reset();
+    for (int i = 0; i < dst_size; i++)
+    {
+        if (interpolation == ResizeInterpolation::NEAREST)
+        {
+            const int s = (int) floorf(start + (i + 0.5f) * step);
+            table.add(std::min(std::max(s, 0), src_size - 1), 1.f);
+        }
+        else if (interpolation == ResizeInterpolation::BILINEAR)
+        {
+            const float s = std::min(std::max(start + (i + 0.5f) * step - 0.5f, 0.f), (float) (src_size - 1));
+            const int s0 = (int) s;
+            const float w = s - s0;
+            table.add(s0, 1.f - w);
+            if (w > 0.f && s0 + 1 < src_size)
+            {
+                table.add(s0 + 1, w);
+            }
+        }
+        else
+        {
+            const float f0 = start + i * step;
+            const float f1 = f0 + step;
+            for (int s = std::max((int) floorf(f0), 0); s < std::min((int) ceilf(f1), src_size); s++)
+            {
+                const float cover = std::min(f1, s + 1.f) - std::max(f0, (float) s);
+                if (cover > 0.f)
+                {
+                    table.add(s, cover / step);
+                }
+            }
+        }
+        table.next();
+    }
+}
+
+// acc[i] (+)= row[i] * w
+void accumulate_row(const uint8_t *row, float w, float *acc, int n, bool first)
+{
+    int i = 0;
+#if defined(DEPTHAI_CROP_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 vw = _mm_set1_ps(w);
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        const __m128i q[4] = {
+            _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+            _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero),
+        };
+        for (int k = 0; k < 4; k++)
+        {
+            __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(q[k]), vw);
+            if (!first)
+            {
+                f = _mm_add_ps(f, _mm_loadu_ps(acc + i + 4 * k));
+            }
+            _mm_storeu_ps(acc + i + 4 * k, f);
+        }
+    }
+#elif defined(DEPTHAI_CROP_NEON)
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint8x16_t v = vld1q_u8(row + i);
+        const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        const uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        const uint32x4_t q[4] = {
+            vmovl_u16(vget_low_u16(lo)), vmovl_u16(vget_high_u16(lo)),
+            vmovl_u16(vget_low_u16(hi)), vmovl_u16(vget_high_u16(hi)),
+        };
+        for (int k = 0; k < 4; k++)
+        {
+            float32x4_t f = vmulq_n_f32(vcvtq_f32_u32(q[k]), w);
+            if (!first)
+            {
+                f = vaddq_f32(f, vld1q_f32(acc + i + 4 * k));
+            }
+            vst1q_f32(acc + i + 4 * k, f);
+        }
+    }
+#endif
+    for (; i < n; i++)
+    {
+        acc[i] = (first ? 0.f : acc[i]) + row[i] * w;
+    }
+}
+
+inline void store_value(uint8_t &dst, float v, float, float)
+{
+    dst = (uint8_t) std::min(std::max(v + 0.5f, 0.f), 255.f);
+}
+
+inline void store_value(float &dst, float v, float scale, float bias)
+{
+    dst = v * scale + bias;
+}
+
+struct CropJob
+{
+    const uint8_t *src;
+    TensorLayout   src_layout;
+    int            channels;
+    int            height;
+    int            width;
+    TensorLayout   dst_layout;
+    int            dst_height;
+    int            dst_width;
+    ResizeInterpolation interpolation;
+    bool           swap_rb;
+    const float   *scale;
+    const float   *bias;
+};
+
+// Per thread scratch, reused across boxes
+struct CropScratch
+{
+    SampleTable        x;
+    SampleTable        y;
+    std::vector<float> row;     // vertically filtered source span, source channel order
+};
+
+// Box in pixels, at least one pixel wide and high
+inline void box_to_pixels(float min_n, float max_n, int size, float &start, float &length)
+{
+    min_n = std::min(std::max(min_n, 0.f), 1.f);
+    max_n = std::min(std::max(max_n, 0.f), 1.f);
+    start = std::min(min_n, max_n) * size;
+    length = std::fabs(max_n - min_n) * size;
+    if (length < 1.f)
+    {
+        start = std::min(start, size - 1.f);
+        length = 1.f;
+    }
+}
+
+template <typename T>
+void crop_resize_box(const CropJob &job, const CropBox &box, CropScratch &scratch, T *dst)
+{
+    float x_start, x_length, y_start, y_length;
+    box_to_pixels(box.x_min, box.x_max, job.width, x_start, x_length);
+    box_to_pixels(box.y_min, box.y_max, job.height, y_start, y_length);
+
+    build_table(scratch.x, x_start, x_length, job.width, job.dst_width, job.interpolation);
+    build_table(scratch.y, y_start, y_length, job.height, job.dst_height, job.interpolation);
+
+    const int C = job.channels;
+    const bool src_chw = job.src_layout == TensorLayout::CHW;
+    const bool dst_chw = job.dst_layout == TensorLayout::CHW;
+    const int span = scratch.x.hi - scratch.x.lo;
+    const size_t plane = (size_t) job.height * job.width;
+    const size_t dst_plane = (size_t) job.dst_height * job.dst_width;
+    scratch.row.resize((size_t) span * C);
+    float *row = scratch.row.data();
+
+    // x indices become offsets into row
+    const int src_pixel_stride = src_chw ? 1 : C;
+    const int src_channel_stride = src_chw ? span : 1;
+    const int dst_pixel_stride = dst_chw ? 1 : C;
+    const size_t dst_channel_stride = dst_chw ? dst_plane : 1;
+    for (int &sx : scratch.x.index)
+    {
+        sx = (sx - scratch.x.lo) * src_pixel_stride;
+    }
+
+    for (int oy = 0; oy < job.dst_height; oy++)
+    {
+        // vertical pass over the source span, contiguous in both layouts
+        for (int k = scratch.y.offset[oy]; k < scratch.y.offset[oy + 1]; k++)
+        {
+            const int sy = scratch.y.index[k];
+            const float w = scratch.y.weight[k];
+            const bool first = k == scratch.y.offset[oy];
+            if (src_chw)
+            {
+                for (int c = 0; c < C; c++)
+                {
+                    accumulate_row(job.src + c * plane + (size_t) sy * job.width + scratch.x.lo, w, row + c * span, span, first);
+                }
+            }
+            else
+            {
+                accumulate_row(job.src + ((size_t) sy * job.width + scratch.x.lo) * C, w, row, span * C, first);
+            }
+        }
+
+        // horizontal pass
+        T *dst_row = dst + (size_t) oy * job.dst_width * dst_pixel_stride;
+        for (int c = 0; c < C; c++)
+        {
+            const int sc = (job.swap_rb && C == 3) ? 2 - c : c;
+            const float *src_channel = row + sc * src_channel_stride;
+            T *dst_channel = dst_row + c * dst_channel_stride;
+            for (int ox = 0; ox < job.dst_width; ox++)
+            {
+                float v = 0.f;
+                for (int k = scratch.x.offset[ox]; k < scratch.x.offset[ox + 1]; k++)
+                {
+                    v += scratch.x.weight[k] * src_channel[scratch.x.index[k]];
+                }
+                store_value(dst_channel[ox * dst_pixel_stride], v, job.scale[c], job.bias[c]);
+            }
+        }
+    }
+}
+
+template <typename T>
+void crop_resize_batch(const CropJob &job, const CropBox *boxes, int box_count, T *dst)
+{
+    if (box_count <= 0 || job.channels <= 0 || job.width <= 0 || job.height <= 0
+        || job.dst_width <= 0 || job.dst_height <= 0)
+    {
+        return;
+    }
+
+    const size_t image_size = (size_t) job.channels * job.dst_height * job.dst_width;
+    parallel_for(0, box_count, [&](int begin, int end)
+    {
+        CropScratch scratch;
+        for (int b = begin; b < end; b++)
+        {
+            crop_resize_box(job, boxes[b], scratch, dst + b * image_size);
+        }
+    });
+}
+
+CropJob make_job(
+    const uint8_t *src, TensorLayout src_layout,
+    int channels, int height, int width,
+    TensorLayout dst_layout, int dst_height, int dst_width,
+    ResizeInterpolation interpolation, bool swap_rb
+)
+{
+    CropJob job;
+    job.src           = src;
+    job.src_layout    = src_layout;
+    job.channels      = channels;
+    job.height        = height;
+    job.width         = width;
+    job.dst_layout    = dst_layout;
+    job.dst_height    = dst_height;
+    job.dst_width     = dst_width;
+    job.interpolation = interpolation;
+    job.swap_rb       = swap_rb;
+    job.scale         = nullptr;
+    job.bias          = nullptr;
+    return job;
+}
+
+} // namespace
+
+
+std::vector<CropBox> get_detection_boxes(const dai::Detections &detections, float min_confidence)
+{
+    std::vector<CropBox> boxes;
+    boxes.reserve(detections.detection_count);
+    for (unsigned i = 0; i < detections.detection_count; i++)
+    {
+        const dai::Detection &det = detections.detections[i];
+        if (det.confidence < min_confidence)
+        {
+            continue;
+        }
+
+        CropBox box;
+        box.x_min = std::min(std::max(det.x_min, 0.f), 1.f);
+        box.y_min = std::min(std::max(det.y_min, 0.f), 1.f);
+        box.x_max = std::min(std::max(det.x_max, 0.f), 1.f);
+        box.y_max = std::min(std::max(det.y_max, 0.f), 1.f);
+        boxes.push_back(box);
+    }
+    return boxes;
+}
+
+void crop_resize_batch_u8(
+    const uint8_t *src, TensorLayout src_layout,
+    int channels, int height, int width,
+    const CropBox *boxes, int box_count,
+    uint8_t *dst, TensorLayout dst_layout,
+    int dst_height, int dst_width,
+    ResizeInterpolation interpolation,
+    bool swap_rb
+)
+{
+    CropJob job = make_job(src, src_layout, channels, height, width, dst_layout, dst_height, dst_width, interpolation, swap_rb);
+    const std::vector<float> unused(std::max(channels, 0), 0.f);
+    job.scale = unused.data();
+    job.bias = unused.data();
+    crop_resize_batch(job, boxes, box_count, dst);
+}
+
+void crop_resize_batch_f32(
+    const uint8_t *src, TensorLayout src_layout,
+    int channels, int height, int width,
+    const CropBox *boxes, int box_count,
+    float *dst, TensorLayout dst_layout,
+    int dst_height, int dst_width,
+    ResizeInterpolation interpolation,
+    const float *mean,
+    const float *scale,
+    bool swap_rb
+)
+{
+    CropJob job = make_job(src, src_layout, channels, height, width, dst_layout, dst_height, dst_width, interpolation, swap_rb);
+    std::vector<float> scale_bias(2 * std::max(channels, 0));
+    for (int c = 0; c < channels; c++)
+    {
+        scale_bias[c] = scale ? scale[c] : 1.f;
+        scale_bias[channels + c] = -(mean ? mean[c] : 0.f) * scale_bias[c];
+    }
+    job.scale = scale_bias.data();
+    job.bias = scale_bias.data() + channels;
+    crop_resize_batch(job, boxes, box_count, dst);
+}
@@ -1,5 +1,10 @@
+#include <sstream>
+
 #include "device.hpp"
+#include "logger.hpp"
 #include "matrix_ops.hpp"
+#include "parallel_for.hpp"
+#include "rectification_mesh.hpp"
 // shared
 #include "depthai-shared/json_helper.hpp"
 #include "depthai-shared/depthai_constants.hpp"
@@ -30,8 +35,10 @@ constexpr static auto cmrc_depthai_usb2_patch_path = "depthai-usb2-patch.patch";
 // GLOBAL
 static XLinkGlobalHandler_t g_xlink_global_handler = {};
 
-Device::Device(std::string usb_device, bool usb2_mode){
-    
+Device::Device(std::string usb_device, bool usb2_mode, StartupProgressCallback progress_cb)
+{
+    begin_device_startup_report();
+
     // Binaries are resource compiled
     #ifdef DEPTHAI_RESOURCE_COMPILED_BINARIES
 
@@ -55,14 +62,16 @@ Device::Device(std::string usb_device, bool usb2_mode){
                 patched_cmd.resize(patched_size);
 
                 // Patch
+                const auto bspatch_begin = std::chrono::steady_clock::now();
                 int error = bspatch_mem( (uint8_t*) depthai_binary.begin(), depthai_binary.size(), (uint8_t*) depthai_usb2_patch.begin(), depthai_usb2_patch.size(), patched_cmd.data());
+                add_device_startup_phase("bspatch", bspatch_begin);
 
                 // if patch successful
                 if(!error){
                     // Boot
-                    init_device("", usb_device, patched_cmd.data(), patched_size);
+                    init_device("", usb_device, patched_cmd.data(), patched_size, progress_cb);
                 } else {
-                    std::cout << "Error while patching..." << std::endl;
+                    log_error("depthai: Error while patching...");
                     // TODO handle error (throw most likely)
                 }
 
@@ -70,7 +79,7 @@ Device::Device(std::string usb_device, bool usb2_mode){
                 auto depthai_usb2_binary = fs.open(cmrc_depthai_usb2_cmd_path);
                 uint8_t* binary = (uint8_t*) depthai_usb2_binary.begin();
                 long size = depthai_usb2_binary.size();
-                init_device("", usb_device, binary, size);
+                init_device("", usb_device, binary, size, progress_cb);
 
             #endif
 
@@ -79,7 +88,7 @@ Device::Device(std::string usb_device, bool usb2_mode){
             auto depthai_binary = fs.open(cmrc_depthai_cmd_path);
             uint8_t* binary = (uint8_t*) depthai_binary.begin();
             long size = depthai_binary.size();
-            init_device("", usb_device, binary, size);
+            init_device("", usb_device, binary, size, progress_cb);
 
         }
 
@@ -88,7 +97,9 @@ Device::Device(std::string usb_device, bool usb2_mode){
     // Binaries from default path (TODO)
 
     #endif
+}
 
+Device::Device(std::string usb_device, bool usb2_mode) : Device(usb_device, usb2_mode, nullptr){
 
 }
 
@@ -96,8 +107,87 @@ Device::Device() : Device("", false){
 
 }
 
+std::future<std::shared_ptr<Device>> Device::open_async(
+    std::string usb_device,
+    bool usb2_mode,
+    StartupProgressCallback progress_cb
+)
+{
+    return std::async(std::launch::async, [usb_device, usb2_mode, progress_cb]()
+    {
+        std::shared_ptr<Device> device(new Device(usb_device, usb2_mode, progress_cb));
+        if (device->g_xlink == nullptr)
+        {
+            throw std::runtime_error("Cannot initialize device");
+        }
+        return device;
+    });
+}
+
+// progress is reported only for the calls that got a callback, never for watchdog reboots
+static void notify_startup_progress(
+    const Device::StartupProgressCallback &progress_cb,
+    Device::StartupPhase phase,
+    float progress
+)
+{
+    if (progress_cb)
+    {
+        progress_cb(phase, progress);
+    }
+}
+
+static void add_startup_phase(
+    std::vector<StartupReport::Phase> &phases,
+    const std::string &name,
+    std::chrono::steady_clock::time_point section_begin,
+    std::chrono::steady_clock::time_point phase_begin
+)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+
+    StartupReport::Phase phase;
+    phase.name        = name;
+    phase.offset_ms   = ms(phase_begin - section_begin).count();
+    phase.duration_ms = ms(std::chrono::steady_clock::now() - phase_begin).count();
+    phases.push_back(phase);
+}
+
+void Device::begin_device_startup_report()
+{
+    std::lock_guard<std::mutex> lock(startup_report_mutex);
+    device_startup_begin = std::chrono::steady_clock::now();
+    startup_report.device_phases.clear();
+}
+
+void Device::begin_pipeline_startup_report()
+{
+    std::lock_guard<std::mutex> lock(startup_report_mutex);
+    pipeline_startup_begin = std::chrono::steady_clock::now();
+    startup_report.pipeline_phases.clear();
+}
+
+void Device::add_device_startup_phase(const std::string &name, std::chrono::steady_clock::time_point phase_begin)
+{
+    std::lock_guard<std::mutex> lock(startup_report_mutex);
+    add_startup_phase(startup_report.device_phases, name, device_startup_begin, phase_begin);
+}
+
+void Device::add_pipeline_startup_phase(const std::string &name, std::chrono::steady_clock::time_point phase_begin)
+{
+    std::lock_guard<std::mutex> lock(startup_report_mutex);
+    add_startup_phase(startup_report.pipeline_phases, name, pipeline_startup_begin, phase_begin);
+}
+
+StartupReport Device::get_startup_report()
+{
+    std::lock_guard<std::mutex> lock(startup_report_mutex);
+    return startup_report;
+}
+
 Device::Device(std::string cmd_file, std::string usb_device){
-        
+
+    begin_device_startup_report();
     if(!init_device(cmd_file, usb_device)){
         throw std::runtime_error("Cannot initialize device");
     }
@@ -130,11 +220,12 @@ bool Device::is_right_connected(){
 
 void Device::wdog_thread(std::chrono::milliseconds& wd_timeout)
 {
-    std::cout << "watchdog started " << std::endl;
+    log_info("watchdog started");
     const std::chrono::milliseconds poll_rate(100);
     const auto sleep_nr = wd_timeout / poll_rate;
     while(wdog_thread_alive)
     {
+        apply_thread_settings(ThreadClass::WATCHDOG);
         wdog_keep = 0;
         for(int i = 0; i < sleep_nr; i++)
         {
@@ -146,9 +237,10 @@ void Device::wdog_thread(std::chrono::milliseconds& wd_timeout)
         }
         if(wdog_keep == 0 && wdog_thread_alive == 1)
         {
-            std::cout << "watchdog triggered " << std::endl;
+            log_warn("watchdog triggered");
             device_changed = true;
             soft_deinit_device();
+            begin_device_startup_report();
             bool init;
             for(int retry = 0; retry < 1; retry++)
             {
@@ -196,8 +288,9 @@ int Device::read_and_parse_config_d2h(void)
 {
     // config_d2h
     {
-        printf("Loading config file\n");
+        log_info("Loading config file");
 
+        const auto phase_begin = std::chrono::steady_clock::now();
         std::string config_d2h_str;
         StreamInfo si("config_d2h", 102400);
 
@@ -211,12 +304,62 @@ int Device::read_and_parse_config_d2h(void)
         }
         if (!getJSONFromString(config_d2h_str, g_config_d2h))
         {
-            std::cout << "depthai: error parsing config_d2h\n";
+            log_error("depthai: error parsing config_d2h");
         }
+        add_device_startup_phase("read_and_parse_config_d2h", phase_begin);
     }
     return 0;
 }
 
+// Prints count calibration values, per_line values on each line
+static void print_calib_values(const std::vector<float> &calib, int count, int per_line)
+{
+    std::string line;
+    for (int i = 0; i < count; i++) {
+        char value[32];
+        snprintf(value, sizeof(value), " %11.6f,", calib.at(i));
+        line += value;
+        if (i % per_line == per_line - 1) {
+            log_info("%s", line.c_str());
+            line.clear();
+        }
+    }
+}
+
+// Reads row-major 3x3 calibration matrix from eeprom json and prints it
+static Mat3f get_and_print_mat3(const nlohmann::json &eeprom, const char *key)
+{
+    std::vector<float> calib = eeprom.at(key).get<std::vector<float>>();
+    print_calib_values(calib, 9, 3);
+    return Mat3f::fromRowMajor(calib.data());
+}
+
+// Device stream used as input of a host post processor. max_fps 0 is unlimited,
+// the least limiting request wins
+static void add_host_input_stream(std::map<std::string, float> &streams, const std::string &name, float max_fps)
+{
+    auto it = streams.find(name);
+    if (it == streams.end())
+    {
+        streams[name] = max_fps;
+    }
+    else if (it->second != 0.f && (max_fps == 0.f || max_fps > it->second))
+    {
+        it->second = max_fps;
+    }
+}
+
+// H = M_new * R_rect * M^-1, zero matrix if M is singular
+static Mat3f rectification_homography(const Mat3f &M_new, const Mat3f &R_rect, const Mat3f &M)
+{
+    Mat3f M_inv;
+    if (!mat_inv(M, M_inv))
+    {
+        return Mat3f();
+    }
+    return M_new * R_rect * M_inv;
+}
+
 void Device::load_and_print_config_d2h(void)
 {
 
@@ -225,7 +368,7 @@ void Device::load_and_print_config_d2h(void)
     bool right_connected = g_config_d2h.at("_cams").at("right").get<bool>();
     if(!rgb_connected && (left_connected ^ right_connected))
     {
-        std::cerr << WARNING "ERROR: No cameras detected on the board. \n" ENDC;
+        log_error(WARNING "ERROR: No cameras detected on the board. " ENDC);
         //break;
     }
 
@@ -236,7 +379,7 @@ void Device::load_and_print_config_d2h(void)
         std::string device_version = g_config_d2h.at("_version").get<std::string>();
         if (device_version != c_depthai_version)
         {
-            printf("Version does not match (%s & %s)\n",
+            log_error("Version does not match (%s & %s)",
                 device_version.c_str(), c_depthai_version);
             break;
         }
@@ -244,250 +387,119 @@ void Device::load_and_print_config_d2h(void)
         std::string device_dev_version = g_config_d2h.at("_dev_version").get<std::string>();
         if (device_dev_version != c_depthai_dev_version)
         {
-            printf("WARNING: Version (dev) does not match (%s & %s)\n",
+            log_warn("WARNING: Version (dev) does not match (%s & %s)",
                 device_dev_version.c_str(), c_depthai_dev_version);
         }
         */
     }
 
     version = g_config_d2h.at("eeprom").at("version").get<decltype(version)>();
-    printf("EEPROM data:");
-    H1_l.clear();
-    H2_r.clear();
-    R1_l.clear();
-    R2_r.clear();
-    M1_l.clear();
-    M2_r.clear();
-    R.clear();
-    T.clear();
+    H1_l = Mat3f();
+    H2_r = Mat3f();
+    R1_l = Mat3f();
+    R2_r = Mat3f();
+    M1_l = Mat3f();
+    M2_r = Mat3f();
+    R = Mat3f();
+    T = Vec3f();
     d1_l.clear();
     d2_r.clear();
-    std::vector<float> temp;
+    intrinsics_loaded = false;
 
     if (version == -1) {
-        printf(" invalid / unprogrammed\n");
+        log_info("EEPROM data: invalid / unprogrammed");
     } else {
-        printf(" valid (v%d)\n", version);
+        const nlohmann::json &eeprom = g_config_d2h.at("eeprom");
+        log_info("EEPROM data: valid (v%d)", version);
         std::string board_name;
         std::string board_rev;
         float rgb_fov_deg = 0;
         bool stereo_center_crop = false;
         if (version >= 2) {
-            board_name = g_config_d2h.at("eeprom").at("board_name").get<std::string>();
-            board_rev  = g_config_d2h.at("eeprom").at("board_rev").get<std::string>();
-            rgb_fov_deg= g_config_d2h.at("eeprom").at("rgb_fov_deg").get<float>();
+            board_name = eeprom.at("board_name").get<std::string>();
+            board_rev  = eeprom.at("board_rev").get<std::string>();
+            rgb_fov_deg= eeprom.at("rgb_fov_deg").get<float>();
         }
         if (version >= 3) {
-            stereo_center_crop = g_config_d2h.at("eeprom").at("stereo_center_crop").get<bool>();
+            stereo_center_crop = eeprom.at("stereo_center_crop").get<bool>();
         }
-        float left_fov_deg = g_config_d2h.at("eeprom").at("left_fov_deg").get<float>();
-        float left_to_right_distance_m = g_config_d2h.at("eeprom").at("left_to_right_distance_m").get<float>();
-        float left_to_rgb_distance_m = g_config_d2h.at("eeprom").at("left_to_rgb_distance_m").get<float>();
-        bool swap_left_and_right_cameras = g_config_d2h.at("eeprom").at("swap_left_and_right_cameras").get<bool>();
+        float left_fov_deg = eeprom.at("left_fov_deg").get<float>();
+        float left_to_right_distance_m = eeprom.at("left_to_right_distance_m").get<float>();
+        float left_to_rgb_distance_m = eeprom.at("left_to_rgb_distance_m").get<float>();
+        bool swap_left_and_right_cameras = eeprom.at("swap_left_and_right_cameras").get<bool>();
         std::vector<float> calib;
-        printf("  Board name     : %s\n", board_name.empty() ? "<NOT-SET>" : board_name.c_str());
-        printf("  Board rev      : %s\n", board_rev.empty()  ? "<NOT-SET>" : board_rev.c_str());
-        printf("  HFOV L/R       : %g deg\n", left_fov_deg);
-        printf("  HFOV RGB       : %g deg\n", rgb_fov_deg);
-        printf("  L-R   distance : %g cm\n", 100 * left_to_right_distance_m);
-        printf("  L-RGB distance : %g cm\n", 100 * left_to_rgb_distance_m);
-        printf("  L/R swapped    : %s\n", swap_left_and_right_cameras ? "yes" : "no");
-        printf("  L/R crop region: %s\n", stereo_center_crop ? "center" : "top");
-        // std::cout << "H2 matrix of right came----------------> " << H2_r.size() <<  std::endl;
+        log_info("  Board name     : %s", board_name.empty() ? "<NOT-SET>" : board_name.c_str());
+        log_info("  Board rev      : %s", board_rev.empty()  ? "<NOT-SET>" : board_rev.c_str());
+        log_info("  HFOV L/R       : %g deg", left_fov_deg);
+        log_info("  HFOV RGB       : %g deg", rgb_fov_deg);
+        log_info("  L-R   distance : %g cm", 100 * left_to_right_distance_m);
+        log_info("  L-RGB distance : %g cm", 100 * left_to_rgb_distance_m);
+        log_info("  L/R swapped    : %s", swap_left_and_right_cameras ? "yes" : "no");
+        log_info("  L/R crop region: %s", stereo_center_crop ? "center" : "top");
 
         if (version <= 3) {
-            printf("  Calibration homography right to left (legacy, please consider recalibrating):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_old_H").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    H2_r.push_back(temp);
-                    temp.clear();
-                }
-            }
-                        // std::cout << "H2 matrix of right came----------------> " << H2_r.size() <<  std::endl;
+            log_info("  Calibration homography right to left (legacy, please consider recalibrating):");
+            H2_r = get_and_print_mat3(eeprom, "calib_old_H");
 
         } else if (version == 4) {
 
-            std::vector<std::vector<float>> temp_inv;
-
-            printf("  Calibration inverse homography H1 (left):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_H1_L").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    temp_inv.push_back(temp);
-                    temp.clear();
-                }
-            }
-
-            mat_inv(temp_inv, H1_l);
-            temp_inv.clear();
-
-            for (int i = 0; i < 9; ++i) {
-            }
-            printf("  Calibration inverse homography H2 (right):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_H2_R").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    temp_inv.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Calibration inverse homography H1 (left):");
+            mat_inv(get_and_print_mat3(eeprom, "calib_H1_L"), H1_l);
 
-            mat_inv(temp_inv, H2_r);
-            temp_inv.clear();
-
-            printf("  Calibration intrinsic matrix M1 (left):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_M1_L").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    M1_l.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Calibration inverse homography H2 (right):");
+            mat_inv(get_and_print_mat3(eeprom, "calib_H2_R"), H2_r);
 
-            printf("  Calibration intrinsic matrix M2 (right):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_M2_R").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    M2_r.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Calibration intrinsic matrix M1 (left):");
+            M1_l = get_and_print_mat3(eeprom, "calib_M1_L");
 
-            printf("  Calibration rotation matrix R:\n");
-            calib = g_config_d2h.at("eeprom").at("calib_R").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    R.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Calibration intrinsic matrix M2 (right):");
+            M2_r = get_and_print_mat3(eeprom, "calib_M2_R");
 
-            printf("  Calibration translation matrix T:\n");
-            calib = g_config_d2h.at("eeprom").at("calib_T").get<std::vector<float>>();
-            for (int i = 0; i < 3; i++) {
-                printf(" %11.6f,\n", calib.at(i));
-            }
-            T = calib;
+            log_info("  Calibration rotation matrix R:");
+            R = get_and_print_mat3(eeprom, "calib_R");
 
-        std::cout << "H2 matrix of right came----------------> " << H2_r.size() <<  std::endl;
+            log_info("  Calibration translation matrix T:");
+            calib = eeprom.at("calib_T").get<std::vector<float>>();
+            print_calib_values(calib, 3, 1);
+            T = Vec3f::fromVector(calib);
 
+            intrinsics_loaded = true;
         }
         else if (version == 5){
-            printf("  Rectification Rotation R1 (left):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_R1_L").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    R1_l.push_back(temp);
-                    temp.clear();
-                }
-            }
-            for (int i = 0; i < 9; ++i) {
-            }
-            printf("  Rectification Rotation R2 (right):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_R2_R").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    R2_r.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Rectification Rotation R1 (left):");
+            R1_l = get_and_print_mat3(eeprom, "calib_R1_L");
 
-            printf("  Calibration intrinsic matrix M1 (left):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_M1_L").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    M1_l.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Rectification Rotation R2 (right):");
+            R2_r = get_and_print_mat3(eeprom, "calib_R2_R");
 
-            printf("  Calibration intrinsic matrix M2 (right):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_M2_R").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    M2_r.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Calibration intrinsic matrix M1 (left):");
+            M1_l = get_and_print_mat3(eeprom, "calib_M1_L");
 
-            printf("  Calibration rotation matrix R:\n");
-            calib = g_config_d2h.at("eeprom").at("calib_R").get<std::vector<float>>();
-            for (int i = 0; i < 9; i++) {
-                printf(" %11.6f,", calib.at(i));
-                temp.push_back(calib.at(i));
-                if (i % 3 == 2) {
-                    printf("\n");
-                    R.push_back(temp);
-                    temp.clear();
-                }
-            }
+            log_info("  Calibration intrinsic matrix M2 (right):");
+            M2_r = get_and_print_mat3(eeprom, "calib_M2_R");
 
-            printf("  Calibration translation matrix T:\n");
-            calib = g_config_d2h.at("eeprom").at("calib_T").get<std::vector<float>>();
-            for (int i = 0; i < 3; i++) {
-                printf(" %11.6f,\n", calib.at(i));
-            }
-            T = calib;
-
-            printf("  Calibration Distortion Coeff d1 (Left):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_d1_L").get<std::vector<float>>();
-            for (int i = 0; i < 14; i++) {
-                printf(" %11.6f,", calib.at(i));
-                if (i % 7 == 6)
-                    printf("\n");
-            }
+            log_info("  Calibration rotation matrix R:");
+            R = get_and_print_mat3(eeprom, "calib_R");
+
+            log_info("  Calibration translation matrix T:");
+            calib = eeprom.at("calib_T").get<std::vector<float>>();
+            print_calib_values(calib, 3, 1);
+            T = Vec3f::fromVector(calib);
+
+            log_info("  Calibration Distortion Coeff d1 (Left):");
+            calib = eeprom.at("calib_d1_L").get<std::vector<float>>();
+            print_calib_values(calib, 14, 7);
             d1_l = calib;
 
-            printf("  Calibration Distortion Coeff d2 (Right):\n");
-            calib = g_config_d2h.at("eeprom").at("calib_d2_R").get<std::vector<float>>();
-            for (int i = 0; i < 14; i++) {
-                printf(" %11.6f,", calib.at(i));
-                if (i % 7 == 6)
-                    printf("\n");
-            }
+            log_info("  Calibration Distortion Coeff d2 (Right):");
+            calib = eeprom.at("calib_d2_R").get<std::vector<float>>();
+            print_calib_values(calib, 14, 7);
             d2_r = calib;
 
-            std::vector<std::vector<float>> M2_r_inv;
-            std::vector<std::vector<float>> M1_l_inv;
-            std::vector<std::vector<float>> left_matrix = mat_mul(M2_r, R2_r);
+            intrinsics_loaded = true;
 
-            mat_inv(M2_r, M2_r_inv);
-            H2_r = mat_mul(left_matrix, M2_r_inv);
-
-            left_matrix = mat_mul(M2_r, R1_l);
-            mat_inv(M1_l, M1_l_inv);
-            H1_l = mat_mul(left_matrix, M1_l_inv);
+            H2_r = rectification_homography(M2_r, R2_r, M2_r);
+            H1_l = rectification_homography(M2_r, R1_l, M1_l);
         }
     }
     return;
@@ -497,7 +509,8 @@ bool Device::init_device(
     const std::string &device_cmd_file,
     const std::string &usb_device,
     uint8_t* binary,
-    long binary_size
+    long binary_size,
+    const StartupProgressCallback &progress_cb
 )
 {
     cmd_backup = device_cmd_file;
@@ -506,7 +519,7 @@ bool Device::init_device(
     binary_size_backup = binary_size;
     bool result = false;
     std::string error_msg;
-
+    const auto init_begin = std::chrono::steady_clock::now();
 
     do
     {
@@ -514,12 +527,14 @@ bool Device::init_device(
         if (nullptr != g_xlink)
         {
             error_msg = "Device is already initialized.";
-            std::cout << error_msg << "\n";
+            log_error("%s", error_msg.c_str());
             break;
         }
 
         g_xlink = std::unique_ptr<XLinkWrapper>(new XLinkWrapper(true));
 
+        notify_startup_progress(progress_cb, StartupPhase::BOOT, 0.f);
+        const auto boot_begin = std::chrono::steady_clock::now();
         if(binary != nullptr && binary_size != 0){
             if (!g_xlink->initFromHostSide(
                 &g_xlink_global_handler,
@@ -529,7 +544,7 @@ bool Device::init_device(
                 true)
             )
             {
-                std::cout << "depthai: Error initializing xlink\n";
+                log_error("depthai: Error initializing xlink");
                 break;
             }
         } else {
@@ -541,23 +556,30 @@ bool Device::init_device(
                 true)
             )
             {
-                std::cout << "depthai: Error initializing xlink\n";
+                log_error("depthai: Error initializing xlink");
                 break;
             }
         }
 
+        add_device_startup_phase("boot", boot_begin);
+        notify_startup_progress(progress_cb, StartupPhase::BOOT, 1.f);
+
         // usb_speed = 
         // mx_serial =
         std::vector<std::string> speed_str = {"Unknown", "Low/1.5Mbps", "Full/12Mbps", "High/480Mbps", "Super/5000Mbps", "Super+/10000Mbps"};
-        std::cout <<"Usb speed : " << speed_str[g_xlink->getUSBSpeed()] << std::endl;
-        std::cout <<"Mx serial id : " << g_xlink->getMxSerial() << std::endl;
+        log_info("Usb speed : %s", speed_str[g_xlink->getUSBSpeed()].c_str());
+        log_info("Mx serial id : %s", g_xlink->getMxSerial().c_str());
         
         g_xlink->setWatchdogUpdateFunction(std::bind(&Device::wdog_keepalive, this));
         wdog_start();
 
+        notify_startup_progress(progress_cb, StartupPhase::CONFIG_D2H, 0.f);
         if (read_and_parse_config_d2h() != 0)
             break;
+        const auto load_begin = std::chrono::steady_clock::now();
         load_and_print_config_d2h();
+        add_device_startup_phase("load_and_print_config_d2h", load_begin);
+        notify_startup_progress(progress_cb, StartupPhase::CONFIG_D2H, 1.f);
 
         result = true;
     } while (false);
@@ -569,6 +591,7 @@ bool Device::init_device(
         // throw std::exception();
     }
 
+    add_device_startup_phase("init_device", init_begin);
     return result;
 }
 
@@ -592,28 +615,29 @@ std::vector<std::string> Device::get_available_streams()
 }
 
 bool Device::is_eeprom_loaded(){
-    if(M1_l.empty() && M2_r.empty()) return false;
-    else return true;
+    return intrinsics_loaded;
 }
 
 
 std::vector<std::vector<float>> Device::get_left_intrinsic()
 {
     if (version < 4) {
-        std::cerr << "legacy, get_left_intrinsic() is not available in version " << version << "\n recalibrate and load the new calibration to the device. \n";
+        log_error("legacy, get_left_intrinsic() is not available in version %d\n recalibrate and load the new calibration to the device. ", version);
+        Logger::instance().flush();
         abort();
     }
-    return M1_l;
+    return M1_l.toVector();
 }
 
 std::vector<std::vector<float>> Device::get_left_homography()
 {
     if (version < 4) {
-        std::cerr << "legacy, get_left_homography() is not available in version " << version << "\n recalibrate and load the new calibration to the device. \n";
+        log_error("legacy, get_left_homography() is not available in version %d\n recalibrate and load the new calibration to the device. ", version);
+        Logger::instance().flush();
         abort();
     }
     else {
-        return H1_l;
+        return H1_l.toVector();
     }
     
 }
@@ -621,15 +645,19 @@ std::vector<std::vector<float>> Device::get_left_homography()
 std::vector<std::vector<float>> Device::get_right_intrinsic()
 {
     if (version < 4) {
-        std::cerr << "legacy, get_right_intrinsic() is not available in version " << version << "\n recalibrate and load the new calibration to the device. \n";
+        log_error("legacy, get_right_intrinsic() is not available in version %d\n recalibrate and load the new calibration to the device. ", version);
+        Logger::instance().flush();
         abort();
     }
-    return M2_r;
+    return M2_r.toVector();
 }
 
 std::vector<std::vector<float>> Device::get_right_homography()
 {
-    return H2_r;
+    if (version == -1) {
+        return {};
+    }
+    return H2_r.toVector();
 }
 
 bool Device::is_usb3()
@@ -643,19 +671,21 @@ bool Device::is_usb3()
 std::vector<std::vector<float>> Device::get_rotation()
 {
     if (version < 4) {
-        std::cerr << "legacy, get_rotation() is not available in version " << version << "\n recalibrate and load the new calibration to the device. \n";
+        log_error("legacy, get_rotation() is not available in version %d\n recalibrate and load the new calibration to the device. ", version);
+        Logger::instance().flush();
         abort();
     }
-    return R;
+    return R.toVector();
 }
 
 std::vector<float> Device::get_translation()
 {
     if (version < 4) {
-        std::cerr << "legacy, get_Translation() is not available in version " << version << "\n recalibrate and load the new calibration to the device. \n";
+        log_error("legacy, get_Translation() is not available in version %d\n recalibrate and load the new calibration to the device. ", version);
+        Logger::instance().flush();
         abort();
     }
-    return T;
+    return T.toVector();
 }
 
 
@@ -669,20 +699,24 @@ std::shared_ptr<CNNHostPipeline> Device::get_pipeline(){
 
 
 std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
-    const std::string &config_json_str
+    const std::string &config_json_str,
+    const StartupProgressCallback &progress_cb
 )
 {
     using json = nlohmann::json;
 
     config_backup = config_json_str;
 
+    begin_pipeline_startup_report();
+    const auto create_pipeline_begin = std::chrono::steady_clock::now();
+
     bool init_ok = false;
     do
     {
         // check xlink
         if (nullptr == g_xlink)
         {
-            std::cerr << WARNING "device is not initialized\n" ENDC;
+            log_error(WARNING "device is not initialized" ENDC);
             break;
         }
 
@@ -690,7 +724,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         json config_json;
         if (!getJSONFromString(config_json_str, config_json))
         {
-            std::cerr << WARNING "Error: Cant parse json config :" << config_json_str << "\n" ENDC;
+            log_error(WARNING "Error: Cant parse json config :%s" ENDC, config_json_str.c_str());
             break;
         }
 
@@ -698,17 +732,40 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         HostPipelineConfig config;
         if (!config.initWithJSON(config_json))
         {
-            std::cerr << "Error: Cant init configs with json: " << config_json.dump() << "\n";
+            log_error("Error: Cant init configs with json: %s", config_json.dump().c_str());
             break;
         }
 
+        set_thread_settings(ThreadClass::WATCHDOG, config.app_config.threads.watchdog);
+        set_thread_settings(ThreadClass::STREAM_READER, config.app_config.threads.stream_reader);
+        set_thread_settings(ThreadClass::POST_PROCESSING, config.app_config.threads.post_processing);
+
+        ParallelForConfig parallel_for_config = get_parallel_for_config();
+        if (parallel_for_config.threads != config.app_config.parallel_for_threads)
+        {
+            parallel_for_config.threads = config.app_config.parallel_for_threads;
+            set_parallel_for_config(parallel_for_config);
+        }
+
+        // process wide, the last created pipeline sets them
+        FrameAllocConfig frame_alloc_config = get_frame_alloc_config();
+        frame_alloc_config.huge_pages = config.app_config.frame_huge_pages;
+        frame_alloc_config.recycle = config.app_config.realtime_packets_per_stream > 0;
+        set_frame_alloc_config(frame_alloc_config);
+
+        FrameBudget::instance().setLimit(size_t(config.app_config.frame_budget_MiB) * 1024 * 1024);
+        for (const auto &stream_priority : config.app_config.stream_priorities)
+        {
+            FrameBudget::instance().setStreamPriority(stream_priority.first, stream_priority.second);
+        }
+
         int num_stages = config.ai.blob_file2.empty() ? 1 : 2;
 
         // read tensor info
         std::vector<dai::TensorInfo>       tensors_info_output, tensors_info_input;
         std::vector<nlohmann::json>        NN_config;
 
-        std::cout << config.ai.blob_file_config << std::endl;
+        log_info("%s", config.ai.blob_file_config.c_str());
         std::ifstream jsonFile(config.ai.blob_file_config);
 
         nlohmann::json json_NN_meta;
@@ -719,7 +776,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
 
         if(!json_NN_.contains("NN_config"))
         {
-            std::cout << "No NN config provided, defaulting to \"raw\" output format!" << std::endl;
+            log_info("No NN config provided, defaulting to \"raw\" output format!");
             json_NN_meta["output_format"] = "raw";
         }
         else
@@ -753,7 +810,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
 
             if (config.depth.calibration_file.empty())
             {   
-                std::cout << "depthai: Calibration file is not specified, Falling back to using calibration from EEPROM.\n" << std::endl;
+                log_warn("depthai: Calibration file is not specified, Falling back to using calibration from EEPROM.\n");
                 config.board_config.store_to_eeprom = false;
                 config.board_config.override_eeprom = false;
             }
@@ -762,22 +819,23 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
                 HostDataReader calibration_reader;
                 if (!calibration_reader.init(config.depth.calibration_file))
                 {
-                    std::cerr << WARNING "depthai: Error opening calibration file: " << config.depth.calibration_file << "\n" ENDC;
+                    log_error(WARNING "depthai: Error opening calibration file: %s" ENDC, config.depth.calibration_file.c_str());
                     break;
                 }
 
                 const int homography_size = sizeof(float) * homography_count;
                 int sz = calibration_reader.getSize();
-                std::cout << homography_size << std::endl;
-                std::cout << sz << std::endl;
+                log_debug("%d", homography_size);
+                log_debug("%d", sz);
                 
                 if (sz < homography_size) {
                     if(version < 5 && config.board_config.store_to_eeprom){
-                        std::cerr << WARNING "Calibration file is outdated. Recalibration required before writing to EEPROM." << std::endl << "To continue using old calibration disable('-e') write to EEPROM.";
+                        log_error(WARNING "Calibration file is outdated. Recalibration required before writing to EEPROM.\nTo continue using old calibration disable('-e') write to EEPROM.");
+                        Logger::instance().flush();
                         abort();
                     }
                     else{
-                        std::cerr << WARNING "Calibration file size " << sz << ENDC " < smaller than expected, data ignored. Verify if calibration file is complete and correct or recalibrate\n";
+                        log_warn(WARNING "Calibration file size %d" ENDC " < smaller than expected, data ignored. Verify if calibration file is complete and correct or recalibrate", sz);
                     }
                 } else {
                     calibration_reader.readData(reinterpret_cast<unsigned char*>(calibration_buff.data()), homography_size);
@@ -791,108 +849,84 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         }
         else
         {
-            std::cout << "depthai: Using calibration from stored in EEPROM\n";
+            log_info("depthai: Using calibration from stored in EEPROM");
         }
     
 
 
         if(version > 4){
-            if(config.mono_cam_config.resolution_h == 800){
-                // create_mesh()
-            }
-            else if(config.mono_cam_config.resolution_h == 720){
+            if(config.mono_cam_config.resolution_h == 720){
                 // adjusting y axis of the image center since it was cancluated for width of 800.
                 
-                M1_l[1][2] -= 40;  
-                M2_r[1][2] -= 40;
+                M1_l(1, 2) -= 40;
+                M2_r(1, 2) -= 40;
             }
             else if(config.mono_cam_config.resolution_h == 400){
                 /* adjusting intrinsic matrix by multiplying everything by multiplying all the intrinisc 
                 *parameters by 0.5 except the right bottom corner which is a scale.
                 */
 
-                M1_l[0][0] *= 0.5; 
-                M1_l[0][2] *= 0.5;
-                M1_l[1][1] *= 0.5;
-                M1_l[1][2] *= 0.5;
+                M1_l(0, 0) *= 0.5;
+                M1_l(0, 2) *= 0.5;
+                M1_l(1, 1) *= 0.5;
+                M1_l(1, 2) *= 0.5;
 
-                M2_r[0][0] *= 0.5;
-                M2_r[0][2] *= 0.5;
-                M2_r[1][1] *= 0.5;
-                M2_r[1][2] *= 0.5;
+                M2_r(0, 0) *= 0.5;
+                M2_r(0, 2) *= 0.5;
+                M2_r(1, 1) *= 0.5;
+                M2_r(1, 2) *= 0.5;
             }
         
 
-            std::vector<std::vector<float>> M2_r_inv;
-            std::vector<std::vector<float>> M1_l_inv;
-            std::vector<std::vector<float>> left_matrix = mat_mul(M2_r, R2_r);     
-
-            mat_inv(M2_r, M2_r_inv);
-            H2_r = mat_mul(left_matrix, M2_r_inv);
-
-            left_matrix = mat_mul(M2_r, R1_l);
-            mat_inv(M1_l, M1_l_inv);
-            H1_l = mat_mul(left_matrix, M1_l_inv);
+            H2_r = rectification_homography(M2_r, R2_r, M2_r);
+            H1_l = rectification_homography(M2_r, R1_l, M1_l);
         }
         std::vector<float> left_mesh_buff(1,0);
         std::vector<float> right_mesh_buff(1,0);
-        config.depth.warp.use_mesh = false;
         if (config.depth.warp.use_mesh) {
 
-            const int map_size = 1280 * 800;
-            std::vector<float> left_x_map_buff(map_size, 0);
-            std::vector<float> right_x_map_buff(map_size, 0);
-            std::vector<float> left_y_map_buff(map_size, 0);
-            std::vector<float> right_y_map_buff(map_size, 0);
-
-            std::cout << "left map file: " << config.depth.left_mesh_file << std::endl;
-            std::cout << "right map file: " << config.depth.right_mesh_file << std::endl;
-
-            if (config.depth.left_mesh_file.empty() && config.depth.right_mesh_file.empty()) {
-                std::cout << "depthai: mesh file is not specified, will use Homography;\n";
-            } else if (config.depth.left_mesh_file.empty()) {
-                std::cout << "depthai: Only right camera mesh file is specified, Left camera mesh file not specified;\n";
-            } else if (config.depth.right_mesh_file.empty()) {
-                std::cout << "depthai: Only left camera mesh file is specified, Right camera mesh file not specified;\n";
-            } else {
+            // mesh files hold full resolution x and y maps
+            const int map_w = 1280;
+            const int map_h = 800;
+            const int res_w = config.mono_cam_config.resolution_w;
+            const int res_h = config.mono_cam_config.resolution_h;
+            const auto mesh_begin = std::chrono::steady_clock::now();
 
-                HostDataReader mesh_reader;
-                const int expectec_mesh_size = sizeof(float) * map_size * 2;
+            log_info("left map file: %s", config.depth.left_mesh_file.c_str());
+            log_info("right map file: %s", config.depth.right_mesh_file.c_str());
 
-                // Reading left mesh into the vector
-                if (!mesh_reader.init(config.depth.left_mesh_file)) {
-                    std::cerr << WARNING "depthai: Error opening left camera mesh file: " ENDC << config.depth.left_mesh_file << std::endl;
-                    //break;
-                } else {
-                    int file_sz = mesh_reader.getSize();
-                    assert(file_sz == expectec_mesh_size);
-                    mesh_reader.readData(reinterpret_cast<unsigned char*>(left_x_map_buff.data()), expectec_mesh_size);
-                    mesh_reader.readData(reinterpret_cast<unsigned char*>(left_y_map_buff.data()), expectec_mesh_size);
-                    mesh_reader.closeFile();
-                    int32_t res = config.mono_cam_config.resolution_h;
-                    // create_mesh(left_x_map_buff, left_y_map_buff, left_mesh_buff, res);
-                    // std::cout << "left mesh loaded with size :" << left_map_buff.size() << "  File size: " << file_sz << " expectec_mesh_size ->" << expectec_mesh_size << std::endl;
+            if (!config.depth.left_mesh_file.empty() && !config.depth.right_mesh_file.empty()) {
+                if (!create_rectification_mesh_from_map_file(config.depth.left_mesh_file, map_w, map_h, res_w, res_h, left_mesh_buff)) {
+                    log_error(WARNING "depthai: Error opening left camera mesh file: " ENDC "%s", config.depth.left_mesh_file.c_str());
+                    config.depth.warp.use_mesh = false;
+                }
+                if (!create_rectification_mesh_from_map_file(config.depth.right_mesh_file, map_w, map_h, res_w, res_h, right_mesh_buff)) {
+                    log_error(WARNING "depthai: Error opening right camera mesh file: " ENDC "%s", config.depth.right_mesh_file.c_str());
+                    config.depth.warp.use_mesh = false;
+                }
+            } else {
+                if (config.depth.left_mesh_file.empty() != config.depth.right_mesh_file.empty()) {
+                    log_warn("depthai: Only one camera mesh file is specified, generating both meshes from calibration;");
                 }
 
-                // Reading right mesh into the vector
-                if (!mesh_reader.init(config.depth.right_mesh_file)) {
-                    std::cerr << WARNING "depthai: Error opening right camera mesh file: " ENDC << config.depth.right_mesh_file << std::endl;
-                    //break;
+                if (version > 4 && intrinsics_loaded) {
+                    // intrinsics are already adjusted for the mono resolution above
+                    RectificationModel left_model(M1_l, R1_l, M2_r, d1_l);
+                    RectificationModel right_model(M2_r, R2_r, M2_r, d2_r);
+                    create_rectification_mesh_cached(left_model, res_w, res_h, left_mesh_buff);
+                    create_rectification_mesh_cached(right_model, res_w, res_h, right_mesh_buff);
                 } else {
-                    int file_sz = mesh_reader.getSize();
-                    assert(file_sz == expectec_mesh_size);
-                    mesh_reader.readData(reinterpret_cast<unsigned char*>(right_x_map_buff.data()), expectec_mesh_size);
-                    mesh_reader.readData(reinterpret_cast<unsigned char*>(right_y_map_buff.data()), expectec_mesh_size);
-                    mesh_reader.closeFile();
-
-
+                    log_info("depthai: mesh file is not specified and calibration has no distortion data, will use Homography;");
+                    config.depth.warp.use_mesh = false;
                 }
             }
-        } 
-        // else {
-        //     left_mesh_buff.resize(1);
-        //     right_mesh_buff.resize(1);
-        //     }
+
+            if (!config.depth.warp.use_mesh) {
+                left_mesh_buff.assign(1, 0);
+                right_mesh_buff.assign(1, 0);
+            }
+            add_pipeline_startup_phase("rectification_mesh", mesh_begin);
+        }
 
 
         bool rgb_connected = g_config_d2h.at("_cams").at("rgb").get<bool>();
@@ -908,20 +942,20 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
 
         if(!rgb_connected)
         {
-            std::cout << "RGB camera (IMX378) is not detected on board! \n";
+            log_warn("RGB camera (IMX378) is not detected on board! ");
             if(config.ai.camera_input == "rgb")
             {
-                std::cerr << WARNING "WARNING: NN inference was requested on RGB camera (IMX378), defaulting to right stereo camera (OV9282)! \n" ENDC;
+                log_warn(WARNING "WARNING: NN inference was requested on RGB camera (IMX378), defaulting to right stereo camera (OV9282)! " ENDC);
                 config.ai.camera_input = "right";
             }
         }
         if(left_connected ^ right_connected)
         {
             std::string cam_not_connected = (left_connected == false) ? "Left" : "Right";
-            std::cerr << WARNING "WARNING: "<< cam_not_connected << " stereo camera (OV9282) is not detected on board! \n" ENDC;
+            log_warn(WARNING "WARNING: %s stereo camera (OV9282) is not detected on board! " ENDC, cam_not_connected.c_str());
             if(config.ai.camera_input != "rgb")
             {
-                std::cerr << WARNING "WARNING: NN inference was requested on " << config.ai.camera_input << " stereo camera (OV9282), defaulting to RGB camera (IMX378)! \n" ENDC;
+                log_warn(WARNING "WARNING: NN inference was requested on %s stereo camera (OV9282), defaulting to RGB camera (IMX378)! " ENDC, config.ai.camera_input.c_str());
                 config.ai.camera_input = "rgb";
             }
         }
@@ -982,13 +1016,32 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
             {
                 if (!_blob_reader[stage].init(blob_file[stage]))
                 {
-                    std::cerr << WARNING "depthai: Error opening blob file: " << blob_file[stage] << "\n" ENDC;
+                    log_error(WARNING "depthai: Error opening blob file: %s" ENDC, blob_file[stage].c_str());
                     break;
                 }
                 size_blob[stage] = _blob_reader[stage].getSize();
             }
         }
 
+        // blobs are read from disk while config_h2d is exchanged with the device
+        std::future<std::vector<std::vector<uint8_t>>> blobs_read;
+        if (!config.ai.blob_file.empty())
+        {
+            blobs_read = std::async(std::launch::async, [this, &_blob_reader, &size_blob, num_stages]()
+            {
+                const auto phase_begin = std::chrono::steady_clock::now();
+                std::vector<std::vector<uint8_t>> buff_blobs(num_stages);
+                for (int stage = 0; stage < num_stages; stage++)
+                {
+                    buff_blobs[stage].resize(size_blob[stage]);
+                    const unsigned read_size = _blob_reader[stage].readData(buff_blobs[stage].data(), size_blob[stage]);
+                    log_debug("Read: %u", read_size);
+                }
+                add_pipeline_startup_phase("blob_read", phase_begin);
+                return buff_blobs;
+            });
+        }
+
         json_config_obj["ai"]["blob0_size"] = size_blob[0];
         json_config_obj["ai"]["blob1_size"] = (num_stages > 1) ? size_blob[1] : 0;
         json_config_obj["ai"]["calc_dist_to_bb"] = config.ai.calc_dist_to_bb;
@@ -1012,9 +1065,30 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         bool temp_measurement = false;
 
         std::vector<std::string> pipeline_device_streams;
+        // device streams consumed by the host post processors, with requested max_fps
+        std::map<std::string, float> host_input_streams;
+        std::vector<std::string> rectified_streams; // raw mono streams rectified on host
+        std::vector<HostPipelineConfig::StreamRequest> color_conversion_streams;
 
         for (const auto &stream : config.streams)
         {
+            if (stream.name == "left_rect" || stream.name == "right_rect")
+            {
+                const std::string raw_name = stream.name.substr(0, stream.name.size() - std::string("_rect").size());
+                rectified_streams.push_back(raw_name);
+                add_host_input_stream(host_input_streams, raw_name, stream.max_fps);
+                continue;
+            }
+
+            std::string conversion_input;
+            PixelFormat conversion_format;
+            if (ColorConversionPostProcessor::parseStreamName(stream.name, conversion_input, conversion_format))
+            {
+                color_conversion_streams.push_back(stream);
+                add_host_input_stream(host_input_streams, conversion_input, stream.max_fps);
+                continue;
+            }
+
             if (c_streams_myriad_to_pc[stream.name].dimensions[0] == MONO_RES_AUTO) {
                 c_streams_myriad_to_pc[stream.name].dimensions[0] = config.mono_cam_config.resolution_h;
                 c_streams_myriad_to_pc[stream.name].dimensions[1] = config.mono_cam_config.resolution_w;
@@ -1047,26 +1121,64 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
             }
         }
 
+        // device streams, needed by the host post processors, that were not requested explicitly
+        for (const auto &input : host_input_streams)
+        {
+            const std::string &input_name = input.first;
+            if (c_streams_myriad_to_pc[input_name].dimensions[0] == MONO_RES_AUTO) {
+                c_streams_myriad_to_pc[input_name].dimensions[0] = config.mono_cam_config.resolution_h;
+                c_streams_myriad_to_pc[input_name].dimensions[1] = config.mono_cam_config.resolution_w;
+            }
+
+            if (std::find(pipeline_device_streams.begin(), pipeline_device_streams.end(), input_name) == pipeline_device_streams.end())
+            {
+                json obj = { {"name", input_name} };
+                if (0.f != input.second) { obj["max_fps"] = input.second; };
+                json_config_obj["_pipeline"]["_streams"].push_back(obj);
+            }
+        }
+
 
         // host -> "config_h2d" -> device
+        const size_t config_h2d_size = g_streams_pc_to_myriad.at("config_h2d").size;
         std::string pipeline_config_str_packed = json_config_obj.dump();
-        std::cout << "config_h2d json:\n" << pipeline_config_str_packed << "\n";
+        if (pipeline_config_str_packed.size() >= config_h2d_size && config.depth.warp.use_mesh)
+        {
+            // the meshes take most of the config, the device warps with the homography instead
+            log_error(WARNING "depthai: rectification meshes don't fit in config_h2d (%zu of %zu bytes), will use Homography;" ENDC,
+                      pipeline_config_str_packed.size(), config_h2d_size);
+            config.depth.warp.use_mesh = false;
+            json_config_obj["_board"]["mesh_left"] = std::vector<float>(1, 0);
+            json_config_obj["_board"]["mesh_right"] = std::vector<float>(1, 0);
+            json_config_obj["depth"]["warp_rectify"]["use_mesh"] = false;
+            pipeline_config_str_packed = json_config_obj.dump();
+        }
+        log_debug("config_h2d json:\n%s", pipeline_config_str_packed.c_str());
         // resize, as xlink expects exact;y the same size for input:
-        std::cout << "size of input string json_config_obj to config_h2d is ->" << pipeline_config_str_packed.size() << std::endl;
+        log_debug("size of input string json_config_obj to config_h2d is ->%zu", pipeline_config_str_packed.size());
 
-        std::cout << "size of json_config_obj that is expected to be sent to config_h2d is ->" << g_streams_pc_to_myriad.at("config_h2d").size << std::endl;
+        log_debug("size of json_config_obj that is expected to be sent to config_h2d is ->%u", (unsigned) config_h2d_size);
 
-        assert(pipeline_config_str_packed.size() < g_streams_pc_to_myriad.at("config_h2d").size);
-        pipeline_config_str_packed.resize(g_streams_pc_to_myriad.at("config_h2d").size, 0);
+        if (pipeline_config_str_packed.size() >= config_h2d_size)
+        {
+            log_error(WARNING "depthai: pipelineConfig too large for config_h2d (%zu of %zu bytes)" ENDC,
+                      pipeline_config_str_packed.size(), config_h2d_size);
+            if (blobs_read.valid()) blobs_read.wait();
+            break;
+        }
+        pipeline_config_str_packed.resize(config_h2d_size, 0);
 
+        const auto config_h2d_begin = std::chrono::steady_clock::now();
         if (!g_xlink->openWriteAndCloseStream(
                 g_streams_pc_to_myriad.at("config_h2d"),
                 pipeline_config_str_packed.data())
             )
         {
-            std::cerr << WARNING "depthai: pipelineConfig write error\n" ENDC;
+            log_error(WARNING "depthai: pipelineConfig write error" ENDC);
+            if (blobs_read.valid()) blobs_read.wait();
             break;
         }
+        add_pipeline_startup_phase("config_h2d", config_h2d_begin);
 
         // host -> "host_capture" -> device
         auto stream = g_streams_pc_to_myriad.at("host_capture");
@@ -1077,27 +1189,31 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         // read & pass blob file
         if (config.ai.blob_file.empty())
         {
-            std::cout << "depthai: Blob file is not specified, will use default setting;\n";
+            log_info("depthai: Blob file is not specified, will use default setting;");
         }
         else
         {
+            std::vector<std::vector<uint8_t>> buff_blobs = blobs_read.get();
+
             for (int stage = 0; stage < num_stages; stage++)
             {
-                std::vector<uint8_t> buff_blob(size_blob[stage]);
+                notify_startup_progress(progress_cb, StartupPhase::BLOB_UPLOAD, (float) stage / num_stages);
 
-                std::cout << "Read: " << _blob_reader[stage].readData(buff_blob.data(), size_blob[stage]) << std::endl;
+                std::vector<uint8_t> &buff_blob = buff_blobs[stage];
 
                 // inBlob
                 StreamInfo blobInfo;
                 blobInfo.name = "inBlob";
                 blobInfo.size = size_blob[stage];
 
+                const auto blob_upload_begin = std::chrono::steady_clock::now();
                 if (!g_xlink->openWriteAndCloseStream(blobInfo, buff_blob.data()))
                 {
-                    std::cout << "depthai: pipelineConfig write error: Blob size too big: " << size_blob[stage] << "\n";
+                    log_error("depthai: pipelineConfig write error: Blob size too big: %d", size_blob[stage]);
                     break;
                 }
-                printf("depthai: done sending Blob file %s\n", blob_file[stage].c_str());
+                add_pipeline_startup_phase("blob_upload[" + std::to_string(stage) + "]", blob_upload_begin);
+                log_info("depthai: done sending Blob file %s", blob_file[stage].c_str());
 
                 // outBlob
                 StreamInfo outBlob("outBlob", 102400);
@@ -1105,6 +1221,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
                
                 std::string blob_info_str;
 
+                const auto out_blob_begin = std::chrono::steady_clock::now();
                 int out_blob_length = g_xlink->openReadAndCloseStream(
                     outBlob,
                     blob_info_str
@@ -1116,19 +1233,22 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
                 nlohmann::json blob_info;
                 if (!getJSONFromString(blob_info_str, blob_info))
                 {
-                    std::cout << "depthai: error parsing blob_info\n";
+                    log_error("depthai: error parsing blob_info");
                     break;
                 }
                 // std::cout << blob_info << std::endl;
 
+                add_pipeline_startup_phase("out_blob[" + std::to_string(stage) + "]", out_blob_begin);
+
                 std::vector<nlohmann::json> input_layers = blob_info["input_layers"].get<std::vector<nlohmann::json>>();
                 std::vector<nlohmann::json> output_layers = blob_info["output_layers"].get<std::vector<nlohmann::json>>();
 
                 for(auto input_json : input_layers)
                 {
                     dai::TensorInfo _tensors_info_input(input_json);
-                    std::cout << "Input layer : " << std::endl;
-                    std::cout << _tensors_info_input << std::endl;
+                    std::stringstream tensor_info_str;
+                    tensor_info_str << _tensors_info_input;
+                    log_info("Input layer : \n%s", tensor_info_str.str().c_str());
 
                     tensors_info_input.push_back(_tensors_info_input);
                 }
@@ -1136,8 +1256,9 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
                 for(auto output_json : output_layers)
                 {
                     dai::TensorInfo _tensors_info_output(output_json);
-                    std::cout << "Output layer : " << std::endl;
-                    std::cout << _tensors_info_output << std::endl;
+                    std::stringstream tensor_info_str;
+                    tensor_info_str << _tensors_info_output;
+                    log_info("Output layer : \n%s", tensor_info_str.str().c_str());
                     
                     tensors_info_output.push_back(_tensors_info_output);
 
@@ -1154,7 +1275,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
                     nn_to_depth_mapping["off_y"] = blob_info["metadata"]["nn_to_depth"]["offset_y"];
                     nn_to_depth_mapping["max_w"] = blob_info["metadata"]["nn_to_depth"]["max_width"];
                     nn_to_depth_mapping["max_h"] = blob_info["metadata"]["nn_to_depth"]["max_height"];
-                    printf("CNN to depth bounding-box mapping: start(%d, %d), max_size(%d, %d)\n",
+                    log_info("CNN to depth bounding-box mapping: start(%d, %d), max_size(%d, %d)",
                             nn_to_depth_mapping["off_x"],
                             nn_to_depth_mapping["off_y"],
                             nn_to_depth_mapping["max_w"],
@@ -1172,25 +1293,26 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
                 // check CMX slices & used shaves
                 if (number_of_cmx_slices > config.ai.cmx_slices)
                 {
-                    std::cerr << WARNING "Error: Blob is compiled for " << number_of_cmx_slices
-                              << " cmx slices but device is configured to calculate on " << config.ai.cmx_slices << "\n" ENDC;
+                    log_error(WARNING "Error: Blob is compiled for %d cmx slices but device is configured to calculate on %d" ENDC,
+                              number_of_cmx_slices, (int) config.ai.cmx_slices);
                     break;
                 }
 
                 if (number_of_shaves > config.ai.shaves)
                 {
-                    std::cerr << WARNING "Error: Blob is compiled for " << number_of_shaves
-                              << " shaves but device is configured to calculate on " << config.ai.shaves << "\n" ENDC;
+                    log_error(WARNING "Error: Blob is compiled for %d shaves but device is configured to calculate on %d" ENDC,
+                              number_of_shaves, (int) config.ai.shaves);
                     break;
                 }
 
                 if(!satisfied_resources)
                 {
-                    std::cerr << WARNING "ERROR: requested CNN resources overlaps with RGB camera \n" ENDC;
+                    log_error(WARNING "ERROR: requested CNN resources overlaps with RGB camera " ENDC);
                     return nullptr;
                 }
 
             }
+            notify_startup_progress(progress_cb, StartupPhase::BLOB_UPLOAD, 1.f);
         }
 
 
@@ -1210,7 +1332,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
             {
                 if (stream_name_to_idx.find(stream_name) == stream_name_to_idx.end())
                 {
-                    std::cout << "Error: device does not provide stream: " << stream_name << "\n";
+                    log_error("Error: device does not provide stream: %s", stream_name.c_str());
                     wrong_stream_name = true;
                 }
             }
@@ -1234,25 +1356,75 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         // pipeline
         if(gl_result == nullptr)
             gl_result = std::shared_ptr<CNNHostPipeline>(new CNNHostPipeline(tensors_info_input, tensors_info_output, NN_config));
+        if (config.app_config.realtime_packets_per_stream > 0)
+        {
+            gl_result->enableRealtime(config.app_config.realtime_packets_per_stream);
+        }
 
-        for (const std::string &stream_name : pipeline_device_streams)
+        // NAL unit parsing of the encoded video stream
+        g_video_parser = nullptr;
+        if (std::find(pipeline_device_streams.begin(), pipeline_device_streams.end(), "video") != pipeline_device_streams.end())
         {
-            std::cout << "Host stream start:" << stream_name << "\n";
+            std::string profile = "h264";
+            if (config_json.count("video_config") > 0 && config_json["video_config"].contains("profile")
+                && config_json["video_config"]["profile"].is_string())
+            {
+                profile = config_json["video_config"]["profile"].get<std::string>();
+            }
 
+            VideoCodec codec;
+            if (NalParser::getCodecFromProfile(profile, codec))
+            {
+                g_video_parser = std::make_shared<NalParser>(codec);
+                gl_result->setNalParser("video", g_video_parser);
+            }
+        }
+
+        notify_startup_progress(progress_cb, StartupPhase::STREAM_OPEN, pipeline_device_streams.empty() ? 1.f : 0.f);
+        for (size_t i = 0; i < pipeline_device_streams.size(); i++)
+        {
+            const std::string &stream_name = pipeline_device_streams[i];
+            log_info("Host stream start:%s", stream_name.c_str());
+
+            const auto stream_open_begin = std::chrono::steady_clock::now();
             if (g_xlink->openStreamInThreadAndNotifyObservers(c_streams_myriad_to_pc.at(stream_name)))
             {
+                add_pipeline_startup_phase("stream_open:" + stream_name, stream_open_begin);
                 gl_result->makeStreamPublic(stream_name);
                 gl_result->observe(*g_xlink.get(), c_streams_myriad_to_pc.at(stream_name));
+                notify_startup_progress(progress_cb, StartupPhase::STREAM_OPEN, (float) (i + 1) / pipeline_device_streams.size());
             }
             else
             {
-                std::cout << "depthai: " << stream_name << " error;\n";
+                log_error("depthai: %s error;", stream_name.c_str());
                 // TODO: rollback correctly!
                 break;
             }
         }
 
 
+        // host post processors run on the reader threads, or each on its own executor
+        g_async_dispatcher = nullptr;
+        if (config.app_config.async_post_processing)
+        {
+            g_async_dispatcher = std::unique_ptr<AsyncStreamDispatcher>(new AsyncStreamDispatcher());
+        }
+        const auto observe_device_streams = [this, &config](
+            DataObserver<StreamInfo, StreamData> &observer,
+            const std::string &name,
+            const std::vector<StreamInfo> &streams)
+        {
+            if (g_async_dispatcher)
+            {
+                g_async_dispatcher->addObserver(*g_xlink.get(), name, observer, streams, config.app_config.async_inbox_size);
+                return;
+            }
+            for (const auto &info : streams)
+            {
+                observer.observe(*g_xlink.get(), info);
+            }
+        };
+
         // disparity post processor
         if (add_disparity_post_processing_color)
         {
@@ -1263,9 +1435,11 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
             const std::string stream_in_name = "disparity";
             const std::string stream_out_color_name = "disparity_color";
 
+            const auto stream_open_begin = std::chrono::steady_clock::now();
             if (g_xlink->openStreamInThreadAndNotifyObservers(c_streams_myriad_to_pc.at(stream_in_name)))
             {
-                g_disparity_post_proc->observe(*g_xlink.get(), c_streams_myriad_to_pc.at(stream_in_name));
+                add_pipeline_startup_phase("stream_open:" + stream_in_name, stream_open_begin);
+                observe_device_streams(*g_disparity_post_proc, "disparity_post_proc", {c_streams_myriad_to_pc.at(stream_in_name)});
 
                 if (add_disparity_post_processing_color)
                 {
@@ -1275,16 +1449,104 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
             }
             else
             {
-                std::cout << "depthai: stream open error " << stream_in_name << " (2)\n";
+                log_error("depthai: stream open error %s (2)", stream_in_name.c_str());
                 // TODO: rollback correctly!
                 break;
             }
         }
 
+        // device streams consumed only by the host post processors
+        bool host_input_error = false;
+        for (const auto &input : host_input_streams)
+        {
+            const std::string &input_name = input.first;
+            if (std::find(pipeline_device_streams.begin(), pipeline_device_streams.end(), input_name) != pipeline_device_streams.end())
+            {
+                continue; // already open
+            }
+
+            const auto stream_open_begin = std::chrono::steady_clock::now();
+            if (!g_xlink->openStreamInThreadAndNotifyObservers(c_streams_myriad_to_pc.at(input_name)))
+            {
+                log_error("depthai: stream open error %s (3)", input_name.c_str());
+                host_input_error = true;
+                break;
+            }
+            add_pipeline_startup_phase("stream_open:" + input_name, stream_open_begin);
+        }
+
+        if (host_input_error)
+        {
+            // the reader threads of the streams opened so far, host inputs and
+            // pipeline streams, would keep feeding the observers of a failed pipeline
+            g_xlink->closeAllObservedStreams();
+            break;
+        }
+
+        // host rectification of the mono streams
+        if (!rectified_streams.empty())
+        {
+            if (version <= 4 || !intrinsics_loaded)
+            {
+                log_warn("depthai: " WARNING "left_rect/right_rect require calibration with intrinsics, streams disabled" ENDC);
+            }
+            else
+            {
+                g_rectified_post_proc = std::unique_ptr<RectifiedStreamPostProcessor>(
+                    new RectifiedStreamPostProcessor(
+                        RectificationModel(M1_l, R1_l, M2_r, d1_l),
+                        RectificationModel(M2_r, R2_r, M2_r, d2_r)));
+
+                std::vector<StreamInfo> raw_infos;
+                for (const auto &raw_name : rectified_streams)
+                {
+                    raw_infos.push_back(c_streams_myriad_to_pc.at(raw_name));
+                }
+                observe_device_streams(*g_rectified_post_proc, "rectified_post_proc", raw_infos);
+
+                for (const auto &raw_name : rectified_streams)
+                {
+                    const StreamInfo &raw_info = c_streams_myriad_to_pc.at(raw_name);
+                    gl_result->makeStreamPublic(RectifiedStreamPostProcessor::getOutputStreamName(raw_name));
+                    gl_result->observe(*g_rectified_post_proc.get(), RectifiedStreamPostProcessor::getOutputStreamInfo(raw_info));
+                }
+            }
+        }
+
+        // host color conversion of the YUV streams
+        if (!color_conversion_streams.empty())
+        {
+            g_color_conversion_post_proc = std::unique_ptr<ColorConversionPostProcessor>(
+                new ColorConversionPostProcessor());
+
+            std::set<std::string> conversion_inputs;
+            for (const auto &stream : color_conversion_streams)
+            {
+                std::string input_name;
+                PixelFormat format;
+                ColorConversionPostProcessor::parseStreamName(stream.name, input_name, format);
+                g_color_conversion_post_proc->addOutput(input_name, stream.name, format, stream.downscale);
+                conversion_inputs.insert(input_name);
+            }
+
+            std::vector<StreamInfo> input_infos;
+            for (const auto &input_name : conversion_inputs)
+            {
+                input_infos.push_back(c_streams_myriad_to_pc.at(input_name));
+            }
+            observe_device_streams(*g_color_conversion_post_proc, "color_conversion_post_proc", input_infos);
+
+            for (const auto &stream : color_conversion_streams)
+            {
+                gl_result->makeStreamPublic(stream.name);
+                gl_result->observe(*g_color_conversion_post_proc.get(), StreamInfo(stream.name.c_str(), 0));
+            }
+        }
+
         if(temp_measurement)
         {
             // device support listener
-            g_device_support_listener = std::unique_ptr<DeviceSupportListener>(new DeviceSupportListener);
+            g_device_support_listener = std::unique_ptr<DeviceSupportListener>(new DeviceSupportListener(telemetry_monitor));
 
             g_device_support_listener->observe(
                 *g_xlink.get(),
@@ -1294,7 +1556,7 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
 
         // if (config.app_config.enable_reconfig) {
         //     // Read again the device config, after an eventual EEPROM write
-        //     printf("Reading again device config\n");
+        //     log_info("Reading again device config");
         //     if (read_and_parse_config_d2h() != 0)
         //         break;
 
@@ -1306,14 +1568,14 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         //             pipeline_config_str_packed.data())
         //         )
         //     {
-        //         std::cerr << WARNING "depthai: pipelineConfig write error\n" ENDC;
+        //         log_error(WARNING "depthai: pipelineConfig write error" ENDC);
         //         break;
         //     }
 
         // }
 
         init_ok = true;
-        std::cout << "depthai: INIT OK!\n";
+        log_info("depthai: INIT OK!");
     }
     while (false);
 
@@ -1322,14 +1584,26 @@ std::shared_ptr<CNNHostPipeline> Device::create_pipeline(
         gl_result = nullptr;
     }
 
+    add_pipeline_startup_phase("create_pipeline", create_pipeline_begin);
     return gl_result;
 }
 
+std::future<std::shared_ptr<CNNHostPipeline>> Device::create_pipeline_async(
+    const std::string &config_json_str,
+    StartupProgressCallback progress_cb
+)
+{
+    return std::async(std::launch::async, [this, config_json_str, progress_cb]()
+    {
+        return create_pipeline(config_json_str, progress_cb);
+    });
+}
+
 void Device::write_eeprom_data(const std::string &board_config){
     std::string board_config_str_packed;
 
     board_config_str_packed = board_config;
-    std::cout << board_config_str_packed <<std::endl;
+    log_info("%s", board_config_str_packed.c_str());
     board_config_str_packed.resize(g_streams_pc_to_myriad.at("config_h2d").size, 0);
 
     if (read_and_parse_config_d2h() != 0)
@@ -1346,50 +1620,76 @@ void Device::write_eeprom_data(const std::string &board_config){
 
 }
 
-// create_mesh(std::vector<std::vector<float>>& M, std::vector<std::vector<float>>& R, std::vector<float>d, int bin_size){
-//     float fx = M[0][0], fy = M[1][1], u0 = M[0][2], v0 = M[1][2];
-//     float k1 = d[0], k2 = d[1] , p1 = d[2] , p2 = d[3] , k3 = d[4];
-//     float s4 = d[11], k4 = d[5], k5 = d[6], k6 = d[7], s1 = d[8];
-//     float s2 = d[9] , s3 = d[10], tauX = d[12] , tauY = d[13];
-
-//     std::vector<std::vector<float>> matTilt{{1,0,0},
-//                                             {0,1,0},
-//                                             {0,0,1}};
-
-//     std::vector<std::vector<float>> _x = 0, _y = 0, _w = 0, ir; // _x, _y, _w are 2D coordinates in homogeneous coordinates
-//     mat_inv(mat_mul(self.M2, R), ir); // TODO: Change it to using LU later to reduce the computation load if necessary
-//     std::cout << "Printing Res for creating mesh " << width << " Height: " << height << "  " << std::endl;
-
-//     for(int i = 0; i < height; ++i){
-
-
-//         for(int j = 0; j < width; ++j){
+void Device::request_jpeg(){
+if(g_host_capture_command != nullptr){
+        g_host_capture_command->capture();
+    }
+}
 
-//         }
+std::vector<AsyncObserverStats> Device::get_async_observer_stats()
+{
+    if (g_async_dispatcher == nullptr)
+    {
+        return {};
+    }
+    return g_async_dispatcher->getStats();
+}
 
-//     }
+std::vector<ThreadStats> Device::get_thread_stats()
+{
+    return ::get_thread_stats();
+}
 
+DeviceTelemetry Device::get_telemetry()
+{
+    DeviceTelemetry telemetry;
+    telemetry_monitor.getLatest(telemetry);
+    return telemetry;
+}
 
-// }
+std::vector<DeviceTelemetry> Device::get_telemetry_history()
+{
+    return telemetry_monitor.getHistory();
+}
 
+int Device::add_telemetry_threshold(
+    TelemetryMetric metric,
+    float threshold,
+    float hysteresis,
+    TelemetryThresholdCallback callback
+)
+{
+    return telemetry_monitor.addThreshold(metric, threshold, hysteresis, callback);
+}
 
+void Device::remove_telemetry_threshold(int id)
+{
+    telemetry_monitor.removeThreshold(id);
+}
 
-// -40 for 
-// create_mesh(std::vector<float>& x_map_buff, std::vector<float>& y_map_buff, std::vector<float>& mesh, int32_t res){
-// 
-// }
+std::vector<KeyframeIndexEntry> Device::get_video_keyframe_index()
+{
+    if (g_video_parser == nullptr)
+    {
+        return {};
+    }
+    return g_video_parser->getKeyframeIndex();
+}
 
-void Device::request_jpeg(){
-if(g_host_capture_command != nullptr){
-        g_host_capture_command->capture();
+std::shared_ptr<const VideoParameterSets> Device::get_video_parameter_sets()
+{
+    if (g_video_parser == nullptr)
+    {
+        return nullptr;
     }
+    return g_video_parser->getParameterSets();
 }
 
 std::string Device::get_mx_id(){
     // if(mx_serial.empty()){
     std::string val =  g_xlink->getMxSerial();
     if(val.empty()){
-        std::cerr << "Serial id Not found!" << std::endl;
+        log_error("Serial id Not found!");
         return "";
     }
     return val;
@@ -1,9 +1,19 @@
-#include <iostream>
+#include <chrono>
 
 #include "device_support_listener.hpp"
-#include "depthai-shared/json_helper.hpp"
+#include "logger.hpp"
 
 
+DeviceSupportListener::DeviceSupportListener(DeviceTelemetryMonitor &telemetry_monitor)
+    : _telemetry_monitor(telemetry_monitor)
+    , _on_device_log([](const char *log, size_t length)
+        {
+            log_info("DEVICE LOG: %.*s", (int) length, log);
+        })
+{
+
+}
+
 void DeviceSupportListener::onNewData(
     const StreamInfo &data_info,
     const StreamData &data
@@ -11,26 +21,17 @@ void DeviceSupportListener::onNewData(
 {
     do
     {
-        const char* str = (const char *) data.data;
+        DeviceTelemetry telemetry;
+        telemetry.host_timestamp = std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
 
-        nlohmann::json meta_json;
-        if (!getJSONFromString(str, meta_json))
+        if (!parse_device_telemetry((const char *) data.data, data.size, telemetry, _on_device_log))
         {
-            std::cout << "DeviceSupportListener: json parsing error;\n";
+            Logger::instance().count(LogLevel::error, "DeviceSupportListener: %u %s json parsing errors", data_info.name.c_str());
             break;
         }
 
-        // print logs
-        if (meta_json.contains("logs"))
-        {
-            assert(meta_json.at("logs").is_array());
-
-            for (const auto &it : meta_json.at("logs"))
-            {
-                assert(it.is_string());
-                std::cout << "DEVICE LOG: " << it.get<std::string>() << "\n";
-            }
-        }
+        _telemetry_monitor.add(telemetry);
     }
     while (false);    
 }
@@ -0,0 +1,498 @@
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "device_telemetry.hpp"
+
+
+constexpr int DeviceTelemetryMonitor::c_history_size;
+
+
+DeviceTelemetry::DeviceTelemetry()
+    : temperature_css(NAN)
+    , temperature_mss(NAN)
+    , temperature_upa0(NAN)
+    , temperature_upa1(NAN)
+    , cpu_usage_leon_os(NAN)
+    , cpu_usage_leon_rt(NAN)
+    , ddr_used(NAN)
+    , ddr_total(NAN)
+    , cmx_used(NAN)
+    , cmx_total(NAN)
+{
+
+}
+
+float DeviceTelemetry::maxTemperature() const
+{
+    float result = NAN;
+    for (float t : {temperature_css, temperature_mss, temperature_upa0, temperature_upa1})
+    {
+        if (!std::isnan(t) && (std::isnan(result) || t > result))
+        {
+            result = t;
+        }
+    }
+    return result;
+}
+
+float get_telemetry_metric(const DeviceTelemetry &telemetry, TelemetryMetric metric)
+{
+    switch (metric)
+    {
+        case TelemetryMetric::TEMPERATURE_MAX:   return telemetry.maxTemperature();
+        case TelemetryMetric::TEMPERATURE_CSS:   return telemetry.temperature_css;
+        case TelemetryMetric::TEMPERATURE_MSS:   return telemetry.temperature_mss;
+        case TelemetryMetric::TEMPERATURE_UPA0:  return telemetry.temperature_upa0;
+        case TelemetryMetric::TEMPERATURE_UPA1:  return telemetry.temperature_upa1;
+        case TelemetryMetric::CPU_USAGE_LEON_OS: return telemetry.cpu_usage_leon_os;
+        case TelemetryMetric::CPU_USAGE_LEON_RT: return telemetry.cpu_usage_leon_rt;
+        case TelemetryMetric::DDR_USAGE:         return telemetry.ddr_used / telemetry.ddr_total;
+        case TelemetryMetric::CMX_USAGE:         return telemetry.cmx_used / telemetry.cmx_total;
+    }
+    return NAN;
+}
+
+
+namespace
+{
+
+// json path -> field, paths are matched segment by segment
+struct TelemetryField
+{
+    const char *path[3];
+    float DeviceTelemetry::*field;
+};
+
+const TelemetryField c_telemetry_fields[] =
+{
+    { {"sensors", "temperature", "css"},     &DeviceTelemetry::temperature_css   },
+    { {"sensors", "temperature", "mss"},     &DeviceTelemetry::temperature_mss   },
+    { {"sensors", "temperature", "upa0"},    &DeviceTelemetry::temperature_upa0  },
+    { {"sensors", "temperature", "upa1"},    &DeviceTelemetry::temperature_upa1  },
+    { {"sensors", "cpu_usage",   "leon_os"}, &DeviceTelemetry::cpu_usage_leon_os },
+    { {"sensors", "cpu_usage",   "leon_rt"}, &DeviceTelemetry::cpu_usage_leon_rt },
+    { {"sensors", "memory",      "ddr_used"},  &DeviceTelemetry::ddr_used  },
+    { {"sensors", "memory",      "ddr_total"}, &DeviceTelemetry::ddr_total },
+    { {"sensors", "memory",      "cmx_used"},  &DeviceTelemetry::cmx_used  },
+    { {"sensors", "memory",      "cmx_total"}, &DeviceTelemetry::cmx_total },
+};
+
+constexpr int c_max_json_depth = 16;
+constexpr int c_max_path_depth = 3;
+
+// Single pass recursive descent scanner. Keys are kept as slices of the input,
+// only the path of the current value is tracked.
+class TelemetryScanner
+{
+public:
+    TelemetryScanner(
+        const char *json, size_t size,
+        DeviceTelemetry &telemetry,
+        const std::function<void(const char*, size_t)> &on_log
+    )
+        : _p(json)
+        , _end(json + size)
+        , _telemetry(telemetry)
+        , _on_log(on_log)
+    {
+        // packets are zero padded
+        const char *terminator = static_cast<const char*>(memchr(json, '\0', size));
+        if (terminator != nullptr)
+        {
+            _end = terminator;
+        }
+    }
+
+    bool scan()
+    {
+        skipSpace();
+        if (!parseValue(0))
+        {
+            return false;
+        }
+        skipSpace();
+        return _p == _end;
+    }
+
+private:
+    const char *_p;
+    const char *_end;
+    DeviceTelemetry &_telemetry;
+    const std::function<void(const char*, size_t)> &_on_log;
+
+    const char *_key[c_max_path_depth];
+    size_t      _key_len[c_max_path_depth];
+    int         _nesting = 0;
+
+    void skipSpace()
+    {
+        while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r'))
+        {
+            _p++;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (_p < _end && *_p == c)
+        {
+            _p++;
+            return true;
+        }
+        return false;
+    }
+
+    bool keyIs(int depth, const char *name) const
+    {
+        return _key_len[depth] == strlen(name) && memcmp(_key[depth], name, _key_len[depth]) == 0;
+    }
+
+    // raw string slice, escapes are skipped but not decoded
+    bool parseRawString(const char *&begin, size_t &length)
+    {
+        if (!consume('"'))
+        {
+            return false;
+        }
+        begin = _p;
+        while (_p < _end && *_p != '"')
+        {
+            if (*_p == '\\')
+            {
+                _p++;
+            }
+            _p++;
+        }
+        if (_p >= _end)
+        {
+            return false;
+        }
+        length = _p - begin;
+        _p++;
+        return true;
+    }
+
+    // locale independent, no allocation
+    bool parseNumber(float &value)
+    {
+        const char *start = _p;
+        double sign = 1.0;
+        if (_p < _end && *_p == '-')
+        {
+            sign = -1.0;
+            _p++;
+        }
+
+        double result = 0.0;
+        while (_p < _end && *_p >= '0' && *_p <= '9')
+        {
+            result = result * 10.0 + (*_p++ - '0');
+        }
+        if (_p < _end && *_p == '.')
+        {
+            _p++;
+            double scale = 0.1;
+            while (_p < _end && *_p >= '0' && *_p <= '9')
+            {
+                result += (*_p++ - '0') * scale;
+                scale *= 0.1;
+            }
+        }
+        if (_p < _end && (*_p == 'e' || *_p == 'E'))
+        {
+            _p++;
+            int exp_sign = 1;
+            if (_p < _end && (*_p == '+' || *_p == '-'))
+            {
+                exp_sign = (*_p++ == '-') ? -1 : 1;
+            }
+            int exponent = 0;
+            while (_p < _end && *_p >= '0' && *_p <= '9')
+            {
+                exponent = std::min(exponent * 10 + (*_p++ - '0'), 400);
+            }
+            result *= std::pow(10.0, exp_sign * exponent);
+        }
+
+        value = (float) (sign * result);
+        return _p > start + (sign < 0.0 ? 1 : 0);
+    }
+
+    bool parseLiteral(const char *literal)
+    {
+        const size_t length = strlen(literal);
+        if ((size_t) (_end - _p) < length || memcmp(_p, literal, length) != 0)
+        {
+            return false;
+        }
+        _p += length;
+        return true;
+    }
+
+    void onNumber(int depth, float value)
+    {
+        if (depth != c_max_path_depth)
+        {
+            return;
+        }
+        for (const auto &field : c_telemetry_fields)
+        {
+            if (keyIs(0, field.path[0]) && keyIs(1, field.path[1]) && keyIs(2, field.path[2]))
+            {
+                _telemetry.*field.field = value;
+                return;
+            }
+        }
+    }
+
+    void onLog(const char *raw, size_t raw_length)
+    {
+        char text[c_max_device_log_length + 1];
+        size_t length = 0;
+
+        for (size_t i = 0; i < raw_length && length < c_max_device_log_length; i++)
+        {
+            char c = raw[i];
+            if (c == '\\' && i + 1 < raw_length)
+            {
+                c = raw[++i];
+                switch (c)
+                {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'u': c = '?'; i = std::min(i + 4, raw_length - 1); break;
+                    default: break; // '"', '\\', '/'
+                }
+            }
+            text[length++] = c;
+        }
+        text[length] = '\0';
+
+        if (_on_log)
+        {
+            _on_log(text, length);
+        }
+    }
+
+    // depth: number of object keys on the current path
+    bool parseValue(int depth)
+    {
+        skipSpace();
+        if (_p >= _end)
+        {
+            return false;
+        }
+
+        switch (*_p)
+        {
+            case '{':
+            case '[':
+            {
+                if (_nesting >= c_max_json_depth)
+                {
+                    return false;
+                }
+                _nesting++;
+                const bool ok = (*_p == '{') ? parseObject(depth) : parseArray(depth);
+                _nesting--;
+                return ok;
+            }
+
+            case '"':
+            {
+                const char *text;
+                size_t text_len;
+                return parseRawString(text, text_len);
+            }
+
+            case 't': return parseLiteral("true");
+            case 'f': return parseLiteral("false");
+            case 'n': return parseLiteral("null");
+
+            default:
+            {
+                float value;
+                if (!parseNumber(value))
+                {
+                    return false;
+                }
+                onNumber(depth, value);
+                return true;
+            }
+        }
+    }
+
+    bool parseObject(int depth)
+    {
+        _p++;
+        if (consume('}'))
+        {
+            return true;
+        }
+        do
+        {
+            const char *key;
+            size_t key_len;
+            if (!parseRawString(key, key_len) || !consume(':'))
+            {
+                return false;
+            }
+            if (depth < c_max_path_depth)
+            {
+                _key[depth] = key;
+                _key_len[depth] = key_len;
+            }
+            if (!parseValue(depth + 1))
+            {
+                return false;
+            }
+        }
+        while (consume(','));
+        return consume('}');
+    }
+
+    bool parseArray(int depth)
+    {
+        _p++;
+        if (consume(']'))
+        {
+            return true;
+        }
+        const bool logs = (depth == 1 && keyIs(0, "logs"));
+        do
+        {
+            skipSpace();
+            if (logs && _p < _end && *_p == '"')
+            {
+                const char *text;
+                size_t text_len;
+                if (!parseRawString(text, text_len))
+                {
+                    return false;
+                }
+                onLog(text, text_len);
+            }
+            else if (!parseValue(c_max_path_depth + 1)) // array elements are not on a field path
+            {
+                return false;
+            }
+        }
+        while (consume(','));
+        return consume(']');
+    }
+};
+
+} // namespace
+
+
+bool parse_device_telemetry(
+    const char *json, size_t size,
+    DeviceTelemetry &telemetry,
+    const std::function<void(const char *log, size_t length)> &on_log
+)
+{
+    TelemetryScanner scanner(json, size, telemetry, on_log);
+    return scanner.scan();
+}
+
+
+DeviceTelemetryMonitor::DeviceTelemetryMonitor()
+    : _history(c_history_size)
+{
+
+}
+
+void DeviceTelemetryMonitor::add(const DeviceTelemetry &telemetry)
+{
+    {
+        std::lock_guard<std::mutex> lock(_history_mutex);
+        _history[_history_next] = telemetry;
+        _history_next = (_history_next + 1) % c_history_size;
+        _history_count = std::min<size_t>(_history_count + 1, c_history_size);
+    }
+
+    std::lock_guard<std::mutex> lock(_thresholds_mutex);
+    for (auto &threshold : _thresholds)
+    {
+        const float value = get_telemetry_metric(telemetry, threshold.metric);
+        if (std::isnan(value))
+        {
+            continue;
+        }
+
+        if (!threshold.above && value >= threshold.threshold)
+        {
+            threshold.above = true;
+            threshold.callback(threshold.metric, value, true);
+        }
+        else if (threshold.above && value < threshold.threshold - threshold.hysteresis)
+        {
+            threshold.above = false;
+            threshold.callback(threshold.metric, value, false);
+        }
+    }
+}
+
+bool DeviceTelemetryMonitor::getLatest(DeviceTelemetry &telemetry)
+{
+    std::lock_guard<std::mutex> lock(_history_mutex);
+    if (_history_count == 0)
+    {
+        return false;
+    }
+    telemetry = _history[(_history_next + c_history_size - 1) % c_history_size];
+    return true;
+}
+
+std::vector<DeviceTelemetry> DeviceTelemetryMonitor::getHistory()
+{
+    std::lock_guard<std::mutex> lock(_history_mutex);
+    std::vector<DeviceTelemetry> result;
+    result.reserve(_history_count);
+    for (size_t i = 0; i < _history_count; i++)
+    {
+        result.push_back(_history[(_history_next + c_history_size - _history_count + i) % c_history_size]);
+    }
+    return result;
+}
+
+void DeviceTelemetryMonitor::clear()
+{
+    std::lock_guard<std::mutex> lock(_history_mutex);
+    _history_next = 0;
+    _history_count = 0;
+}
+
+int DeviceTelemetryMonitor::addThreshold(
+    TelemetryMetric metric,
+    float threshold,
+    float hysteresis,
+    TelemetryThresholdCallback callback
+)
+{
+    std::lock_guard<std::mutex> lock(_thresholds_mutex);
+    Threshold t;
+    t.id = _next_threshold_id++;
+    t.metric = metric;
+    t.threshold = threshold;
+    t.hysteresis = std::max(0.f, hysteresis);
+    t.above = false;
+    t.callback = callback;
+    _thresholds.push_back(t);
+    return t.id;
+}
+
+void DeviceTelemetryMonitor::removeThreshold(int id)
+{
+    std::lock_guard<std::mutex> lock(_thresholds_mutex);
+    _thresholds.erase(
+        std::remove_if(_thresholds.begin(), _thresholds.end(),
+            [id](const Threshold &t) { return t.id == id; }),
+        _thresholds.end());
+}
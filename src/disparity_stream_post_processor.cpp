@@ -3,6 +3,8 @@
 #include <iostream>
 
 #include "disparity_stream_post_processor.hpp"
+#include "parallel_for.hpp"
+#include "thread_settings.hpp"
 #include "depthai-shared/disparity_luts.hpp"
 #include "depthai-shared/metadata/frame_metadata.hpp"
 
@@ -22,6 +24,7 @@ void  DisparityStreamPostProcessor::onNewData(
 )
 {
     assert(data_info.name == c_stream_in);
+    apply_thread_settings(ThreadClass::POST_PROCESSING, data_info.name);
 
     if (_produce_depth_color)
     {
@@ -41,13 +44,17 @@ void DisparityStreamPostProcessor::prepareDepthColorAndNotifyObservers(
     std::vector<unsigned char> depth(depth_si.size);
     const unsigned char* disp_uc = (const unsigned char*) data.data;
 
-    for (int i = 0, j = 0; i < data.size - sizeof(FrameMetadata); ++i, j+=3)
+    const int pixels = (int) (data.size - sizeof(FrameMetadata));
+    parallel_for(0, pixels, [&](int pixel_begin, int pixel_end)
     {
-        const unsigned char &disp = *(disp_uc + i);
-        depth[j  ] = c_disp_to_color[disp][0];
-        depth[j+1] = c_disp_to_color[disp][1];
-        depth[j+2] = c_disp_to_color[disp][2];
-    }
+        for (int i = pixel_begin, j = 3 * pixel_begin; i < pixel_end; ++i, j+=3)
+        {
+            const unsigned char &disp = *(disp_uc + i);
+            depth[j  ] = c_disp_to_color[disp][0];
+            depth[j+1] = c_disp_to_color[disp][1];
+            depth[j+2] = c_disp_to_color[disp][2];
+        }
+    }, 64 * 1024);
     FrameMetadata *m = (FrameMetadata *)(depth.data() + depth.size() - sizeof(FrameMetadata));
     memcpy(m, disp_uc + data.size - sizeof(FrameMetadata), sizeof(FrameMetadata));
     m->frameSize = 3 * (data.size - sizeof(FrameMetadata));
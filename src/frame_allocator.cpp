@@ -0,0 +1,346 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "frame_allocator.hpp"
+#include "allocation_hook.hpp"
+#include "logger.hpp"
+
+
+static constexpr size_t c_huge_page_size = 2 * 1024 * 1024;
+static constexpr size_t c_node_size_class = 16;         // recycled node sizes are rounded up to this
+static constexpr size_t c_small_size_class = 64;        // above 256 bytes
+static constexpr size_t c_large_size_class = 4096;      // above c_large_size_class
+static constexpr size_t c_frame_block_size = 4096;      // smaller blocks are container nodes, aligned like malloc
+static constexpr int    c_free_list_count = 64;         // size classes kept by the pool
+
+// Every block stores its capacity (size class) in the size_t before the data
+static constexpr size_t c_node_header_size = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+
+namespace
+{
+
+enum class Backing : uint32_t
+{
+    HEAP,
+    MMAP,
+};
+
+// Precedes the data of frame blocks, padded to c_frame_alignment
+struct BlockHeader
+{
+    void    *base;          // allocation to free
+    size_t   mapped_size;   // MMAP
+    Backing  backing;
+};
+static_assert(sizeof(BlockHeader) + sizeof(size_t) <= c_frame_alignment, "header must fit the alignment padding");
+
+// Free blocks are linked through their first bytes
+struct FreeList
+{
+    size_t  capacity;
+    void   *head;
+    size_t  count;
+};
+
+std::atomic<int>    g_huge_pages{(int) FrameHugePages::OFF};
+std::atomic<size_t> g_huge_page_min_size{2 * 1024 * 1024};
+std::atomic<bool>   g_recycle{false};
+std::atomic<size_t> g_recycle_max_bytes{256 * 1024 * 1024};
+
+// intrusive lists, the pool itself never allocates
+std::mutex g_pool_mutex;
+FreeList   g_free_lists[c_free_list_count];
+int        g_free_list_count = 0;
+FramePoolStats g_pool_stats;
+
+size_t size_class(size_t size)
+{
+    const size_t granularity = size > c_large_size_class ? c_large_size_class
+                             : size > 256 ? c_small_size_class
+                             : c_node_size_class;
+    return (std::max<size_t>(size, 1) + granularity - 1) / granularity * granularity;
+}
+
+size_t& capacity_of(void *data)
+{
+    return *reinterpret_cast<size_t*>(static_cast<uint8_t*>(data) - sizeof(size_t));
+}
+
+void*& next_of(void *data)
+{
+    return *static_cast<void**>(data);
+}
+
+// g_pool_mutex locked, nullptr if all lists are used by other classes
+FreeList* find_free_list(size_t capacity, bool create)
+{
+    for (int i = 0; i < g_free_list_count; i++)
+    {
+        if (g_free_lists[i].capacity == capacity)
+        {
+            return &g_free_lists[i];
+        }
+    }
+    if (!create || g_free_list_count == c_free_list_count)
+    {
+        return nullptr;
+    }
+    FreeList &list = g_free_lists[g_free_list_count++];
+    list.capacity = capacity;
+    list.head = nullptr;
+    list.count = 0;
+    return &list;
+}
+
+// g_pool_mutex locked
+void push_free(FreeList &list, void *data)
+{
+    next_of(data) = list.head;
+    list.head = data;
+    list.count++;
+    g_pool_stats.cached_bytes += list.capacity;
+}
+
+void* aligned_heap_alloc(size_t alignment, size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void *base = nullptr;
+    return posix_memalign(&base, alignment, size) == 0 ? base : nullptr;
+#endif
+}
+
+void aligned_heap_free(void *base)
+{
+#ifdef _WIN32
+    _aligned_free(base);
+#else
+    free(base);
+#endif
+}
+
+BlockHeader* header_of(void *data)
+{
+    return reinterpret_cast<BlockHeader*>(static_cast<uint8_t*>(data) - c_frame_alignment);
+}
+
+void* finish_block(void *base, size_t mapped_size, size_t capacity, Backing backing)
+{
+    BlockHeader *header = static_cast<BlockHeader*>(base);
+    header->base = base;
+    header->mapped_size = mapped_size;
+    header->backing = backing;
+    void *data = static_cast<uint8_t*>(base) + c_frame_alignment;
+    capacity_of(data) = capacity;
+    return data;
+}
+
+void* allocate_block(size_t capacity)
+{
+    if (capacity < c_frame_block_size)
+    {
+        void *base = malloc(c_node_header_size + capacity);
+        if (base == nullptr)
+        {
+            return nullptr;
+        }
+        void *data = static_cast<uint8_t*>(base) + c_node_header_size;
+        capacity_of(data) = capacity;
+        return data;
+    }
+
+    const size_t total = capacity + c_frame_alignment;
+    const FrameHugePages huge_pages = (FrameHugePages) g_huge_pages.load(std::memory_order_relaxed);
+
+#ifdef __linux__
+    if (huge_pages != FrameHugePages::OFF && capacity >= g_huge_page_min_size.load(std::memory_order_relaxed))
+    {
+        const size_t mapped_size = (total + c_huge_page_size - 1) & ~(c_huge_page_size - 1);
+        if (huge_pages == FrameHugePages::EXPLICIT)
+        {
+            void *base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base != MAP_FAILED)
+            {
+                return finish_block(base, mapped_size, capacity, Backing::MMAP);
+            }
+            Logger::instance().count(LogLevel::warn, "%u frame buffers not in explicit huge pages: %s", strerror(errno));
+        }
+
+        void *base = aligned_heap_alloc(c_huge_page_size, mapped_size);
+        if (base != nullptr)
+        {
+            madvise(base, mapped_size, MADV_HUGEPAGE);
+            return finish_block(base, 0, capacity, Backing::HEAP);
+        }
+    }
+#else
+    (void) huge_pages;
+#endif
+
+    void *base = aligned_heap_alloc(c_frame_alignment, total);
+    return base != nullptr ? finish_block(base, 0, capacity, Backing::HEAP) : nullptr;
+}
+
+void free_block(void *data)
+{
+    if (capacity_of(data) < c_frame_block_size)
+    {
+        free(static_cast<uint8_t*>(data) - c_node_header_size);
+        return;
+    }
+
+    BlockHeader *header = header_of(data);
+#ifdef __linux__
+    if (header->backing == Backing::MMAP)
+    {
+        munmap(header->base, header->mapped_size);
+        return;
+    }
+#endif
+    aligned_heap_free(header->base);
+}
+
+} // namespace
+
+
+void set_frame_alloc_config(const FrameAllocConfig &config)
+{
+    g_huge_page_min_size = config.huge_page_min_size;
+    g_huge_pages = (int) config.huge_pages;
+    g_recycle = config.recycle;
+    g_recycle_max_bytes = config.recycle_max_bytes;
+
+    if (!config.recycle)
+    {
+        frame_pool_trim();
+    }
+}
+
+FrameAllocConfig get_frame_alloc_config()
+{
+    FrameAllocConfig config;
+    config.huge_pages = (FrameHugePages) g_huge_pages.load();
+    config.huge_page_min_size = g_huge_page_min_size.load();
+    config.recycle = g_recycle.load();
+    config.recycle_max_bytes = g_recycle_max_bytes.load();
+    return config;
+}
+
+void* frame_alloc(size_t size)
+{
+    const size_t capacity = size_class(size);
+    if (g_recycle.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        FreeList *list = find_free_list(capacity, false);
+        if (list != nullptr && list->head != nullptr)
+        {
+            void *data = list->head;
+            list->head = next_of(data);
+            list->count--;
+            g_pool_stats.cached_bytes -= capacity;
+            g_pool_stats.hits++;
+            return data;
+        }
+        g_pool_stats.misses++;
+    }
+
+    check_frame_path_allocation(size);
+    return allocate_block(capacity);
+}
+
+void frame_free(void *data)
+{
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    const size_t capacity = capacity_of(data);
+    if (g_recycle.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        if (g_pool_stats.cached_bytes + capacity <= g_recycle_max_bytes.load(std::memory_order_relaxed))
+        {
+            FreeList *list = find_free_list(capacity, true);
+            if (list != nullptr)
+            {
+                push_free(*list, data);
+                return;
+            }
+        }
+        g_pool_stats.released++;
+    }
+    free_block(data);
+}
+
+void frame_pool_reserve(size_t size, size_t count)
+{
+    const size_t capacity = size_class(size);
+    for (size_t i = 0; i < count; i++)
+    {
+        void *data = allocate_block(capacity);
+        if (data == nullptr)
+        {
+            log_error("frame pool: can't reserve %zu blocks of %zu bytes", count, capacity);
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        FreeList *list = find_free_list(capacity, true);
+        if (list == nullptr)
+        {
+            free_block(data);
+            log_error("frame pool: more than %d size classes", c_free_list_count);
+            break;
+        }
+        push_free(*list, data);
+    }
+}
+
+void frame_pool_trim()
+{
+    void *blocks = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        for (int i = 0; i < g_free_list_count; i++)
+        {
+            while (g_free_lists[i].head != nullptr)
+            {
+                void *data = g_free_lists[i].head;
+                g_free_lists[i].head = next_of(data);
+                next_of(data) = blocks;
+                blocks = data;
+            }
+            g_free_lists[i].count = 0;
+        }
+        g_pool_stats.cached_bytes = 0;
+    }
+
+    while (blocks != nullptr)
+    {
+        void *next = next_of(blocks);
+        free_block(blocks);
+        blocks = next;
+    }
+}
+
+FramePoolStats get_frame_pool_stats()
+{
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    return g_pool_stats;
+}
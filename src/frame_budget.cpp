@@ -0,0 +1,163 @@
+#include "frame_budget.hpp"
+#include "logger.hpp"
+
+
+FrameBudget& FrameBudget::instance()
+{
+    // never destroyed: pipelines release their packets from static destructors
+    static FrameBudget *budget = new FrameBudget();
+    return *budget;
+}
+
+void FrameBudget::setLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.limit_bytes = bytes;
+    _limit_bytes.store(bytes, std::memory_order_relaxed);
+}
+
+size_t FrameBudget::getLimit()
+{
+    return _limit_bytes.load(std::memory_order_relaxed);
+}
+
+void FrameBudget::setStreamPriority(const std::string &stream_name, int priority)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stream_priorities[stream_name] = priority;
+}
+
+int FrameBudget::getStreamPriority(const std::string &stream_name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _stream_priorities.find(stream_name);
+    return it != _stream_priorities.end() ? it->second : 0;
+}
+
+bool FrameBudget::admit(Queue &queue, const std::shared_ptr<HostDataPacket> &packet, const std::function<bool()> &enqueue)
+{
+    if (_limit_bytes.load(std::memory_order_relaxed) == 0)
+    {
+        // nothing to evict or deny, the packet is not tracked
+        return enqueue();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const auto priority_it = _stream_priorities.find(packet->stream_name);
+    const int priority = priority_it != _stream_priorities.end() ? priority_it->second : 0;
+    const size_t bytes = packet->size();
+
+    // the limit may have been disabled since the check above
+    if (_stats.limit_bytes != 0)
+    {
+        if (bytes > _stats.limit_bytes)
+        {
+            Logger::instance().count(LogLevel::warn, "budget denied %u %s frames larger than the limit", packet->stream_name.c_str());
+            _stats.denied++;
+            return false;
+        }
+
+        while (_stats.used_bytes + bytes > _stats.limit_bytes)
+        {
+            const auto victim = _eviction_order.begin();
+            if (victim == _eviction_order.end() || victim->first.first > priority)
+            {
+                Logger::instance().count(LogLevel::warn, "budget denied %u %s frames", packet->stream_name.c_str());
+                _stats.denied++;
+                return false;
+            }
+
+            const auto entry = _entries.find(victim->second);
+            if (entry == _entries.end())
+            {
+                _eviction_order.erase(victim);
+                continue;
+            }
+
+            // a packet already taken by a consumer only waits for its release(),
+            // an evicted one is gone with the queue's reference
+            if (entry->second.queue->evictQueued(entry->first))
+            {
+                Logger::instance().count(LogLevel::warn, "budget evicted %u frames for %s frames", packet->stream_name.c_str());
+                _stats.evicted++;
+            }
+            erase(entry);
+        }
+    }
+
+    // left by a released packet whose address was reused
+    const auto stale = _entries.find(packet.get());
+    if (stale != _entries.end())
+    {
+        erase(stale);
+    }
+
+    // tracked before it is queued, a consumer can pop it as soon as enqueue()
+    // pushed it, its release() then waits for the lock
+    const EvictionKey key(priority, _next_admission++);
+    const auto entry = _entries.emplace(packet.get(), Entry{&queue, bytes, key}).first;
+    _eviction_order[key] = packet.get();
+    _stats.used_bytes += bytes;
+    _tracked_packets.fetch_add(1, std::memory_order_relaxed);
+
+    if (!enqueue())
+    {
+        erase(entry);
+        return false;
+    }
+
+    _stats.high_water_bytes = std::max(_stats.high_water_bytes, _stats.used_bytes);
+    _stats.admitted++;
+    return true;
+}
+
+void FrameBudget::release(const HostDataPacket *packet)
+{
+    // admit() raises the count before enqueue(), the queue lock orders the
+    // pop of a tracked packet after it
+    if (_tracked_packets.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto entry = _entries.find(packet);
+    if (entry != _entries.end())
+    {
+        erase(entry);
+    }
+}
+
+void FrameBudget::releaseQueue(Queue &queue)
+{
+    if (_tracked_packets.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto entry = _entries.begin(); entry != _entries.end(); )
+    {
+        auto next = std::next(entry);
+        if (entry->second.queue == &queue)
+        {
+            erase(entry);
+        }
+        entry = next;
+    }
+}
+
+FrameBudgetStats FrameBudget::getStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void FrameBudget::erase(Entries::iterator entry)
+{
+    _stats.used_bytes -= entry->second.bytes;
+    _eviction_order.erase(entry->second.key);
+    _entries.erase(entry);
+    _tracked_packets.fetch_sub(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,168 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "host_remap.hpp"
+#include "parallel_for.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTHAI_REMAP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTHAI_REMAP_NEON
+#endif
+
+
+constexpr int RemapTable::c_frac_bits;
+
+// rows per parallel task
+static constexpr int c_remap_row_tile = 16;
+
+
+void RemapTable::init(const RectificationModel &model, int width, int height)
+{
+    _width = width;
+    _height = height;
+
+    const size_t size = (size_t) width * height;
+    _offset.assign(size, 0);
+    _wx.assign(size, 0);
+    _wy.assign(size, 0);
+    _mask.assign(size, 0);
+
+    std::vector<float> xs(width);
+    for (int x = 0; x < width; x++)
+    {
+        xs[x] = x;
+    }
+
+    const int frac = 1 << c_frac_bits;
+
+    parallel_for(0, height, [&](int row_begin, int row_end)
+    {
+        std::vector<float> src_x(width), src_y(width);
+        for (int y = row_begin; y < row_end; y++)
+        {
+            model.mapRow(xs.data(), width, y, src_x.data(), src_y.data());
+
+            for (int x = 0; x < width; x++)
+            {
+                const size_t i = (size_t) y * width + x;
+                const float sx = src_x[x];
+                const float sy = src_y[x];
+
+                if (!(sx >= 0.f && sy >= 0.f && sx <= width - 1 && sy <= height - 1))
+                {
+                    continue;
+                }
+
+                // top-left pixel is kept inside, so that +1 neighbours are always valid
+                int x0 = std::min((int) sx, width - 2);
+                int y0 = std::min((int) sy, height - 2);
+                int wx = (int) lroundf((sx - x0) * frac);
+                int wy = (int) lroundf((sy - y0) * frac);
+
+                _offset[i] = y0 * width + x0;
+                _wx[i] = std::min(wx, frac);
+                _wy[i] = std::min(wy, frac);
+                _mask[i] = 0xFF;
+            }
+        }
+    }, c_remap_row_tile);
+}
+
+void RemapTable::remap(const uint8_t *src, uint8_t *dst) const
+{
+    const int tiles = (_height + c_remap_row_tile - 1) / c_remap_row_tile;
+
+    parallel_for(0, tiles, [&](int tile_begin, int tile_end)
+    {
+        remapRows(src, dst,
+            tile_begin * c_remap_row_tile,
+            std::min(_height, tile_end * c_remap_row_tile));
+    });
+}
+
+void RemapTable::remapRows(const uint8_t *src, uint8_t *dst, int row_begin, int row_end) const
+{
+    const int w = _width;
+    const int frac = 1 << c_frac_bits;
+    const int shift = 2 * c_frac_bits;
+
+    for (int y = row_begin; y < row_end; y++)
+    {
+        const size_t row = (size_t) y * w;
+        const int32_t  *offset = _offset.data() + row;
+        const uint16_t *wx_row = _wx.data() + row;
+        const uint16_t *wy_row = _wy.data() + row;
+        const uint8_t  *mask   = _mask.data() + row;
+        uint8_t        *out    = dst + row;
+
+        int x = 0;
+
+#if defined(DEPTHAI_REMAP_SSE2) || defined(DEPTHAI_REMAP_NEON)
+        for (; x + 8 <= w; x += 8)
+        {
+            // gather the 4 neighbours, weights are applied 8 pixels at a time
+            alignas(16) uint16_t p00[8], p01[8], p10[8], p11[8];
+            for (int k = 0; k < 8; k++)
+            {
+                const uint8_t *p = src + offset[x + k];
+                p00[k] = p[0];
+                p01[k] = p[1];
+                p10[k] = p[w];
+                p11[k] = p[w + 1];
+            }
+
+#if defined(DEPTHAI_REMAP_SSE2)
+            const __m128i wx  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wx_row + x));
+            const __m128i wy  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(wy_row + x));
+            const __m128i iwx = _mm_sub_epi16(_mm_set1_epi16(frac), wx);
+            const __m128i iwy = _mm_sub_epi16(_mm_set1_epi16(frac), wy);
+
+            const __m128i top = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(p00)), iwx),
+                _mm_mullo_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(p01)), wx));
+            const __m128i bottom = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(p10)), iwx),
+                _mm_mullo_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(p11)), wx));
+
+            const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(top, bottom), _mm_unpacklo_epi16(iwy, wy));
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(top, bottom), _mm_unpackhi_epi16(iwy, wy));
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, round), shift);
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, round), shift);
+
+            __m128i res = _mm_packs_epi32(lo, hi);
+            res = _mm_packus_epi16(res, res);
+            res = _mm_and_si128(res, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + x)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), res);
+#else
+            const uint16x8_t wx  = vld1q_u16(wx_row + x);
+            const uint16x8_t wy  = vld1q_u16(wy_row + x);
+            const uint16x8_t iwx = vsubq_u16(vdupq_n_u16(frac), wx);
+            const uint16x8_t iwy = vsubq_u16(vdupq_n_u16(frac), wy);
+
+            const uint16x8_t top    = vmlaq_u16(vmulq_u16(vld1q_u16(p00), iwx), vld1q_u16(p01), wx);
+            const uint16x8_t bottom = vmlaq_u16(vmulq_u16(vld1q_u16(p10), iwx), vld1q_u16(p11), wx);
+
+            const uint32x4_t lo = vmlal_u16(vmull_u16(vget_low_u16(top), vget_low_u16(iwy)), vget_low_u16(bottom), vget_low_u16(wy));
+            const uint32x4_t hi = vmlal_u16(vmull_u16(vget_high_u16(top), vget_high_u16(iwy)), vget_high_u16(bottom), vget_high_u16(wy));
+
+            const uint16x8_t res = vcombine_u16(vrshrn_n_u32(lo, 2 * c_frac_bits), vrshrn_n_u32(hi, 2 * c_frac_bits));
+            vst1_u8(out + x, vand_u8(vqmovn_u16(res), vld1_u8(mask + x)));
+#endif
+        }
+#endif
+
+        for (; x < w; x++)
+        {
+            const uint8_t *p = src + offset[x];
+            const int top    = p[0] * (frac - wx_row[x]) + p[1] * wx_row[x];
+            const int bottom = p[w] * (frac - wx_row[x]) + p[w + 1] * wx_row[x];
+            const int value  = (top * (frac - wy_row[x]) + bottom * wy_row[x] + (1 << (shift - 1))) >> shift;
+            out[x] = (uint8_t) value & mask[x];
+        }
+    }
+}
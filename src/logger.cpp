@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+
+#include "logger.hpp"
+
+
+constexpr int Logger::c_ring_size;
+constexpr int Logger::c_message_size;
+constexpr int Logger::c_aggregate_slots;
+constexpr int Logger::c_aggregate_key_size;
+
+// the logger thread wakes up at least this often to write out the ring
+static constexpr std::chrono::milliseconds c_logger_poll_interval(20);
+
+
+static LogLevel log_level_from_env(LogLevel default_level)
+{
+    const char *env = getenv("DEPTHAI_LOG_LEVEL");
+    if (env == nullptr)
+    {
+        return default_level;
+    }
+
+    const std::string value(env);
+    if (value == "debug") return LogLevel::debug;
+    if (value == "info")  return LogLevel::info;
+    if (value == "warn")  return LogLevel::warn;
+    if (value == "error") return LogLevel::error;
+    if (value == "off")   return LogLevel::off;
+    return default_level;
+}
+
+static void logger_shutdown_at_exit()
+{
+    Logger::instance().shutdown();
+}
+
+
+Logger& Logger::instance()
+{
+    // never destroyed: static objects can still log from their destructors,
+    // after shutdown() messages are written synchronously
+    static Logger *logger = []
+    {
+        Logger *l = new Logger();
+        atexit(logger_shutdown_at_exit);
+        return l;
+    }();
+    return *logger;
+}
+
+Logger::Logger()
+    : _level(log_level_from_env(LogLevel::info))
+    , _ring(new Message[c_ring_size])
+    , _enqueue_pos(0)
+    , _dropped_messages(0)
+    , _aggregates(new Aggregate[c_aggregate_slots])
+    , _aggregation_period_ms(1000)
+    , _synchronous(false)
+{
+    static_assert((c_ring_size & (c_ring_size - 1)) == 0, "c_ring_size must be a power of 2");
+    static_assert((c_aggregate_slots & (c_aggregate_slots - 1)) == 0, "c_aggregate_slots must be a power of 2");
+
+    for (int i = 0; i < c_ring_size; i++)
+    {
+        _ring[i].sequence.store(i, std::memory_order_relaxed);
+        _ring[i].long_text = nullptr;
+    }
+
+    for (int i = 0; i < c_aggregate_slots; i++)
+    {
+        _aggregates[i].key.store(0, std::memory_order_relaxed);
+        _aggregates[i].ready.store(false, std::memory_order_relaxed);
+        _aggregates[i].count.store(0, std::memory_order_relaxed);
+        _aggregates[i].users.store(0, std::memory_order_relaxed);
+    }
+
+    _thread = std::thread(&Logger::threadLoop, this);
+}
+
+void Logger::log(LogLevel level, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vlog(level, format, args);
+    va_end(args);
+}
+
+void Logger::vlog(LogLevel level, const char *format, va_list args)
+{
+    if (!isEnabled(level))
+    {
+        return;
+    }
+
+    if (_synchronous.load(std::memory_order_acquire))
+    {
+        char text[c_message_size];
+        vsnprintf(text, sizeof(text), format, args);
+        write(level, text);
+        return;
+    }
+
+    // claim a slot (bounded MPMC queue by D. Vyukov, single consumer here)
+    size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    Message *msg = nullptr;
+    for (;;)
+    {
+        msg = &_ring[pos & (c_ring_size - 1)];
+        const size_t seq = msg->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+
+        if (diff == 0)
+        {
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // full, the logger thread is behind
+            _dropped_messages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    const int len = vsnprintf(msg->text, sizeof(msg->text), format, args);
+    if (len >= (int) sizeof(msg->text))
+    {
+        msg->long_text = new std::string(len, '\0');
+        vsnprintf(&(*msg->long_text)[0], len + 1, format, args_copy);
+    }
+    va_end(args_copy);
+
+    msg->level = level;
+    msg->sequence.store(pos + 1, std::memory_order_release);
+
+    if (level >= LogLevel::error)
+    {
+        wake();
+    }
+}
+
+void Logger::count(LogLevel level, const char *format, const char *subject)
+{
+    if (!isEnabled(level))
+    {
+        return;
+    }
+
+    // FNV-1a of the format address and the subject
+    uint64_t key = 14695981039346656037ull ^ (uint64_t) (uintptr_t) format;
+    for (const char *c = subject; *c; c++)
+    {
+        key = (key ^ (unsigned char) *c) * 1099511628211ull;
+    }
+    key |= 1; // 0 marks an empty slot
+
+    for (int probe = 0; probe < c_aggregate_slots; probe++)
+    {
+        Aggregate &slot = _aggregates[(key + probe) & (c_aggregate_slots - 1)];
+
+        uint64_t slot_key = slot.key.load(std::memory_order_acquire);
+        if (slot_key == 0)
+        {
+            if (slot.key.compare_exchange_strong(slot_key, key, std::memory_order_acq_rel))
+            {
+                slot.level = level;
+                slot.format = format;
+                strncpy(slot.subject, subject, sizeof(slot.subject) - 1);
+                slot.subject[sizeof(slot.subject) - 1] = '\0';
+                slot.count.fetch_add(1, std::memory_order_relaxed);
+                slot.ready.store(true, std::memory_order_release);
+                return;
+            }
+            // slot_key now holds the key of the thread that won the slot
+        }
+
+        if (slot_key == key)
+        {
+            // seq_cst against writeAggregates(): either it sees the user, or
+            // the user sees ready == false while the slot is freed
+            slot.users.fetch_add(1);
+            bool counted = false;
+            while (!slot.ready.load() && slot.key.load(std::memory_order_acquire) == key)
+            {
+                std::this_thread::yield();
+            }
+            if (slot.ready.load()
+                && slot.key.load(std::memory_order_acquire) == key
+                && slot.format == format
+                && strncmp(slot.subject, subject, sizeof(slot.subject) - 1) == 0)
+            {
+                slot.count.fetch_add(1, std::memory_order_relaxed);
+                counted = true;
+            }
+            slot.users.fetch_sub(1, std::memory_order_release);
+            if (counted)
+            {
+                return;
+            }
+        }
+    }
+
+    // table full, too many distinct events
+    _dropped_messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Logger::setAggregationPeriod(std::chrono::milliseconds period)
+{
+    _aggregation_period_ms.store(period.count(), std::memory_order_relaxed);
+}
+
+void Logger::setSink(Sink sink)
+{
+    std::lock_guard<std::mutex> lock(_sink_mutex);
+    _sink = sink;
+}
+
+void Logger::flush()
+{
+    const size_t target = _enqueue_pos.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(_thread_mutex);
+    _wake = true;
+    _wake_cv.notify_one();
+    _flushed_cv.wait(lock, [&] { return _stop || _written_pos >= target; });
+}
+
+void Logger::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(_thread_mutex);
+        if (_stop)
+        {
+            return;
+        }
+        _stop = true;
+    }
+    _wake_cv.notify_one();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+void Logger::wake()
+{
+    // no lock: a missed wake up only delays the message by c_logger_poll_interval
+    _wake_cv.notify_one();
+}
+
+void Logger::threadLoop()
+{
+    auto last_aggregate = std::chrono::steady_clock::now();
+
+    for (;;)
+    {
+        bool stop = false;
+        {
+            std::unique_lock<std::mutex> lock(_thread_mutex);
+            _wake_cv.wait_for(lock, c_logger_poll_interval, [this] { return _wake || _stop; });
+            _wake = false;
+            stop = _stop;
+        }
+
+        while (writeNext())
+        {
+        }
+
+        const uint32_t dropped = _dropped_messages.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0)
+        {
+            char text[c_message_size];
+            snprintf(text, sizeof(text), "depthai: logger dropped %u messages", dropped);
+            write(LogLevel::warn, text);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (stop || now - last_aggregate >= std::chrono::milliseconds(_aggregation_period_ms.load(std::memory_order_relaxed)))
+        {
+            writeAggregates();
+            last_aggregate = now;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_thread_mutex);
+            _written_pos = _dequeue_pos;
+        }
+        _flushed_cv.notify_all();
+
+        if (stop)
+        {
+            break;
+        }
+    }
+
+    // producers racing with shutdown() may still have claimed slots
+    _synchronous.store(true, std::memory_order_release);
+    while (writeNext())
+    {
+    }
+}
+
+bool Logger::writeNext()
+{
+    Message &msg = _ring[_dequeue_pos & (c_ring_size - 1)];
+    if (msg.sequence.load(std::memory_order_acquire) != _dequeue_pos + 1)
+    {
+        return false;
+    }
+
+    if (msg.long_text != nullptr)
+    {
+        write(msg.level, msg.long_text->c_str());
+        delete msg.long_text;
+        msg.long_text = nullptr;
+    }
+    else
+    {
+        write(msg.level, msg.text);
+    }
+
+    msg.sequence.store(_dequeue_pos + c_ring_size, std::memory_order_release);
+    _dequeue_pos++;
+    return true;
+}
+
+void Logger::writeAggregates()
+{
+    const long long period_ms = _aggregation_period_ms.load(std::memory_order_relaxed);
+
+    char period[32];
+    if (period_ms % 1000 == 0)
+    {
+        snprintf(period, sizeof(period), "%llds", period_ms / 1000);
+    }
+    else
+    {
+        snprintf(period, sizeof(period), "%lldms", period_ms);
+    }
+
+    for (int i = 0; i < c_aggregate_slots; i++)
+    {
+        Aggregate &slot = _aggregates[i];
+        if (!slot.ready.load(std::memory_order_acquire))
+        {
+            continue;
+        }
+
+        uint32_t n = slot.count.exchange(0, std::memory_order_relaxed);
+        if (n == 0)
+        {
+            // idle for a whole period, free the slot unless count() is reading it.
+            // A later chain slot of the same probe sequence may then get a
+            // duplicate, both are reported until the older one goes idle.
+            slot.ready.store(false);
+            if (slot.users.load() != 0)
+            {
+                slot.ready.store(true, std::memory_order_release);
+                continue;
+            }
+            n = slot.count.exchange(0, std::memory_order_relaxed);
+            if (n == 0)
+            {
+                slot.key.store(0, std::memory_order_release);
+                continue;
+            }
+            slot.ready.store(true, std::memory_order_release);
+        }
+
+        char text[c_message_size];
+        const int len = snprintf(text, sizeof(text), slot.format, n, slot.subject);
+        if (len >= 0 && len < (int) sizeof(text))
+        {
+            snprintf(text + len, sizeof(text) - len, " in last %s", period);
+        }
+        write(slot.level, text);
+    }
+}
+
+void Logger::write(LogLevel level, const char *text)
+{
+    std::lock_guard<std::mutex> lock(_sink_mutex);
+
+    if (_sink)
+    {
+        _sink(level, text);
+        return;
+    }
+
+    std::ostream &out = level >= LogLevel::warn ? std::cerr : std::cout;
+    const size_t len = strlen(text);
+    out << text;
+    if (len == 0 || text[len - 1] != '\n')
+    {
+        out << "\n";
+    }
+    out.flush();
+}
+
+
+void log_debug(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Logger::instance().vlog(LogLevel::debug, format, args);
+    va_end(args);
+}
+
+void log_info(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Logger::instance().vlog(LogLevel::info, format, args);
+    va_end(args);
+}
+
+void log_warn(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Logger::instance().vlog(LogLevel::warn, format, args);
+    va_end(args);
+}
+
+void log_error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Logger::instance().vlog(LogLevel::error, format, args);
+    va_end(args);
+}
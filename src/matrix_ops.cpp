@@ -1,10 +1,12 @@
 #include "matrix_ops.hpp"
+#include <cmath>
+#include <cstdlib>
 #include <vector>
 #include <iostream>
+#include <utility>
 
 // Code copied and adapted (int to float mainly) from:
 // https://www.geeksforgeeks.org/c-program-multiply-two-matrices/
-// https://www.geeksforgeeks.org/adjoint-inverse-matrix/
 
 
 // This function multiplies
@@ -21,6 +23,14 @@ std::vector<std::vector<float>> mat_mul(std::vector<std::vector<float>>& firstMa
         // Return an empty vector
         return res;
     }
+
+    // fixed-size fast paths
+    if(firstMatrix.size() == 3 && secondMatrix.size() == 3 && firstMatrix[0].size() == 3 && secondMatrix[0].size() == 3){
+        return mat_mul(Mat3f::fromVector(firstMatrix), Mat3f::fromVector(secondMatrix)).toVector();
+    }
+    if(firstMatrix.size() == 4 && secondMatrix.size() == 4 && firstMatrix[0].size() == 4 && secondMatrix[0].size() == 4){
+        return mat_mul(Mat4f::fromVector(firstMatrix), Mat4f::fromVector(secondMatrix)).toVector();
+    }
         
 	// Initializing elements of matrix mult to 0.
 	for(int i = 0; i < firstMatrix.size(); ++i)
@@ -43,133 +53,71 @@ std::vector<std::vector<float>> mat_mul(std::vector<std::vector<float>>& firstMa
     return res;
 }
 
-/* 
- * Function to get cofactor of A[p][q] in temp. n is current
- * dimension of part of A that we are calculating cofactor for.
- */
-static void getCofactor(std::vector<std::vector<float>>& A,
-                        std::vector<std::vector<float>>&  temp, 
-                        int p, 
-                        int q, 
-                        int n)
+// Function to calculate and store inverse, returns false if
+// matrix is singular
+bool mat_inv(std::vector<std::vector<float>>& A, 
+             std::vector<std::vector<float>>& inverse)
 {
-    int i = 0, j = 0;
-
-    // Looping for each element of the matrix
-    for (int row = 0; row < n; row++)
-    {
-        for (int col = 0; col < n; col++)
-        {
-            //  Copying into temporary matrix only those element
-            //  which are not in given row and column
-            if (row != p && col != q)
-            {
-                temp[i][j++] = A[row][col];
-
-                // Row is filled, so increase row index and
-                // reset col index
-                if (j == n - 1)
-                {
-                    j = 0;
-                    i++;
-                }
-            }
-        }
+    if(A[0].size() != A.size()){
+        std::cerr << "Not a Square Matrix " << std::endl;
+        abort();
     }
-}
 
+    const int n = A.size();
 
-/* Recursive function for finding determinant of matrix.
-   n is current dimension of A[][]. */
-static float determinant(std::vector<std::vector<float>>& A, int n)
-
-{
-    float D = 0; // Initialize result
-    
-    //  Base case : if matrix contains single element
-    if (n == 1)
-        return A[0][0];
-
-    std::vector<std::vector<float>> temp(n, std::vector<float>(n, 0)); // To store cofactors
-    int sign = 1;  // To store sign multiplier
-
-     // Iterate for each element of first row
-    for (int f = 0; f < n; f++)
-    {
-        // Getting Cofactor of A[0][f]
-        getCofactor(A, temp, 0, f, n);
-        D += sign * A[0][f] * determinant(temp, n - 1);
-
-        // terms are to be added with alternate sign
-        sign = -sign;
+    // fixed-size fast paths, closed-form
+    if(n == 3){
+        Mat3f inv;
+        if(!mat_inv(Mat3f::fromVector(A), inv)) return false;
+        inverse = inv.toVector();
+        return true;
     }
-
-    return D;
-}
-
-// Function to get adjoint of A in adj.
-static void adjoint(std::vector<std::vector<float>>& A, std::vector<std::vector<float>>& adj)
-{
-    if (A.size() == 1)
-    {
-        adj[0][0] = 1;
-        return;
+    if(n == 4){
+        Mat4f inv;
+        if(!mat_inv(Mat4f::fromVector(A), inv)) return false;
+        inverse = inv.toVector();
+        return true;
     }
 
-    // temp is used to store the final cofactors of A
-    int sign = 1;
-    std::vector<std::vector<float>> temp(A.size(), std::vector<float>(A.size(), 0));
+    // Gauss-Jordan elimination with partial pivoting, O(n^3)
+    std::vector<std::vector<float>> a = A;
+    std::vector<std::vector<float>> inv(n, std::vector<float>(n, 0));
+    for (int i = 0; i < n; i++){
+        inv[i][i] = 1;
+    }
 
-    for (int i=0; i<A.size(); i++)
+    for (int col = 0; col < n; col++)
     {
-        for (int j=0; j<A.size(); j++)
+        int pivot = col;
+        for (int row = col + 1; row < n; row++){
+            if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) pivot = row;
+        }
+        if (a[pivot][col] == 0)
         {
-            // Get cofactor of A[i][j]
-            getCofactor(A, temp, i, j, A.size());
-
-            // sign of adj[j][i] positive if sum of row
-            // and column indexes is even.
-            sign = ((i+j)%2==0)? 1: -1;
-
-            // Interchanging rows and columns to get the
-            // transpose of the cofactor matrix
-            adj[j][i] = (sign)*(determinant(temp, A.size()-1));
+            //cout << "Singular matrix, can't find its inverse";
+            return false;
         }
-    }
-}
+        std::swap(a[pivot], a[col]);
+        std::swap(inv[pivot], inv[col]);
 
-// Function to calculate and store inverse, returns false if
-// matrix is singular
-bool mat_inv(std::vector<std::vector<float>>& A, 
-             std::vector<std::vector<float>>& inverse)
-{
-    // Find determinant of A[][]
-    if(A[0].size() != A.size()){
-        std::cerr << "Not a Square Matrix " << std::endl;
-        abort();
-    }
-
-    float det = determinant(A, A.size());
-    if (det == 0)
-    {
-        //cout << "Singular matrix, can't find its inverse";
-        return false;
-    }
+        const float scale = 1.f / a[col][col];
+        for (int j = 0; j < n; j++){
+            a[col][j] *= scale;
+            inv[col][j] *= scale;
+        }
 
-    // Find adjoint
-    std::vector<std::vector<float>> adj(A.size(), std::vector<float>(A.size(), 0));
-    adjoint(A, adj);
-    
-    std::vector<float> temp;
-    // Find Inverse using formula "inverse(A) = adj(A)/det(A)"
-    for (int i = 0; i < A.size(); i++){
-        for (int j = 0; j < A.size(); j++){
-            temp.push_back(adj[i][j] / det);
+        for (int row = 0; row < n; row++)
+        {
+            if (row == col || a[row][col] == 0) continue;
+            const float factor = a[row][col];
+            for (int j = 0; j < n; j++){
+                a[row][j] -= factor * a[col][j];
+                inv[row][j] -= factor * inv[col][j];
+            }
         }
-        inverse.push_back(temp);
-        temp.clear();
     }
 
+    inverse = inv;
     return true;
 }
 
@@ -0,0 +1,755 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "mp4_writer.hpp"
+#include "logger.hpp"
+
+
+namespace
+{
+
+constexpr uint32_t c_timescale = 90000;
+constexpr int      c_max_iov = 1024;
+
+#ifdef _WIN32
+struct iovec
+{
+    void  *iov_base;
+    size_t iov_len;
+};
+#endif
+
+int open_file(const std::string &path)
+{
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+}
+
+void close_file(int fd)
+{
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+// Writes all chunks, iov is modified on partial writes
+bool write_vectored(int fd, iovec *iov, size_t count)
+{
+    while (count > 0)
+    {
+#ifdef _WIN32
+        const int written = _write(fd, iov->iov_base, (unsigned) iov->iov_len);
+#else
+        const ssize_t written = writev(fd, iov, (int) std::min<size_t>(count, c_max_iov));
+#endif
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        size_t left = (size_t) written;
+        while (count > 0 && left >= iov->iov_len)
+        {
+            left -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + left;
+            iov->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+// Big endian ISO BMFF box serialization
+class BoxWriter
+{
+public:
+    explicit BoxWriter(std::vector<uint8_t> &buffer)
+        : _buffer(buffer)
+    {}
+
+    void u8(uint32_t v)  { _buffer.push_back((uint8_t) v); }
+    void u16(uint32_t v) { u8(v >> 8); u8(v); }
+    void u32(uint32_t v) { u16(v >> 16); u16(v); }
+    void u64(uint64_t v) { u32((uint32_t) (v >> 32)); u32((uint32_t) v); }
+    void zeros(size_t count) { _buffer.insert(_buffer.end(), count, 0); }
+
+    void bytes(const void *data, size_t size)
+    {
+        const uint8_t *p = static_cast<const uint8_t*>(data);
+        _buffer.insert(_buffer.end(), p, p + size);
+    }
+
+    size_t begin(const char *type)
+    {
+        const size_t pos = _buffer.size();
+        u32(0);
+        bytes(type, 4);
+        return pos;
+    }
+
+    size_t beginFull(const char *type, uint8_t version, uint32_t flags)
+    {
+        const size_t pos = begin(type);
+        u8(version);
+        u8(flags >> 16);
+        u16(flags);
+        return pos;
+    }
+
+    void end(size_t pos)
+    {
+        patch32(pos, (uint32_t) (_buffer.size() - pos));
+    }
+
+    void patch32(size_t pos, uint32_t v)
+    {
+        _buffer[pos]     = (uint8_t) (v >> 24);
+        _buffer[pos + 1] = (uint8_t) (v >> 16);
+        _buffer[pos + 2] = (uint8_t) (v >> 8);
+        _buffer[pos + 3] = (uint8_t) v;
+    }
+
+    size_t size() const { return _buffer.size(); }
+
+    void matrix()
+    {
+        const uint32_t unity[9] = {0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000};
+        for (uint32_t v : unity)
+        {
+            u32(v);
+        }
+    }
+
+private:
+    std::vector<uint8_t> &_buffer;
+};
+
+// Parameter sets are stored with a 4 byte start code
+const uint8_t* nal_payload(const std::vector<uint8_t> &annexb) { return annexb.data() + 4; }
+size_t nal_size(const std::vector<uint8_t> &annexb) { return annexb.size() - 4; }
+
+// First bytes of the RBSP, without emulation prevention bytes
+std::vector<uint8_t> unescape_rbsp(const uint8_t *data, size_t size, size_t max_size)
+{
+    std::vector<uint8_t> rbsp;
+    int zeros = 0;
+    for (size_t i = 0; i < size && rbsp.size() < max_size; i++)
+    {
+        if (zeros >= 2 && data[i] == 3)
+        {
+            zeros = 0;
+            continue;
+        }
+        zeros = data[i] == 0 ? zeros + 1 : 0;
+        rbsp.push_back(data[i]);
+    }
+    return rbsp;
+}
+
+// NAL units stored in samples, parameter sets go to the sample entry
+bool is_sample_nal(VideoCodec codec, uint8_t type)
+{
+    if (codec == VideoCodec::H264)
+    {
+        return type != 7 && type != 8 && type != 9;             // SPS, PPS, AUD
+    }
+    return type != 32 && type != 33 && type != 34 && type != 35;   // VPS, SPS, PPS, AUD
+}
+
+bool write_avcc(BoxWriter &box, const VideoParameterSets &sets)
+{
+    if (sets.sps.size() < 8 || sets.pps.size() < 5)
+    {
+        return false;
+    }
+    const uint8_t *sps = nal_payload(sets.sps);
+
+    const size_t avcc = box.begin("avcC");
+    box.u8(1);          // configurationVersion
+    box.u8(sps[1]);     // profile_idc
+    box.u8(sps[2]);     // constraint flags
+    box.u8(sps[3]);     // level_idc
+    box.u8(0xff);       // 4 byte NAL unit lengths
+    box.u8(0xe1);       // 1 SPS
+    box.u16((uint32_t) nal_size(sets.sps));
+    box.bytes(sps, nal_size(sets.sps));
+    box.u8(1);          // 1 PPS
+    box.u16((uint32_t) nal_size(sets.pps));
+    box.bytes(nal_payload(sets.pps), nal_size(sets.pps));
+    box.end(avcc);
+    return true;
+}
+
+bool write_hvcc(BoxWriter &box, const VideoParameterSets &sets)
+{
+    if (sets.vps.size() < 6 || sets.sps.size() < 6 || sets.pps.size() < 6)
+    {
+        return false;
+    }
+
+    // sps_video_parameter_set_id .. general_level_idc
+    const std::vector<uint8_t> sps = unescape_rbsp(nal_payload(sets.sps) + 2, nal_size(sets.sps) - 2, 13);
+    if (sps.size() < 13)
+    {
+        return false;
+    }
+    const unsigned max_sub_layers = ((sps[0] >> 1) & 7) + 1;
+    const unsigned temporal_id_nested = sps[0] & 1;
+
+    const size_t hvcc = box.begin("hvcC");
+    box.u8(1);                      // configurationVersion
+    box.bytes(&sps[1], 12);         // profile space / tier / idc, compatibility, constraints, level
+    box.u16(0xf000);                // min_spatial_segmentation_idc
+    box.u8(0xfc);                   // parallelismType
+    box.u8(0xfc | 1);               // chroma_format_idc 4:2:0
+    box.u8(0xf8);                   // bit_depth_luma_minus8
+    box.u8(0xf8);                   // bit_depth_chroma_minus8
+    box.u16(0);                     // avgFrameRate
+    box.u8((max_sub_layers << 3) | (temporal_id_nested << 2) | 3);
+
+    const std::vector<uint8_t> *arrays[] = {&sets.vps, &sets.sps, &sets.pps};
+    const uint8_t types[] = {32, 33, 34};
+    box.u8(3);
+    for (int i = 0; i < 3; i++)
+    {
+        box.u8(0x80 | types[i]);    // array_completeness
+        box.u16(1);
+        box.u16((uint32_t) nal_size(*arrays[i]));
+        box.bytes(nal_payload(*arrays[i]), nal_size(*arrays[i]));
+    }
+    box.end(hvcc);
+    return true;
+}
+
+// ftyp + moov with one video track, no samples
+bool build_init_segment(std::vector<uint8_t> &buffer, VideoCodec codec, const VideoParameterSets &sets, int width, int height)
+{
+    BoxWriter box(buffer);
+
+    const size_t ftyp = box.begin("ftyp");
+    box.bytes("isom", 4);
+    box.u32(0x200);
+    box.bytes("isomiso5iso6mp41", 16);
+    box.end(ftyp);
+
+    const size_t moov = box.begin("moov");
+    {
+        const size_t mvhd = box.beginFull("mvhd", 0, 0);
+        box.u32(0);                 // creation_time
+        box.u32(0);                 // modification_time
+        box.u32(1000);              // timescale
+        box.u32(0);                 // duration, in the fragments
+        box.u32(0x00010000);        // rate
+        box.u16(0x0100);            // volume
+        box.zeros(10);
+        box.matrix();
+        box.zeros(24);
+        box.u32(2);                 // next_track_ID
+        box.end(mvhd);
+
+        const size_t trak = box.begin("trak");
+        {
+            const size_t tkhd = box.beginFull("tkhd", 0, 3);   // enabled, in movie
+            box.u32(0);
+            box.u32(0);
+            box.u32(1);             // track_ID
+            box.u32(0);
+            box.u32(0);             // duration
+            box.zeros(8);
+            box.u16(0);             // layer
+            box.u16(0);             // alternate_group
+            box.u16(0);             // volume
+            box.u16(0);
+            box.matrix();
+            box.u32((uint32_t) width << 16);
+            box.u32((uint32_t) height << 16);
+            box.end(tkhd);
+
+            const size_t mdia = box.begin("mdia");
+            {
+                const size_t mdhd = box.beginFull("mdhd", 0, 0);
+                box.u32(0);
+                box.u32(0);
+                box.u32(c_timescale);
+                box.u32(0);
+                box.u16(0x55c4);    // "und"
+                box.u16(0);
+                box.end(mdhd);
+
+                const size_t hdlr = box.beginFull("hdlr", 0, 0);
+                box.u32(0);
+                box.bytes("vide", 4);
+                box.zeros(12);
+                box.bytes("VideoHandler", 13);
+                box.end(hdlr);
+
+                const size_t minf = box.begin("minf");
+                {
+                    const size_t vmhd = box.beginFull("vmhd", 0, 1);
+                    box.zeros(8);
+                    box.end(vmhd);
+
+                    const size_t dinf = box.begin("dinf");
+                    const size_t dref = box.beginFull("dref", 0, 0);
+                    box.u32(1);
+                    box.end(box.beginFull("url ", 0, 1));      // data in this file
+                    box.end(dref);
+                    box.end(dinf);
+
+                    const size_t stbl = box.begin("stbl");
+                    {
+                        const size_t stsd = box.beginFull("stsd", 0, 0);
+                        box.u32(1);
+                        const size_t entry = box.begin(codec == VideoCodec::H264 ? "avc1" : "hvc1");
+                        box.zeros(6);
+                        box.u16(1);             // data_reference_index
+                        box.zeros(16);
+                        box.u16(width);
+                        box.u16(height);
+                        box.u32(0x00480000);    // 72 dpi
+                        box.u32(0x00480000);
+                        box.u32(0);
+                        box.u16(1);             // frame_count
+                        box.zeros(32);          // compressorname
+                        box.u16(0x18);          // depth
+                        box.u16(0xffff);
+                        if (!(codec == VideoCodec::H264 ? write_avcc(box, sets) : write_hvcc(box, sets)))
+                        {
+                            return false;
+                        }
+                        box.end(entry);
+                        box.end(stsd);
+
+                        // empty sample tables, samples are in the fragments
+                        for (const char *table : {"stts", "stsc", "stsz", "stco"})
+                        {
+                            const size_t pos = box.beginFull(table, 0, 0);
+                            if (strcmp(table, "stsz") == 0)
+                            {
+                                box.u32(0);     // sample_size
+                            }
+                            box.u32(0);         // entry / sample count
+                            box.end(pos);
+                        }
+                    }
+                    box.end(stbl);
+                }
+                box.end(minf);
+            }
+            box.end(mdia);
+        }
+        box.end(trak);
+
+        const size_t mvex = box.begin("mvex");
+        const size_t trex = box.beginFull("trex", 0, 0);
+        box.u32(1);                 // track_ID
+        box.u32(1);                 // default_sample_description_index
+        box.u32(0);
+        box.u32(0);
+        box.u32(0);
+        box.end(trex);
+        box.end(mvex);
+    }
+    box.end(moov);
+    return true;
+}
+
+std::string format_segment_path(const std::string &pattern, unsigned index, bool add_index)
+{
+    if (pattern.find('%') != std::string::npos)
+    {
+        std::vector<char> path(pattern.size() + 32);
+        snprintf(path.data(), path.size(), pattern.c_str(), index);
+        return path.data();
+    }
+    if (!add_index)
+    {
+        return pattern;
+    }
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%04u", index);
+    const size_t dot = pattern.find_last_of('.');
+    const size_t slash = pattern.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return pattern + suffix;
+    }
+    return pattern.substr(0, dot) + suffix + pattern.substr(dot);
+}
+
+} // namespace
+
+
+Mp4Writer::Mp4Writer(const Mp4WriterConfig &config)
+    : _config(config)
+    , _default_duration((uint32_t) lround(c_timescale / std::max(config.fps, 1.f)))
+    , _resync(false)
+    , _written_bytes(0)
+    , _written_fragments(0)
+    , _dropped_fragments(0)
+    , _failed_fragments(0)
+{
+    _thread = std::thread(&Mp4Writer::writerThread, this);
+}
+
+Mp4Writer::~Mp4Writer()
+{
+    stop();
+}
+
+void Mp4Writer::onPacket(const std::shared_ptr<HostDataPacket> &packet)
+{
+    std::lock_guard<std::mutex> lock(_packet_mutex);
+    if (_stopped)
+    {
+        return;
+    }
+
+    const std::shared_ptr<const VideoFrameInfo> info = packet->video_info;
+    if (info == nullptr)
+    {
+        Logger::instance().count(LogLevel::warn, "mp4 writer: received %u %s packets without NAL parser info", packet->stream_name.c_str());
+        return;
+    }
+
+    const int64_t tick = packet->opt_metadata
+        ? (int64_t) llround(packet->opt_metadata->getTimestamp() * c_timescale)
+        : _last_tick + _default_duration;
+
+    // the timeline advances for every packet, also the skipped ones
+    if (_started)
+    {
+        int64_t duration = tick - _last_tick;
+        if (duration <= 0 || duration > 10 * (int64_t) c_timescale)
+        {
+            duration = _default_duration;
+        }
+        if (_fragment && !_fragment->samples.empty())
+        {
+            _fragment->samples.back().duration = (uint32_t) duration;
+            _fragment_time += duration;
+        }
+        _decode_time += duration;
+    }
+    _last_tick = tick;
+    _started = true;
+
+    if (_resync.exchange(false))
+    {
+        // the file is incomplete after a write error, start a new one at the next keyframe
+        if (_fragment && !_fragment->samples.empty())
+        {
+            _failed_fragments++;
+        }
+        _fragment = nullptr;
+        _fragment_time = 0;
+        _synced = false;
+        _need_segment = true;
+    }
+
+    const uint64_t fragment_ticks = (uint64_t) (_config.fragment_duration_s * c_timescale);
+    const bool keyframe = info->keyframe && info->parameter_sets != nullptr;
+    if (_fragment && !_fragment->samples.empty()
+        && ((keyframe && _fragment_time >= fragment_ticks) || _fragment_time >= 2 * fragment_ticks))
+    {
+        closeFragment();
+    }
+
+    if (!_synced)
+    {
+        if (!keyframe)
+        {
+            return;
+        }
+        _synced = true;
+    }
+
+    if (_fragment == nullptr)
+    {
+        const bool rotate = _need_segment
+            || (keyframe && _config.segment_duration_s > 0 && _decode_time >= _config.segment_duration_s * c_timescale);
+
+        _fragment.reset(new Fragment());
+        _fragment_time = 0;
+        if (rotate)
+        {
+            _decode_time = 0;
+            _need_segment = false;
+            _fragment->new_segment = true;
+            _fragment->segment_index = _segment_index++;
+            _fragment->parameter_sets = info->parameter_sets;
+        }
+        _fragment->base_decode_time = _decode_time;
+    }
+
+    Sample sample;
+    sample.packet = packet;
+    sample.duration = _default_duration;
+    sample.keyframe = info->keyframe;
+    sample.size = 0;
+    for (const NalUnit &nal : info->nal_units)
+    {
+        if (is_sample_nal(info->codec, nal.type))
+        {
+            sample.size += 4 + nal.size;
+        }
+    }
+    _fragment->samples.push_back(sample);
+}
+
+void Mp4Writer::closeFragment()
+{
+    std::unique_ptr<Fragment> fragment = std::move(_fragment);
+    _fragment_time = 0;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_pending)
+    {
+        // writer still busy with the previous fragment, resume at the next keyframe
+        _dropped_fragments++;
+        _synced = false;
+        if (fragment->new_segment)
+        {
+            // its file was never opened, the next fragment starts it again
+            _need_segment = true;
+            _segment_index--;
+        }
+        Logger::instance().count(LogLevel::warn, "mp4 writer: dropped %u fragments of %s, writer too slow", _config.path.c_str());
+        return;
+    }
+    _pending = std::move(fragment);
+    _cv.notify_all();
+}
+
+void Mp4Writer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_packet_mutex);
+        if (_stopped)
+        {
+            return;
+        }
+        _stopped = true;
+
+        if (_fragment && !_fragment->samples.empty())
+        {
+            // last fragment is not dropped, wait for the writer
+            std::unique_lock<std::mutex> writer_lock(_mutex);
+            _cv.wait(writer_lock, [this]() { return _pending == nullptr; });
+            _pending = std::move(_fragment);
+            _cv.notify_all();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+        _cv.notify_all();
+    }
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+    if (_fd >= 0)
+    {
+        close_file(_fd);
+        _fd = -1;
+    }
+}
+
+void Mp4Writer::writerThread()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _cv.wait(lock, [this]() { return _pending != nullptr || _quit; });
+        if (_pending == nullptr)
+        {
+            break;
+        }
+
+        // the fragment stays pending while written, see closeFragment()
+        Fragment *fragment = _pending.get();
+        lock.unlock();
+        if (_failed && !fragment->new_segment)
+        {
+            // already queued before the stream thread saw _resync
+            _failed_fragments++;
+            Logger::instance().count(LogLevel::warn, "mp4 writer: skipped %u fragments of %s after a write error", _config.path.c_str());
+        }
+        else
+        {
+            _failed = !writeFragment(*fragment);
+            if (_failed)
+            {
+                _failed_fragments++;
+                _resync = true;
+            }
+        }
+        lock.lock();
+        _pending = nullptr;
+        _cv.notify_all();
+    }
+}
+
+bool Mp4Writer::openSegment(const Fragment &fragment)
+{
+    if (_fd >= 0)
+    {
+        close_file(_fd);
+        _fd = -1;
+    }
+
+    // a single file gets an index only when restarted after an error, not to overwrite it
+    const std::string path = format_segment_path(_config.path, fragment.segment_index,
+        _config.segment_duration_s > 0 || fragment.segment_index > 0);
+    const VideoCodec codec = fragment.samples.front().packet->video_info->codec;
+    const VideoParameterSets &sets = *fragment.parameter_sets;
+
+    _header.clear();
+    if (!build_init_segment(_header, codec, sets,
+        sets.width > 0 ? sets.width : _config.width,
+        sets.height > 0 ? sets.height : _config.height))
+    {
+        log_error("mp4 writer: incomplete parameter sets, can't start %s", path.c_str());
+        return false;
+    }
+
+    _fd = open_file(path);
+    if (_fd < 0)
+    {
+        log_error("mp4 writer: can't open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    log_info("mp4 writer: writing %s", path.c_str());
+
+    iovec iov;
+    iov.iov_base = _header.data();
+    iov.iov_len = _header.size();
+    if (!write_vectored(_fd, &iov, 1))
+    {
+        log_error("mp4 writer: write to %s failed: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    _written_bytes += _header.size();
+    _fragment_sequence = 0;
+    return true;
+}
+
+bool Mp4Writer::writeFragment(Fragment &fragment)
+{
+    if (fragment.new_segment && !openSegment(fragment))
+    {
+        return false;
+    }
+    if (_fd < 0)
+    {
+        return false;
+    }
+
+    uint64_t payload_size = 0;
+    size_t nal_count = 0;
+    for (const Sample &sample : fragment.samples)
+    {
+        payload_size += sample.size;
+        nal_count += sample.packet->video_info->nal_units.size();
+    }
+
+    // moof
+    _header.clear();
+    BoxWriter box(_header);
+    const size_t moof = box.begin("moof");
+    const size_t mfhd = box.beginFull("mfhd", 0, 0);
+    box.u32(++_fragment_sequence);
+    box.end(mfhd);
+
+    const size_t traf = box.begin("traf");
+    const size_t tfhd = box.beginFull("tfhd", 0, 0x020000);    // default-base-is-moof
+    box.u32(1);
+    box.end(tfhd);
+    const size_t tfdt = box.beginFull("tfdt", 1, 0);
+    box.u64(fragment.base_decode_time);
+    box.end(tfdt);
+
+    // data offset, duration, size and flags per sample
+    const size_t trun = box.beginFull("trun", 0, 0x000701);
+    box.u32((uint32_t) fragment.samples.size());
+    const size_t data_offset = box.size();
+    box.u32(0);
+    for (const Sample &sample : fragment.samples)
+    {
+        box.u32(sample.duration);
+        box.u32(sample.size);
+        box.u32(sample.keyframe ? 0x02000000 : 0x01010000);
+    }
+    box.end(trun);
+    box.end(traf);
+    box.end(moof);
+    box.patch32(data_offset, (uint32_t) (box.size() - moof + 8));
+
+    // mdat header, the payload is written from the packet buffers
+    box.u32((uint32_t) (8 + payload_size));
+    box.bytes("mdat", 4);
+
+    _lengths.resize(nal_count);
+    std::vector<iovec> iov;
+    iov.reserve(1 + 2 * nal_count);
+    iov.push_back({_header.data(), _header.size()});
+
+    size_t length_index = 0;
+    for (const Sample &sample : fragment.samples)
+    {
+        const VideoFrameInfo &info = *sample.packet->video_info;
+        uint8_t *data = const_cast<uint8_t*>(sample.packet->getData());
+        for (const NalUnit &nal : info.nal_units)
+        {
+            if (!is_sample_nal(info.codec, nal.type))
+            {
+                continue;
+            }
+            uint8_t *length = reinterpret_cast<uint8_t*>(&_lengths[length_index++]);
+            length[0] = (uint8_t) (nal.size >> 24);
+            length[1] = (uint8_t) (nal.size >> 16);
+            length[2] = (uint8_t) (nal.size >> 8);
+            length[3] = (uint8_t) nal.size;
+            iov.push_back({length, 4});
+            iov.push_back({data + nal.offset, nal.size});
+        }
+    }
+
+    if (!write_vectored(_fd, iov.data(), iov.size()))
+    {
+        Logger::instance().count(LogLevel::error, "mp4 writer: %u fragment writes failed: %s", strerror(errno));
+        return false;
+    }
+    _written_bytes += _header.size() + payload_size;
+    _written_fragments++;
+    return true;
+}
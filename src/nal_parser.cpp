@@ -0,0 +1,641 @@
+#include <algorithm>
+
+#include "nal_parser.hpp"
+#include "logger.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTHAI_NAL_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTHAI_NAL_NEON
+#endif
+
+
+namespace
+{
+
+// H.264 nal_unit_type
+enum : uint8_t
+{
+    H264_SLICE     = 1,
+    H264_SLICE_IDR = 5,
+    H264_SPS       = 7,
+    H264_PPS       = 8,
+};
+
+// H.265 nal_unit_type
+enum : uint8_t
+{
+    H265_IRAP_FIRST = 16,   // BLA_W_LP
+    H265_IRAP_LAST  = 23,
+    H265_VPS        = 32,
+    H265_SPS        = 33,
+    H265_PPS        = 34,
+};
+
+const uint8_t c_start_code[] = {0, 0, 0, 1};
+
+// Exp-Golomb reader over a NAL payload, skipping emulation prevention bytes
+class BitReader
+{
+public:
+    BitReader(const uint8_t *data, size_t size)
+        : _data(data), _size(size)
+    {}
+
+    bool ok() const { return !_overrun; }
+
+    unsigned readBit()
+    {
+        if (_bit == 0)
+        {
+            if (_pos >= _size)
+            {
+                _overrun = true;
+                return 0;
+            }
+            // 00 00 03 -> 00 00
+            if (_zeros >= 2 && _data[_pos] == 3)
+            {
+                _zeros = 0;
+                if (++_pos >= _size)
+                {
+                    _overrun = true;
+                    return 0;
+                }
+            }
+            _byte = _data[_pos++];
+            _zeros = _byte == 0 ? _zeros + 1 : 0;
+            _bit = 8;
+        }
+        return (_byte >> --_bit) & 1;
+    }
+
+    unsigned readBits(int count)
+    {
+        unsigned value = 0;
+        for (int i = 0; i < count; i++)
+        {
+            value = (value << 1) | readBit();
+        }
+        return value;
+    }
+
+    unsigned readUe()
+    {
+        int leading_zeros = 0;
+        while (readBit() == 0 && ok())
+        {
+            if (++leading_zeros > 31)
+            {
+                _overrun = true;
+                return 0;
+            }
+        }
+        return ((1u << leading_zeros) - 1) + readBits(leading_zeros);
+    }
+
+    int readSe()
+    {
+        const unsigned value = readUe();
+        return (value & 1) ? (int) ((value + 1) / 2) : -(int) (value / 2);
+    }
+
+    void skipBits(int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            readBit();
+        }
+    }
+
+private:
+    const uint8_t *_data;
+    size_t         _size;
+    size_t         _pos = 0;
+    int            _zeros = 0;
+    uint8_t        _byte = 0;
+    int            _bit = 0;
+    bool           _overrun = false;
+};
+
+void set_annexb(std::vector<uint8_t> &dst, const uint8_t *nal, size_t size)
+{
+    dst.assign(c_start_code, c_start_code + sizeof(c_start_code));
+    dst.insert(dst.end(), nal, nal + size);
+}
+
+bool same_annexb(const std::vector<uint8_t> &a, const uint8_t *nal, size_t size)
+{
+    return a.size() == size + sizeof(c_start_code)
+        && std::equal(nal, nal + size, a.begin() + sizeof(c_start_code));
+}
+
+void skip_h264_scaling_list(BitReader &bits, int size)
+{
+    int last_scale = 8;
+    int next_scale = 8;
+    for (int i = 0; i < size && bits.ok(); i++)
+    {
+        if (next_scale != 0)
+        {
+            next_scale = (last_scale + bits.readSe() + 256) % 256;
+        }
+        last_scale = next_scale == 0 ? last_scale : next_scale;
+    }
+}
+
+// Cropped picture size of an H.264 SPS, nal starts at the NAL header
+bool parse_h264_sps_size(const uint8_t *nal, size_t size, int &width, int &height)
+{
+    if (size < 5)
+    {
+        return false;
+    }
+    BitReader bits(nal + 1, size - 1);
+    const unsigned profile_idc = bits.readBits(8);
+    bits.readBits(16);      // constraint flags, level_idc
+    bits.readUe();          // seq_parameter_set_id
+
+    unsigned chroma_format_idc = 1;
+    bool separate_colour_plane = false;
+    switch (profile_idc)
+    {
+    case 100: case 110: case 122: case 244: case 44: case 83:
+    case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+        chroma_format_idc = bits.readUe();
+        if (chroma_format_idc == 3)
+        {
+            separate_colour_plane = bits.readBit() != 0;
+        }
+        bits.readUe();      // bit_depth_luma_minus8
+        bits.readUe();      // bit_depth_chroma_minus8
+        bits.readBit();     // qpprime_y_zero_transform_bypass_flag
+        if (bits.readBit()) // seq_scaling_matrix_present_flag
+        {
+            for (int i = 0; i < (chroma_format_idc != 3 ? 8 : 12); i++)
+            {
+                if (bits.readBit())
+                {
+                    skip_h264_scaling_list(bits, i < 6 ? 16 : 64);
+                }
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    bits.readUe();          // log2_max_frame_num_minus4
+    const unsigned pic_order_cnt_type = bits.readUe();
+    if (pic_order_cnt_type == 0)
+    {
+        bits.readUe();      // log2_max_pic_order_cnt_lsb_minus4
+    }
+    else if (pic_order_cnt_type == 1)
+    {
+        bits.readBit();     // delta_pic_order_always_zero_flag
+        bits.readSe();      // offset_for_non_ref_pic
+        bits.readSe();      // offset_for_top_to_bottom_field
+        const unsigned cycle = bits.readUe();
+        for (unsigned i = 0; i < cycle && bits.ok(); i++)
+        {
+            bits.readSe();
+        }
+    }
+    bits.readUe();          // max_num_ref_frames
+    bits.readBit();         // gaps_in_frame_num_value_allowed_flag
+    const unsigned width_mbs = bits.readUe() + 1;
+    const unsigned height_map_units = bits.readUe() + 1;
+    const unsigned frame_mbs_only = bits.readBit();
+    if (!frame_mbs_only)
+    {
+        bits.readBit();     // mb_adaptive_frame_field_flag
+    }
+    bits.readBit();         // direct_8x8_inference_flag
+
+    unsigned crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (bits.readBit())     // frame_cropping_flag
+    {
+        crop_left = bits.readUe();
+        crop_right = bits.readUe();
+        crop_top = bits.readUe();
+        crop_bottom = bits.readUe();
+    }
+    if (!bits.ok())
+    {
+        return false;
+    }
+
+    // ChromaArrayType 0 crops in luma samples
+    const bool chroma = !separate_colour_plane && chroma_format_idc != 0;
+    const unsigned crop_unit_x = chroma && chroma_format_idc != 3 ? 2 : 1;
+    const unsigned crop_unit_y = (chroma && chroma_format_idc == 1 ? 2 : 1) * (2 - frame_mbs_only);
+    width = (int) (width_mbs * 16) - (int) (crop_unit_x * (crop_left + crop_right));
+    height = (int) (height_map_units * 16 * (2 - frame_mbs_only)) - (int) (crop_unit_y * (crop_top + crop_bottom));
+    return width > 0 && height > 0;
+}
+
+// Cropped picture size of an H.265 SPS, nal starts at the NAL header
+bool parse_h265_sps_size(const uint8_t *nal, size_t size, int &width, int &height)
+{
+    if (size < 16)
+    {
+        return false;
+    }
+    BitReader bits(nal + 2, size - 2);
+    bits.readBits(4);       // sps_video_parameter_set_id
+    const unsigned max_sub_layers_minus1 = bits.readBits(3);
+    bits.readBit();         // sps_temporal_id_nesting_flag
+
+    // profile_tier_level
+    bits.skipBits(96);      // general profile, tier and level
+    bool sub_layer_profile[8] = {};
+    bool sub_layer_level[8] = {};
+    for (unsigned i = 0; i < max_sub_layers_minus1; i++)
+    {
+        sub_layer_profile[i] = bits.readBit() != 0;
+        sub_layer_level[i] = bits.readBit() != 0;
+    }
+    if (max_sub_layers_minus1 > 0)
+    {
+        bits.skipBits(2 * (8 - max_sub_layers_minus1));
+    }
+    for (unsigned i = 0; i < max_sub_layers_minus1; i++)
+    {
+        bits.skipBits((sub_layer_profile[i] ? 88 : 0) + (sub_layer_level[i] ? 8 : 0));
+    }
+
+    bits.readUe();          // sps_seq_parameter_set_id
+    const unsigned chroma_format_idc = bits.readUe();
+    bool separate_colour_plane = false;
+    if (chroma_format_idc == 3)
+    {
+        separate_colour_plane = bits.readBit() != 0;
+    }
+    const unsigned pic_width = bits.readUe();
+    const unsigned pic_height = bits.readUe();
+
+    unsigned crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (bits.readBit())     // conformance_window_flag
+    {
+        crop_left = bits.readUe();
+        crop_right = bits.readUe();
+        crop_top = bits.readUe();
+        crop_bottom = bits.readUe();
+    }
+    if (!bits.ok())
+    {
+        return false;
+    }
+
+    const bool chroma = !separate_colour_plane && chroma_format_idc != 0;
+    const unsigned sub_width = chroma && chroma_format_idc != 3 ? 2 : 1;
+    const unsigned sub_height = chroma && chroma_format_idc == 1 ? 2 : 1;
+    width = (int) pic_width - (int) (sub_width * (crop_left + crop_right));
+    height = (int) pic_height - (int) (sub_height * (crop_top + crop_bottom));
+    return width > 0 && height > 0;
+}
+
+// I < P < B, an access unit takes the highest of its slices
+VideoFrameType combine_frame_type(VideoFrameType current, VideoFrameType slice)
+{
+    if (current == VideoFrameType::UNKNOWN) return slice;
+    if (slice == VideoFrameType::B || current == VideoFrameType::B) return VideoFrameType::B;
+    if (slice == VideoFrameType::P || current == VideoFrameType::P) return VideoFrameType::P;
+    return current;
+}
+
+} // namespace
+
+
+size_t find_start_code(const uint8_t *data, size_t size, size_t pos, size_t &start_code_size)
+{
+    size_t i = pos;
+
+#if defined(DEPTHAI_NAL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    for (; i + 18 <= size; i += 16)
+    {
+        const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 2));
+        const __m128i match = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(v0, zero), _mm_cmpeq_epi8(v1, zero)),
+            _mm_cmpeq_epi8(v2, one));
+        const int mask = _mm_movemask_epi8(match);
+        if (mask != 0)
+        {
+            int bit = 0;
+            while (((mask >> bit) & 1) == 0)
+            {
+                bit++;
+            }
+            i += bit;
+            break;
+        }
+    }
+#elif defined(DEPTHAI_NAL_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+    for (; i + 18 <= size; i += 16)
+    {
+        const uint8x16_t match = vandq_u8(
+            vandq_u8(vceqq_u8(vld1q_u8(data + i), zero), vceqq_u8(vld1q_u8(data + i + 1), zero)),
+            vceqq_u8(vld1q_u8(data + i + 2), one));
+        const uint64x2_t lanes = vreinterpretq_u64_u8(match);
+        if ((vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1)) != 0)
+        {
+            // exact position found by the scalar loop below
+            break;
+        }
+    }
+#endif
+
+    for (; i + 3 <= size; i++)
+    {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+        {
+            if (i > pos && data[i - 1] == 0)
+            {
+                start_code_size = 4;
+                return i - 1;
+            }
+            start_code_size = 3;
+            return i;
+        }
+    }
+
+    start_code_size = 0;
+    return size;
+}
+
+
+NalParser::NalParser(VideoCodec codec, size_t keyframe_index_capacity)
+    : _codec(codec)
+    , _keyframe_index_capacity(std::max<size_t>(1, keyframe_index_capacity))
+{}
+
+bool NalParser::getCodecFromProfile(const std::string &profile, VideoCodec &codec)
+{
+    if (profile.compare(0, 4, "h264") == 0)
+    {
+        codec = VideoCodec::H264;
+        return true;
+    }
+    if (profile.compare(0, 4, "h265") == 0)
+    {
+        codec = VideoCodec::H265;
+        return true;
+    }
+    return false;
+}
+
+void NalParser::parse(HostDataPacket &packet)
+{
+    std::shared_ptr<VideoFrameInfo> info = std::make_shared<VideoFrameInfo>();
+    info->codec = _codec;
+    info->sequence = _sequence++;
+    info->stream_offset = _stream_offset;
+    _stream_offset += packet.size();
+
+    const uint8_t *data = packet.getData();
+    const size_t size = packet.size();
+
+    size_t start_code_size = 0;
+    size_t start = find_start_code(data, size, 0, start_code_size);
+    while (start < size)
+    {
+        const size_t nal_begin = start + start_code_size;
+        size_t next_code_size = 0;
+        const size_t next = find_start_code(data, size, nal_begin, next_code_size);
+
+        // trailing_zero_8bits are not part of the NAL unit
+        size_t nal_end = next;
+        while (nal_end > nal_begin && data[nal_end - 1] == 0)
+        {
+            nal_end--;
+        }
+
+        if (nal_end > nal_begin)
+        {
+            parseNalUnit(data, nal_begin, nal_end - nal_begin, *info);
+        }
+
+        start = next;
+        start_code_size = next_code_size;
+    }
+
+    if (info->nal_units.empty())
+    {
+        Logger::instance().count(LogLevel::warn, "received %u %s packets without NAL units", packet.stream_name.c_str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_pending_sets)
+        {
+            _parameter_sets = std::move(_pending_sets);
+            _pending_sets = nullptr;
+        }
+        info->parameter_sets = _parameter_sets;
+
+        if (info->keyframe)
+        {
+            KeyframeIndexEntry entry;
+            entry.sequence = info->sequence;
+            entry.stream_offset = info->stream_offset;
+            entry.timestamp = packet.opt_metadata ? packet.opt_metadata->getTimestamp() : -1.0;
+
+            _keyframe_index.push_back(entry);
+            if (_keyframe_index.size() > _keyframe_index_capacity)
+            {
+                _keyframe_index.pop_front();
+            }
+        }
+    }
+
+    packet.video_info = info;
+}
+
+void NalParser::parseNalUnit(const uint8_t *data, size_t offset, size_t size, VideoFrameInfo &info)
+{
+    const uint8_t *nal = data + offset;
+
+    NalUnit unit;
+    unit.offset = (uint32_t) offset;
+    unit.size = (uint32_t) size;
+
+    // member of VideoParameterSets this NAL unit replaces
+    std::vector<uint8_t> VideoParameterSets::*parameter_set = nullptr;
+    bool slice = false;
+
+    if (_codec == VideoCodec::H264)
+    {
+        unit.type = nal[0] & 0x1f;
+        switch (unit.type)
+        {
+        case H264_SPS: parameter_set = &VideoParameterSets::sps; break;
+        case H264_PPS: parameter_set = &VideoParameterSets::pps; break;
+        case H264_SLICE_IDR: info.keyframe = true; slice = true; break;
+        case H264_SLICE: slice = true; break;
+        default: break;
+        }
+    }
+    else
+    {
+        unit.type = (nal[0] >> 1) & 0x3f;
+        switch (unit.type)
+        {
+        case H265_VPS: parameter_set = &VideoParameterSets::vps; break;
+        case H265_SPS: parameter_set = &VideoParameterSets::sps; break;
+        case H265_PPS:
+        {
+            parameter_set = &VideoParameterSets::pps;
+            if (size > 2)
+            {
+                BitReader bits(nal + 2, size - 2);
+                const unsigned pps_id = bits.readUe();
+                bits.readUe();      // pps_seq_parameter_set_id
+                bits.readBits(2);   // dependent_slice_segments_enabled_flag, output_flag_present_flag
+                const unsigned extra_bits = bits.readBits(3);
+                if (bits.ok() && pps_id < 64)
+                {
+                    _pps_extra_slice_header_bits[pps_id] = (uint8_t) extra_bits;
+                }
+            }
+            break;
+        }
+        default:
+            slice = unit.type < H265_VPS;
+            if (unit.type >= H265_IRAP_FIRST && unit.type <= H265_IRAP_LAST)
+            {
+                info.keyframe = true;
+            }
+            break;
+        }
+    }
+
+    if (parameter_set != nullptr)
+    {
+        info.has_parameter_sets = true;
+
+        // only copied when the stream changes its parameter sets
+        const VideoParameterSets *current = _pending_sets ? _pending_sets.get() : _parameter_sets.get();
+        if (current == nullptr || !same_annexb(current->*parameter_set, nal, size))
+        {
+            if (!_pending_sets)
+            {
+                _pending_sets = current ? std::make_shared<VideoParameterSets>(*current)
+                                        : std::make_shared<VideoParameterSets>();
+            }
+            set_annexb((*_pending_sets).*parameter_set, nal, size);
+
+            if (parameter_set == &VideoParameterSets::sps)
+            {
+                int width = 0;
+                int height = 0;
+                const bool parsed = _codec == VideoCodec::H264
+                    ? parse_h264_sps_size(nal, size, width, height)
+                    : parse_h265_sps_size(nal, size, width, height);
+                _pending_sets->width = parsed ? width : 0;
+                _pending_sets->height = parsed ? height : 0;
+            }
+        }
+    }
+
+    if (slice)
+    {
+        const VideoFrameType slice_type = parseSliceType(nal, size, unit.type);
+        if (slice_type != VideoFrameType::UNKNOWN)
+        {
+            info.frame_type = combine_frame_type(info.frame_type, slice_type);
+        }
+    }
+
+    info.nal_units.push_back(unit);
+}
+
+VideoFrameType NalParser::parseSliceType(const uint8_t *nal, size_t size, uint8_t type)
+{
+    if (_codec == VideoCodec::H264)
+    {
+        if (size < 2)
+        {
+            return VideoFrameType::UNKNOWN;
+        }
+        BitReader bits(nal + 1, size - 1);
+        bits.readUe();      // first_mb_in_slice
+        const unsigned slice_type = bits.readUe();
+        if (!bits.ok())
+        {
+            return VideoFrameType::UNKNOWN;
+        }
+        switch (slice_type % 5)
+        {
+        case 0: case 3: return VideoFrameType::P;   // P, SP
+        case 1:         return VideoFrameType::B;
+        default:        return VideoFrameType::I;   // I, SI
+        }
+    }
+
+    if (size < 3)
+    {
+        return VideoFrameType::UNKNOWN;
+    }
+    BitReader bits(nal + 2, size - 2);
+    const unsigned first_slice_segment = bits.readBit();
+    if (!first_slice_segment)
+    {
+        // slice_segment_address needs the SPS picture size, the first
+        // segment of the picture already gave the type
+        return VideoFrameType::UNKNOWN;
+    }
+    if (type >= H265_IRAP_FIRST && type <= H265_IRAP_LAST)
+    {
+        bits.readBit();     // no_output_of_prior_pics_flag
+    }
+    const unsigned pps_id = bits.readUe();
+    if (pps_id >= 64)
+    {
+        return VideoFrameType::UNKNOWN;
+    }
+    bits.readBits(_pps_extra_slice_header_bits[pps_id]);
+    const unsigned slice_type = bits.readUe();
+    if (!bits.ok())
+    {
+        return VideoFrameType::UNKNOWN;
+    }
+    switch (slice_type)
+    {
+    case 0:  return VideoFrameType::B;
+    case 1:  return VideoFrameType::P;
+    case 2:  return VideoFrameType::I;
+    default: return VideoFrameType::UNKNOWN;
+    }
+}
+
+std::vector<KeyframeIndexEntry> NalParser::getKeyframeIndex() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return std::vector<KeyframeIndexEntry>(_keyframe_index.begin(), _keyframe_index.end());
+}
+
+bool NalParser::getLastKeyframe(KeyframeIndexEntry &entry) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_keyframe_index.empty())
+    {
+        return false;
+    }
+    entry = _keyframe_index.back();
+    return true;
+}
+
+std::shared_ptr<const VideoParameterSets> NalParser::getParameterSets() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _parameter_sets;
+}
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "parallel_for.hpp"
+
+
+static constexpr int c_ranges_per_thread = 4;   // more ranges than threads to balance uneven rows
+
+
+namespace
+{
+
+struct Job
+{
+    const std::function<void(int, int)> *body;
+    const ParallelForCancel *cancel;
+    int pending;                    // ranges not finished, guarded by mutex
+    bool skipped = false;           // a range was skipped by cancel
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
+struct Task
+{
+    Job *job;
+    int begin;
+    int end;
+};
+
+// Workers run the tasks of their own deque from the back and steal from the
+// front of the others when it is empty.
+class WorkStealingPool
+{
+public:
+    WorkStealingPool(int worker_count, bool inline_when_saturated);
+    ~WorkStealingPool();
+
+    int getWorkerCount() const { return (int) _workers.size(); }
+    // all workers run tasks and inline_when_saturated is set
+    bool runInline() const { return _inline_when_saturated && _busy.load(std::memory_order_relaxed) >= (int) _workers.size(); }
+
+    void submit(const std::vector<Task> &tasks);
+    bool steal(Task &task, int first_worker);
+    static void run(const Task &task);
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void workerThread(int index);
+    bool pop(int index, Task &task);
+
+    const bool _inline_when_saturated;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<int> _queued{0};
+    std::atomic<int> _busy{0};
+    std::atomic<int> _next_worker{0};
+
+    std::mutex _sleep_mutex;
+    std::condition_variable _wake;
+    bool _stop = false;
+};
+
+thread_local bool t_pool_worker = false;
+
+WorkStealingPool::WorkStealingPool(int worker_count, bool inline_when_saturated)
+    : _inline_when_saturated(inline_when_saturated)
+{
+    for (int i = 0; i < worker_count; i++)
+    {
+        _workers.emplace_back(new Worker());
+    }
+    for (int i = 0; i < worker_count; i++)
+    {
+        _workers[i]->thread = std::thread(&WorkStealingPool::workerThread, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto &worker : _workers)
+    {
+        worker->thread.join();
+    }
+}
+
+void WorkStealingPool::submit(const std::vector<Task> &tasks)
+{
+    const int first = _next_worker.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        Worker &worker = *_workers[(first + i) % _workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(tasks[i]);
+    }
+    _queued.fetch_add((int) tasks.size(), std::memory_order_release);
+
+    // sleeping workers check _queued under the lock
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+    }
+    _wake.notify_all();
+}
+
+bool WorkStealingPool::pop(int index, Task &task)
+{
+    Worker &worker = *_workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+    {
+        return false;
+    }
+    task = worker.tasks.back();
+    worker.tasks.pop_back();
+    _queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool WorkStealingPool::steal(Task &task, int first_worker)
+{
+    const int count = (int) _workers.size();
+    for (int i = 0; i < count; i++)
+    {
+        Worker &worker = *_workers[(first_worker + i) % count];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            task = worker.tasks.front();
+            worker.tasks.pop_front();
+            _queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(const Task &task)
+{
+    Job &job = *task.job;
+    const bool cancelled = job.cancel != nullptr && job.cancel->isCancelled();
+    if (!cancelled)
+    {
+        (*job.body)(task.begin, task.end);
+    }
+
+    // the caller returns once pending is 0, job is not used after the unlock
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.skipped = job.skipped || cancelled;
+    if (--job.pending == 0)
+    {
+        job.done.notify_all();
+    }
+}
+
+void WorkStealingPool::workerThread(int index)
+{
+    t_pool_worker = true;
+
+    while (true)
+    {
+        Task task;
+        if (pop(index, task) || steal(task, index + 1))
+        {
+            _busy.fetch_add(1, std::memory_order_relaxed);
+            run(task);
+            _busy.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleep_mutex);
+        _wake.wait(lock, [this] { return _stop || _queued.load(std::memory_order_acquire) > 0; });
+        if (_stop && _queued.load(std::memory_order_acquire) == 0)
+        {
+            break;
+        }
+    }
+}
+
+
+std::mutex g_pool_mutex;
+ParallelForConfig g_config;
+std::shared_ptr<WorkStealingPool> g_pool;
+
+std::shared_ptr<WorkStealingPool> get_pool()
+{
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    if (g_pool == nullptr)
+    {
+        const int threads = g_config.threads > 0 ? g_config.threads : (int) std::max(1u, std::thread::hardware_concurrency());
+        g_pool = std::make_shared<WorkStealingPool>(threads - 1, g_config.inline_when_saturated);
+    }
+    return g_pool;
+}
+
+bool run_inline(int begin, int end, const std::function<void(int, int)> &body, const ParallelForCancel *cancel)
+{
+    if (cancel != nullptr && cancel->isCancelled())
+    {
+        return false;
+    }
+    body(begin, end);
+    return true;
+}
+
+} // namespace
+
+
+void set_parallel_for_config(const ParallelForConfig &config)
+{
+    std::shared_ptr<WorkStealingPool> old_pool;
+    {
+        std::lock_guard<std::mutex> lock(g_pool_mutex);
+        g_config = config;
+        old_pool.swap(g_pool);  // the new one is created by the next call
+    }
+    // calls in progress hold the old pool, the last one joins its workers
+}
+
+ParallelForConfig get_parallel_for_config()
+{
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    return g_config;
+}
+
+bool parallel_for(
+    int begin,
+    int end,
+    const std::function<void(int range_begin, int range_end)> &body,
+    int min_range,
+    const ParallelForCancel *cancel
+)
+{
+    const int count = end - begin;
+    if (count <= 0)
+    {
+        return true;
+    }
+
+    min_range = std::max(1, min_range);
+    if (t_pool_worker || count < 2 * min_range)
+    {
+        return run_inline(begin, end, body, cancel);
+    }
+
+    const std::shared_ptr<WorkStealingPool> pool = get_pool();
+    const int threads = pool->getWorkerCount() + 1;
+    if (threads == 1 || pool->runInline())
+    {
+        return run_inline(begin, end, body, cancel);
+    }
+
+    const int range_count = std::min(count / min_range, threads * c_ranges_per_thread);
+    const int range = (count + range_count - 1) / range_count;
+
+    Job job;
+    job.body = &body;
+    job.cancel = cancel;
+
+    // calling thread takes the first range
+    std::vector<Task> tasks;
+    for (int range_begin = begin + range; range_begin < end; range_begin += range)
+    {
+        tasks.push_back({&job, range_begin, std::min(end, range_begin + range)});
+    }
+    job.pending = (int) tasks.size() + 1;
+    pool->submit(tasks);
+    WorkStealingPool::run({&job, begin, std::min(end, begin + range)});
+
+    // help with the queued ranges, of this or other calls, until done
+    Task task;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (job.pending == 0)
+            {
+                break;
+            }
+        }
+        if (pool->steal(task, 0))
+        {
+            WorkStealingPool::run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.done.wait(lock, [&job] { return job.pending == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(job.mutex);
+    return !job.skipped;
+}
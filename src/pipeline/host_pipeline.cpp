@@ -1,15 +1,65 @@
-#include <iostream>
 #include <memory>
 #include <mutex>
 
 #include "pipeline/host_pipeline.hpp"
+#include "logger.hpp"
+#include "thread_settings.hpp"
 
 #include "depthai-shared/timer.hpp"
 
 
+// listeners running on this thread, removePacketListener() can't wait for them
+static thread_local int t_listener_depth = 0;
+
+
+// Empty packet with the buffers of a stream reserved, refilling it does not allocate
+static HostDataPacket* new_pool_packet(const std::string &stream_name, size_t max_size)
+{
+    HostDataPacket *packet = new HostDataPacket();
+    packet->stream_name.reserve(stream_name.size());
+    packet->dimensions.reserve(4);
+    packet->data = std::allocate_shared<FrameBuffer>(FrameAllocator<FrameBuffer>());
+    packet->data->reserve(max_size);
+    return packet;
+}
+
+
+HostPipeline::PacketPool::~PacketPool()
+{
+    for (HostDataPacket *packet : free)
+    {
+        delete packet;
+    }
+}
+
+void HostPipeline::PacketRecycler::operator()(HostDataPacket *packet) const
+{
+    // the application buffer is released with the packet, not with its reuse
+    packet->external_data = nullptr;
+    packet->video_info = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (pool->free.size() < pool->free.capacity())
+        {
+            pool->free.push_back(packet);
+            return;
+        }
+    }
+    delete packet;
+}
+
+
 HostPipeline::HostPipeline()
     : _data_queue_lf(c_data_queue_size)
-{}
+{
+    _consume_buffer.reserve(c_data_queue_size);
+}
+
+HostPipeline::~HostPipeline()
+{
+    FrameBudget::instance().releaseQueue(*this);
+}
 
 void HostPipeline::onNewData(
     const StreamInfo& info,
@@ -17,13 +67,14 @@ void HostPipeline::onNewData(
 )
 {
     Timer t;
+    apply_thread_settings(ThreadClass::STREAM_READER, info.name);
 
     // std::cout << "--- new data from " << info.name << " , size: " << data.size << "\n";
     bool keep_frame = _public_stream_names.empty() ||
             (_public_stream_names.find(info.getName()) != _public_stream_names.end());
     if(!keep_frame)
     {
-        std::cout << "Stream " << info.name << "is not in the stream list" << ":\n";
+        Logger::instance().count(LogLevel::warn, "received %u %s frames, stream is not in the stream list", info.name.c_str());
         return;
     }
 
@@ -34,34 +85,292 @@ void HostPipeline::onNewData(
 
     if(keep_frame == false)
     {
-        std::cout << "Received frame " << info.name << " is wrong size: " << data.size << ", expected: " << info.size <<":\n";
+        Logger::instance().count(LogLevel::warn, "received %u %s frames of wrong size", info.name.c_str());
         return;
     }
 
-    std::shared_ptr<HostDataPacket> host_data(
-        new HostDataPacket(
-            data.size,
-            data.data,
-            info
-            ));
+    std::shared_ptr<HostDataPacket> host_data = makePacket(info, data);
+
+    // NalParser and the packet listeners are not part of the frame path, they may allocate
+    const auto nal_parser = _nal_parsers.find(info.name);
+    if (nal_parser != _nal_parsers.end())
+    {
+        nal_parser->second->parse(*host_data);
+    }
+
+    // copied under the lock and called without it, reused by the reader thread
+    static thread_local std::vector<std::shared_ptr<PacketListenerEntry>> listeners;
+    {
+        std::lock_guard<std::mutex> lock(_packet_listeners_mutex);
+        for (const auto &entry : _packet_listeners)
+        {
+            if (entry.second->stream_name.empty() || entry.second->stream_name == info.name)
+            {
+                entry.second->calls++;
+                listeners.push_back(entry.second);
+            }
+        }
+    }
+    for (const std::shared_ptr<PacketListenerEntry> &entry : listeners)
+    {
+        if (!entry->removed.load())
+        {
+            t_listener_depth++;
+            entry->listener(host_data);
+            t_listener_depth--;
+        }
+
+        std::lock_guard<std::mutex> lock(_packet_listeners_mutex);
+        if (--entry->calls == 0 && entry->removed.load())
+        {
+            _packet_listeners_cv.notify_all();
+        }
+    }
+    listeners.clear();
 
-    if (!_data_queue_lf.push(host_data))
+    FramePathScope frame_path;
     {
-        std::shared_ptr<HostDataPacket> tmp;
-        _data_queue_lf.tryPop(tmp);
+        std::lock_guard<std::mutex> lock(_cursors_mutex);
+        for (const auto &cursor : _cursors)
+        {
+            if (cursor.second->accepts(info.name))
+            {
+                cursor.second->push(host_data);
+            }
+        }
+    }
+
+    // the byte budget is checked first, then the packet count
+    struct
+    {
+        HostPipeline *pipeline;
+        const std::shared_ptr<HostDataPacket> *packet;
+        std::shared_ptr<HostDataPacket> dropped;
+    } push = {this, &host_data, nullptr};
+
+    // one captured pointer, std::function stores it without allocating
+    const bool queued = FrameBudget::instance().admit(*this, host_data, [&push]
+    {
+        LockingQueue<std::shared_ptr<HostDataPacket>> &queue = push.pipeline->_data_queue_lf;
+        if (queue.push(*push.packet))
+        {
+            return true;
+        }
+
+        if (queue.tryPop(push.dropped) && push.dropped)
+        {
+            Logger::instance().count(LogLevel::warn, "dropped %u %s frames", push.dropped->stream_name.c_str());
+        }
 
-        if (!_data_queue_lf.push(host_data))
+        if (!queue.push(*push.packet))
         {
-            std::cerr << "Data queue is full " << info.name << ":\n";
+            Logger::instance().count(LogLevel::warn, "dropped %u %s frames", (*push.packet)->stream_name.c_str());
+            return false;
         }
+        return true;
+    });
+    if (push.dropped)
+    {
+        FrameBudget::instance().release(push.dropped.get());
+    }
+    if (queued)
+    {
+        _ready_fd.notify();
     }
 
     // std::cout << "===> onNewData " << t.ellapsed_us() << " us\n";
 }
 
+std::shared_ptr<HostDataPacket> HostPipeline::makePacket(const StreamInfo& info, const StreamData& data)
+{
+    std::shared_ptr<PacketPool> pool;
+    if (_realtime_packets_per_stream != 0)
+    {
+        std::lock_guard<std::mutex> lock(_packet_pools_mutex);
+        const auto it = _packet_pools.find(info.name);
+        if (it != _packet_pools.end())
+        {
+            pool = it->second;
+        }
+    }
+
+    // the frame is copied without the lock, reader threads of other streams don't wait
+    std::shared_ptr<const FrameBufferProvider> stream_provider;
+    if (_has_buffer_providers.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(_buffer_providers_mutex);
+        const auto it = _buffer_providers.find(info.name);
+        if (it != _buffer_providers.end())
+        {
+            stream_provider = it->second;
+        }
+    }
+    static const FrameBufferProvider c_no_provider;
+    const FrameBufferProvider &provider = stream_provider ? *stream_provider : c_no_provider;
+
+    FramePathScope frame_path;
+    if (pool == nullptr)
+    {
+        return std::make_shared<HostDataPacket>(data.size, data.data, info, provider);
+    }
+
+    HostDataPacket *packet = nullptr;
+    {
+        std::lock_guard<std::mutex> pool_lock(pool->mutex);
+        if (!pool->free.empty())
+        {
+            packet = pool->free.back();
+            pool->free.pop_back();
+        }
+    }
+    if (packet == nullptr)
+    {
+        // reported once like a frame pool miss, the warning and the packet allocate outside the scope
+        check_frame_path_allocation(sizeof(HostDataPacket));
+        FramePathExit exit_frame_path;
+        Logger::instance().count(LogLevel::warn, "realtime pool empty for %u %s frames, packets are held too long", info.name.c_str());
+        packet = new_pool_packet(info.name, data.size);
+    }
+    std::shared_ptr<HostDataPacket> host_data(packet, PacketRecycler{pool}, FrameAllocator<HostDataPacket>());
+
+    // dimensions of the last frame size, getDimensionsForSize() returns a new vector
+    int frame_size = (int) data.size;
+    FrameMetadata metadata;
+    memcpy(&metadata, static_cast<const uint8_t*>(data.data) + data.size - sizeof(FrameMetadata), sizeof(FrameMetadata));
+    if (metadata.isValid())
+    {
+        frame_size = metadata.frameSize;
+    }
+    if (frame_size != pool->frame_size)
+    {
+        StreamInfo stream_info = info;
+        pool->dims = stream_info.getDimensionsForSize(frame_size);
+        pool->frame_size = frame_size;
+    }
+
+    packet->assign(data.size, data.data, info, provider, &pool->dims);
+    return host_data;
+}
+
+void HostPipeline::enableRealtime(size_t packets_per_stream)
+{
+    std::lock_guard<std::mutex> lock(_packet_pools_mutex);
+    _realtime_packets_per_stream = packets_per_stream;
+}
+
+void HostPipeline::setBufferProvider(const std::string& stream_name, FrameBufferProvider provider)
+{
+    std::lock_guard<std::mutex> lock(_buffer_providers_mutex);
+    if (provider)
+    {
+        _buffer_providers[stream_name] = std::make_shared<const FrameBufferProvider>(std::move(provider));
+    }
+    else
+    {
+        _buffer_providers.erase(stream_name);
+    }
+    _has_buffer_providers.store(!_buffer_providers.empty(), std::memory_order_relaxed);
+}
+
+int HostPipeline::addPacketListener(const std::string& stream_name, PacketListener listener)
+{
+    std::shared_ptr<PacketListenerEntry> entry = std::make_shared<PacketListenerEntry>();
+    entry->stream_name = stream_name;
+    entry->listener = std::move(listener);
+
+    std::lock_guard<std::mutex> lock(_packet_listeners_mutex);
+    const int id = _next_packet_listener_id++;
+    _packet_listeners[id] = entry;
+    return id;
+}
+
+void HostPipeline::removePacketListener(int id)
+{
+    std::unique_lock<std::mutex> lock(_packet_listeners_mutex);
+    const auto it = _packet_listeners.find(id);
+    if (it == _packet_listeners.end())
+    {
+        return;
+    }
+    const std::shared_ptr<PacketListenerEntry> entry = it->second;
+    _packet_listeners.erase(it);
+    entry->removed.store(true);
+
+    // a listener waiting for itself, or for one running below it, would never return
+    if (t_listener_depth == 0)
+    {
+        _packet_listeners_cv.wait(lock, [&entry] { return entry->calls == 0; });
+    }
+}
+
+std::shared_ptr<PacketCursor> HostPipeline::addCursor(const std::string& name, CursorPolicy policy,
+                                                     size_t capacity, const std::string& stream_name)
+{
+    std::shared_ptr<PacketCursor> cursor = std::make_shared<PacketCursor>(name, policy, capacity, stream_name);
+
+    std::lock_guard<std::mutex> lock(_cursors_mutex);
+    auto &entry = _cursors[name];
+    if (entry)
+    {
+        entry->close();
+    }
+    entry = cursor;
+    return cursor;
+}
+
+std::shared_ptr<PacketCursor> HostPipeline::getCursor(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_cursors_mutex);
+    const auto it = _cursors.find(name);
+    return it != _cursors.end() ? it->second : nullptr;
+}
+
+void HostPipeline::removeCursor(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_cursors_mutex);
+    const auto it = _cursors.find(name);
+    if (it != _cursors.end())
+    {
+        it->second->close();
+        _cursors.erase(it);
+    }
+}
+
 void HostPipeline::onNewDataSubject(const StreamInfo &info)
 {
     _observing_stream_names.insert(info.name);
+
+    std::lock_guard<std::mutex> lock(_packet_pools_mutex);
+    if (_realtime_packets_per_stream == 0 || _packet_pools.count(info.name) != 0)
+    {
+        return;
+    }
+
+    // info.size is the largest packet, 0 if unknown: the buffers grow with the first frames
+    std::shared_ptr<PacketPool> pool = std::make_shared<PacketPool>();
+    pool->free.reserve(_realtime_packets_per_stream);
+    for (size_t i = 0; i < _realtime_packets_per_stream; i++)
+    {
+        pool->free.push_back(new_pool_packet(info.name, info.size));
+    }
+    _packet_pools[info.name] = pool;
+}
+
+bool HostPipeline::evictQueued(const HostDataPacket *packet)
+{
+    return _data_queue_lf.eraseFirst([packet](const std::shared_ptr<HostDataPacket> &queued)
+    {
+        return queued.get() == packet;
+    });
+}
+
+void HostPipeline::releaseConsumed(const std::list<std::shared_ptr<HostDataPacket>> &packets)
+{
+    FrameBudget &budget = FrameBudget::instance();
+    for (const auto &packet : packets)
+    {
+        budget.release(packet.get());
+    }
 }
 
 std::list<std::shared_ptr<HostDataPacket>> HostPipeline::getAvailableDataPackets(bool blocking)
@@ -73,12 +382,14 @@ std::list<std::shared_ptr<HostDataPacket>> HostPipeline::getAvailableDataPackets
         result.push_back(data);
     };
 
+    _ready_fd.clear();
     if(blocking){
         _data_queue_lf.waitAndConsumeAll(functor);
     } else {
         _data_queue_lf.consumeAll(functor);
     }
 
+    releaseConsumed(result);
     return result;
 }
 
@@ -93,11 +404,13 @@ void HostPipeline::consumePackets(bool blocking)
         this->_consumed_packets.push_back(data);
     };
 
+    _ready_fd.clear();
     if(blocking){
         _data_queue_lf.waitAndConsumeAll(functor);
     } else {
         _data_queue_lf.consumeAll(functor);
     }
+    releaseConsumed(_consumed_packets);
 
     if (!this->_consumed_packets.empty())
     {
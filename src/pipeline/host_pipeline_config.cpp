@@ -58,6 +58,11 @@ bool HostPipelineConfig::initWithJSON(const nlohmann::json &json_obj)
                     {
                         stream.max_fps   = it.at("max_fps").get<float>();
                     }
+
+                    if (it.contains("downscale"))
+                    {
+                        stream.downscale = it.at("downscale").get<bool>();
+                    }
                 }
             }
         }
@@ -403,6 +408,94 @@ bool HostPipelineConfig::initWithJSON(const nlohmann::json &json_obj)
             {
                 app_config.usb_chunk_KiB = app_conf_obj.at("usb_chunk_KiB").get<uint32_t>();
             }
+
+            if (app_conf_obj.contains("async_post_processing"))
+            {
+                app_config.async_post_processing = app_conf_obj.at("async_post_processing").get<bool>();
+            }
+
+            if (app_conf_obj.contains("async_inbox_size"))
+            {
+                app_config.async_inbox_size = app_conf_obj.at("async_inbox_size").get<uint32_t>();
+            }
+
+            if (app_conf_obj.contains("parallel_for_threads"))
+            {
+                app_config.parallel_for_threads = app_conf_obj.at("parallel_for_threads").get<int>();
+            }
+
+            if (app_conf_obj.contains("frame_budget_MiB"))
+            {
+                app_config.frame_budget_MiB = app_conf_obj.at("frame_budget_MiB").get<uint32_t>();
+            }
+
+            if (app_conf_obj.contains("stream_priorities"))
+            {
+                app_config.stream_priorities = app_conf_obj.at("stream_priorities").get<std::map<std::string, int>>();
+            }
+
+            if (app_conf_obj.contains("realtime_packets_per_stream"))
+            {
+                app_config.realtime_packets_per_stream = app_conf_obj.at("realtime_packets_per_stream").get<uint32_t>();
+            }
+
+            if (app_conf_obj.contains("frame_huge_pages"))
+            {
+                const std::string huge_pages = app_conf_obj.at("frame_huge_pages").get<std::string>();
+                if (huge_pages == "off")
+                {
+                    app_config.frame_huge_pages = FrameHugePages::OFF;
+                }
+                else if (huge_pages == "transparent")
+                {
+                    app_config.frame_huge_pages = FrameHugePages::TRANSPARENT;
+                }
+                else if (huge_pages == "explicit")
+                {
+                    app_config.frame_huge_pages = FrameHugePages::EXPLICIT;
+                }
+                else
+                {
+                    std::cerr << WARNING "app.frame_huge_pages valid options: off, transparent, explicit\n" ENDC;
+                    break;
+                }
+            }
+
+            if (app_conf_obj.contains("threads"))
+            {
+                auto& threads_obj = app_conf_obj.at("threads");
+                const std::pair<const char*, ThreadSettings*> thread_classes[] = {
+                    {"watchdog",        &app_config.threads.watchdog},
+                    {"stream_reader",   &app_config.threads.stream_reader},
+                    {"post_processing", &app_config.threads.post_processing},
+                };
+                for (const auto &thread_class : thread_classes)
+                {
+                    if (!threads_obj.contains(thread_class.first))
+                    {
+                        continue;
+                    }
+                    auto& thread_obj = threads_obj.at(thread_class.first);
+                    ThreadSettings &settings = *thread_class.second;
+
+                    if (thread_obj.contains("cpus"))
+                    {
+                        settings.cpu_affinity = thread_obj.at("cpus").get<std::vector<int>>();
+                    }
+                    if (thread_obj.contains("fifo_priority"))
+                    {
+                        settings.fifo_priority = thread_obj.at("fifo_priority").get<int>();
+                    }
+                    if (thread_obj.contains("nice"))
+                    {
+                        settings.nice = thread_obj.at("nice").get<int>();
+                    }
+                    if (thread_obj.contains("name"))
+                    {
+                        settings.name = thread_obj.at("name").get<std::string>();
+                    }
+                }
+            }
         }
 
 
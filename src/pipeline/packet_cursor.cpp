@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <chrono>
+
+#include "pipeline/packet_cursor.hpp"
+#include "logger.hpp"
+
+
+PacketCursor::PacketCursor(const std::string &name, CursorPolicy policy, size_t capacity, const std::string &stream_name)
+    : _name(name)
+    , _policy(policy)
+    , _capacity(std::max<size_t>(1, capacity))
+    , _stream_name(stream_name)
+    , _dropped_packets(0)
+    , _closed(false)
+{}
+
+void PacketCursor::push(const std::shared_ptr<HostDataPacket> &packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_policy == CursorPolicy::LATEST)
+        {
+            // at most one packet per stream
+            for (auto it = _queue.begin(); it != _queue.end(); ++it)
+            {
+                if ((*it)->stream_name == packet->stream_name)
+                {
+                    _queue.erase(it);
+                    _dropped_packets++;
+                    break;
+                }
+            }
+        }
+        else if (_queue.size() >= _capacity)
+        {
+            Logger::instance().count(LogLevel::warn, "cursor dropped %u %s frames", _queue.front()->stream_name.c_str());
+            _queue.pop_front();
+            _dropped_packets++;
+        }
+        _queue.push_back(packet);
+        _ready_fd.notify();
+    }
+    _signal.notify_one();
+}
+
+void PacketCursor::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+        _queue.clear();
+        _ready_fd.notify();
+    }
+    _signal.notify_all();
+}
+
+std::list<std::shared_ptr<HostDataPacket>> PacketCursor::getAvailableDataPackets(bool blocking)
+{
+    std::list<std::shared_ptr<HostDataPacket>> result;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (blocking)
+    {
+        _signal.wait(lock, [this] { return !_queue.empty() || _closed; });
+    }
+    result.insert(result.end(), _queue.begin(), _queue.end());
+    _queue.clear();
+    if (!_closed)
+    {
+        _ready_fd.clear();
+    }
+    return result;
+}
+
+std::shared_ptr<HostDataPacket> PacketCursor::next(int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    const auto ready = [this] { return !_queue.empty() || _closed; };
+    if (timeout_ms < 0)
+    {
+        _signal.wait(lock, ready);
+    }
+    else if (!_signal.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready))
+    {
+        return nullptr;
+    }
+
+    if (_queue.empty())
+    {
+        return nullptr;
+    }
+    std::shared_ptr<HostDataPacket> packet = _queue.front();
+    _queue.pop_front();
+    if (_queue.empty())
+    {
+        _ready_fd.clear();
+    }
+    return packet;
+}
+
+int PacketCursor::getReadyFd()
+{
+    // under the lock, so notify() by push() sees it with the queue state
+    std::lock_guard<std::mutex> lock(_mutex);
+    const int fd = _ready_fd.getFd();
+    if (_queue.empty() && !_closed)
+    {
+        _ready_fd.clear();
+    }
+    return fd;
+}
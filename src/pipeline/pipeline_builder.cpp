@@ -1 +1,811 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
 #include "pipeline/pipeline_builder.hpp"
+#include "color_conversion_post_processor.hpp"
+#include "logger.hpp"
+#include "parallel_for.hpp"
+#include "thread_settings.hpp"
+
+#include "depthai-shared/cnn_info.hpp"
+#include "depthai-shared/disparity_luts.hpp"
+
+
+static constexpr int c_pixel_chunk = 256;           // pixels per fused pass, fits the stack scratch
+static constexpr int c_parallel_pixels = 64 * 1024; // per parallel_for range
+static constexpr int c_sync_restart_gap = 1000;     // older sequence numbers mean a device restart
+
+
+namespace
+{
+
+const char* node_type_name(HostNodeType type)
+{
+    switch (type)
+    {
+        case HostNodeType::SOURCE:    return "source";
+        case HostNodeType::COLORIZE:  return "colorize";
+        case HostNodeType::CONVERT:   return "convert";
+        case HostNodeType::DECODE_NN: return "decode_nn";
+        case HostNodeType::SYNC:      return "sync";
+        case HostNodeType::SINK:      return "sink";
+    }
+    return "?";
+}
+
+const char* frame_format_name(HostFrameFormat format)
+{
+    switch (format)
+    {
+        case HostFrameFormat::RAW:        return "raw";
+        case HostFrameFormat::GRAY:       return "gray";
+        case HostFrameFormat::BGR:        return "bgr";
+        case HostFrameFormat::RGB:        return "rgb";
+        case HostFrameFormat::YUV420:     return "yuv420";
+        case HostFrameFormat::DETECTIONS: return "detections";
+        case HostFrameFormat::FRAME_SET:  return "frame_set";
+        case HostFrameFormat::NONE:       return "-";
+    }
+    return "?";
+}
+
+HostFrameFormat to_frame_format(PixelFormat format)
+{
+    switch (format)
+    {
+        case PixelFormat::BGR:  return HostFrameFormat::BGR;
+        case PixelFormat::RGB:  return HostFrameFormat::RGB;
+        case PixelFormat::GRAY: return HostFrameFormat::GRAY;
+    }
+    return HostFrameFormat::RAW;
+}
+
+bool is_image(HostFrameFormat format)
+{
+    return format == HostFrameFormat::RAW || format == HostFrameFormat::GRAY ||
+           format == HostFrameFormat::BGR || format == HostFrameFormat::RGB;
+}
+
+int channels_of(HostFrameFormat format)
+{
+    return format == HostFrameFormat::GRAY ? 1 : 3;
+}
+
+
+// Per pixel operations of the fusable nodes, 8-bit interleaved
+enum class PixelOp
+{
+    COPY,
+    GRAY_TO_COLOR,
+    SWAP_RB,
+    BGR_TO_GRAY,
+    RGB_TO_GRAY,
+    COLORIZE,
+};
+
+struct PixelStep
+{
+    PixelOp op;
+    int in_channels;
+    int out_channels;
+};
+
+bool get_pixel_step(HostNodeType type, HostFrameFormat in, HostFrameFormat out, PixelStep &step)
+{
+    step.in_channels = channels_of(in);
+    step.out_channels = channels_of(out);
+
+    if (type == HostNodeType::COLORIZE)
+    {
+        step.op = PixelOp::COLORIZE;
+        return in == HostFrameFormat::GRAY;
+    }
+    if (in == out)
+    {
+        step.op = PixelOp::COPY;
+    }
+    else if (in == HostFrameFormat::GRAY)
+    {
+        step.op = PixelOp::GRAY_TO_COLOR;
+    }
+    else if (out == HostFrameFormat::GRAY)
+    {
+        step.op = in == HostFrameFormat::BGR ? PixelOp::BGR_TO_GRAY : PixelOp::RGB_TO_GRAY;
+    }
+    else
+    {
+        step.op = PixelOp::SWAP_RB;
+    }
+    return true;
+}
+
+void apply_pixel_step(const PixelStep &step, const uint8_t *src, uint8_t *dst, int count)
+{
+    switch (step.op)
+    {
+        case PixelOp::COPY:
+            memcpy(dst, src, (size_t) count * step.in_channels);
+            break;
+        case PixelOp::GRAY_TO_COLOR:
+            for (int i = 0; i < count; i++)
+            {
+                dst[3 * i] = dst[3 * i + 1] = dst[3 * i + 2] = src[i];
+            }
+            break;
+        case PixelOp::SWAP_RB:
+            for (int i = 0; i < count; i++)
+            {
+                const uint8_t b = src[3 * i];
+                dst[3 * i + 1] = src[3 * i + 1];
+                dst[3 * i] = src[3 * i + 2];
+                dst[3 * i + 2] = b;
+            }
+            break;
+        case PixelOp::BGR_TO_GRAY:
+        case PixelOp::RGB_TO_GRAY:
+        {
+            // BT.601 luma, 8-bit fixed point
+            const int b = step.op == PixelOp::BGR_TO_GRAY ? 0 : 2;
+            for (int i = 0; i < count; i++)
+            {
+                const uint8_t *p = src + 3 * i;
+                dst[i] = (uint8_t) ((29 * p[b] + 150 * p[1] + 77 * p[2 - b] + 128) >> 8);
+            }
+            break;
+        }
+        case PixelOp::COLORIZE:
+            for (int i = 0; i < count; i++)
+            {
+                memcpy(dst + 3 * i, c_disp_to_color[src[i]], 3);
+            }
+            break;
+    }
+}
+
+boost::optional<FrameMetadata> output_metadata(
+    const std::shared_ptr<HostDataPacket> &input, size_t size, int width, int height, int channels)
+{
+    boost::optional<FrameMetadata> metadata = input->opt_metadata;
+    if (metadata)
+    {
+        metadata->frameSize    = size;
+        metadata->spec.width   = width;
+        metadata->spec.height  = height;
+        metadata->spec.stride  = width * channels;
+        metadata->spec.bytesPP = channels;
+    }
+    return metadata;
+}
+
+std::vector<int> image_dimensions(int height, int width, int channels)
+{
+    std::vector<int> dimensions = {height, width};
+    if (channels > 1)
+    {
+        dimensions.push_back(channels);
+    }
+    return dimensions;
+}
+
+} // namespace
+
+
+NodeId PipelineBuilder::addNode(Node node)
+{
+    node.queue_size = _queue_size;
+    _nodes.push_back(std::move(node));
+    return (NodeId) _nodes.size() - 1;
+}
+
+NodeId PipelineBuilder::addSource(const std::string &stream_name)
+{
+    Node node;
+    node.type = HostNodeType::SOURCE;
+    node.name = stream_name;
+    node.stream_name = stream_name;
+    return addNode(node);
+}
+
+NodeId PipelineBuilder::addColorize(const std::string &name, NodeId input)
+{
+    Node node;
+    node.type = HostNodeType::COLORIZE;
+    node.name = name;
+    node.inputs = {input};
+    return addNode(node);
+}
+
+NodeId PipelineBuilder::addConvert(const std::string &name, NodeId input, PixelFormat format, bool downscale)
+{
+    Node node;
+    node.type = HostNodeType::CONVERT;
+    node.name = name;
+    node.inputs = {input};
+    node.format = format;
+    node.downscale = downscale;
+    return addNode(node);
+}
+
+NodeId PipelineBuilder::addDecodeNN(const std::string &name, NodeId input, float min_confidence)
+{
+    Node node;
+    node.type = HostNodeType::DECODE_NN;
+    node.name = name;
+    node.inputs = {input};
+    node.min_confidence = min_confidence;
+    return addNode(node);
+}
+
+NodeId PipelineBuilder::addSync(const std::string &name, const std::vector<NodeId> &inputs)
+{
+    Node node;
+    node.type = HostNodeType::SYNC;
+    node.name = name;
+    node.inputs = inputs;
+    return addNode(node);
+}
+
+NodeId PipelineBuilder::addSink(const std::string &name, NodeId input, HostFramesCallback callback)
+{
+    Node node;
+    node.type = HostNodeType::SINK;
+    node.name = name;
+    node.inputs = {input};
+    node.callback = callback;
+    return addNode(node);
+}
+
+std::unique_ptr<HostGraph> PipelineBuilder::build(int worker_count) const
+{
+    std::vector<HostFrameFormat> formats;
+    for (size_t id = 0; id < _nodes.size(); id++)
+    {
+        const Node &node = _nodes[id];
+
+        // inputs are always added before their consumers
+        std::vector<HostFrameFormat> inputs;
+        for (NodeId input : node.inputs)
+        {
+            if (input < 0 || input >= (NodeId) id)
+            {
+                log_error("host graph: node %s: invalid input %d", node.name.c_str(), input);
+                return nullptr;
+            }
+            inputs.push_back(formats[input]);
+        }
+
+        HostFrameFormat format = HostFrameFormat::NONE;
+        bool valid = true;
+        switch (node.type)
+        {
+            case HostNodeType::SOURCE:
+            {
+                YuvLayout layout;
+                format = ColorConversionPostProcessor::getYuvLayout(node.stream_name, layout) ? HostFrameFormat::YUV420 : HostFrameFormat::RAW;
+                break;
+            }
+            case HostNodeType::COLORIZE:
+                valid = inputs[0] == HostFrameFormat::RAW || inputs[0] == HostFrameFormat::GRAY;
+                format = HostFrameFormat::BGR;
+                break;
+            case HostNodeType::CONVERT:
+                valid = inputs[0] == HostFrameFormat::YUV420 || (is_image(inputs[0]) && !node.downscale);
+                format = to_frame_format(node.format);
+                break;
+            case HostNodeType::DECODE_NN:
+                valid = inputs[0] == HostFrameFormat::RAW;
+                format = HostFrameFormat::DETECTIONS;
+                break;
+            case HostNodeType::SYNC:
+                valid = inputs.size() >= 2;
+                for (HostFrameFormat input : inputs)
+                {
+                    valid = valid && input != HostFrameFormat::FRAME_SET && input != HostFrameFormat::NONE;
+                }
+                format = HostFrameFormat::FRAME_SET;
+                break;
+            case HostNodeType::SINK:
+                valid = inputs[0] != HostFrameFormat::NONE && (bool) node.callback;
+                break;
+        }
+        if (node.type != HostNodeType::SOURCE && node.type != HostNodeType::SYNC && inputs.size() != 1)
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            std::string input_formats;
+            for (HostFrameFormat input : inputs)
+            {
+                input_formats += std::string(input_formats.empty() ? "" : ", ") + frame_format_name(input);
+            }
+            log_error("host graph: node %s (%s) can't take input [%s]",
+                      node.name.c_str(), node_type_name(node.type), input_formats.c_str());
+            return nullptr;
+        }
+        formats.push_back(format);
+    }
+
+    return std::unique_ptr<HostGraph>(new HostGraph(_nodes, formats, worker_count));
+}
+
+
+HostGraph::HostGraph(const std::vector<PipelineBuilder::Node> &nodes, const std::vector<HostFrameFormat> &formats, int worker_count)
+{
+    _nodes.resize(nodes.size());
+    for (size_t id = 0; id < nodes.size(); id++)
+    {
+        _nodes[id].desc = nodes[id];
+        _nodes[id].format = formats[id];
+        for (size_t i = 0; i < nodes[id].inputs.size(); i++)
+        {
+            _nodes[nodes[id].inputs[i]].consumers.push_back(std::make_pair((NodeId) id, (int) i));
+        }
+    }
+
+    const auto is_pixel_node = [this](NodeId id)
+    {
+        const NodeState &node = _nodes[id];
+        if (node.desc.type == HostNodeType::COLORIZE)
+        {
+            return true;
+        }
+        return node.desc.type == HostNodeType::CONVERT && _nodes[node.desc.inputs[0]].format != HostFrameFormat::YUV420;
+    };
+
+    // a per pixel node joins the stage of its per pixel input when it is the only consumer
+    for (size_t id = 0; id < _nodes.size(); id++)
+    {
+        NodeState &node = _nodes[id];
+        if (node.desc.type == HostNodeType::SOURCE)
+        {
+            continue;
+        }
+
+        const NodeId input = node.desc.inputs[0];
+        if (is_pixel_node(id) && _nodes[input].stage >= 0 && is_pixel_node(input) && _nodes[input].consumers.size() == 1)
+        {
+            node.stage = _nodes[input].stage;
+            _stages[node.stage].nodes.push_back(id);
+            continue;
+        }
+
+        Stage stage;
+        stage.nodes.push_back(id);
+        stage.queue_size = std::max<size_t>(1, node.desc.queue_size);
+        node.stage = (int) _stages.size();
+        _stages.push_back(stage);
+    }
+
+    if (worker_count <= 0)
+    {
+        worker_count = std::min<int>(_stages.size(), std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < worker_count; i++)
+    {
+        _workers.emplace_back(&HostGraph::workerThread, this);
+    }
+}
+
+HostGraph::~HostGraph()
+{
+    stop();
+}
+
+void HostGraph::attach(HostPipeline &pipeline)
+{
+    detach();
+    _pipeline = &pipeline;
+    _listener_id = pipeline.addPacketListener("",
+        [this](const std::shared_ptr<HostDataPacket> &packet) { push(packet); });
+}
+
+void HostGraph::detach()
+{
+    if (_pipeline != nullptr)
+    {
+        _pipeline->removePacketListener(_listener_id);
+        _pipeline = nullptr;
+        _listener_id = -1;
+    }
+}
+
+void HostGraph::stop()
+{
+    detach();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _work_cv.notify_all();
+    _idle_cv.notify_all();
+    for (auto &worker : _workers)
+    {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void HostGraph::flush()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle_cv.wait(lock, [this] { return _stop || (_ready.empty() && _busy == 0); });
+}
+
+void HostGraph::push(const std::shared_ptr<HostDataPacket> &packet)
+{
+    for (size_t id = 0; id < _nodes.size(); id++)
+    {
+        if (_nodes[id].desc.type == HostNodeType::SOURCE && _nodes[id].desc.stream_name == packet->stream_name)
+        {
+            deliver(id, HostFrames{packet});
+        }
+    }
+}
+
+void HostGraph::deliver(NodeId node, const HostFrames &frames)
+{
+    for (const auto &consumer : _nodes[node].consumers)
+    {
+        enqueue(consumer.first, consumer.second, frames);
+    }
+}
+
+void HostGraph::enqueue(NodeId node, int input, const HostFrames &frames)
+{
+    const int stage_index = _nodes[node].stage;
+    Stage &stage = _stages[stage_index];
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stop)
+        {
+            return;
+        }
+        if (stage.queue.size() >= stage.queue_size)
+        {
+            stage.queue.pop_front();
+            stage.dropped++;
+            Logger::instance().count(LogLevel::warn, "host graph: dropped %u messages of %s, queue full", _nodes[node].desc.name.c_str());
+        }
+        Message message;
+        message.input = input;
+        message.frames = frames;
+        stage.queue.push_back(std::move(message));
+
+        if (stage.scheduled)
+        {
+            return;
+        }
+        stage.scheduled = true;
+        _ready.push_back(stage_index);
+    }
+    _work_cv.notify_one();
+}
+
+void HostGraph::workerThread()
+{
+    apply_thread_settings(ThreadClass::POST_PROCESSING, "graph");
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _work_cv.wait(lock, [this] { return _stop || !_ready.empty(); });
+        if (_stop)
+        {
+            break;
+        }
+
+        // a stage is in the ready queue at most once, its messages stay in order
+        const int stage_index = _ready.front();
+        _ready.pop_front();
+        Stage &stage = _stages[stage_index];
+        Message message = std::move(stage.queue.front());
+        stage.queue.pop_front();
+        _busy++;
+        lock.unlock();
+
+        const auto begin = std::chrono::steady_clock::now();
+        HostFrames output;
+        uint64_t dropped = 0;
+        if (runStage(stage, message, output, dropped))
+        {
+            deliver(stage.nodes.back(), output);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        lock.lock();
+        stage.runs++;
+        stage.dropped += dropped;
+        stage.total_ms += ms;
+        stage.max_ms = std::max(stage.max_ms, ms);
+        if (!stage.queue.empty())
+        {
+            _ready.push_back(stage_index);
+            _work_cv.notify_one();
+        }
+        else
+        {
+            stage.scheduled = false;
+        }
+        _busy--;
+        if (_busy == 0 && _ready.empty())
+        {
+            _idle_cv.notify_all();
+        }
+    }
+}
+
+bool HostGraph::runStage(Stage &stage, Message &message, HostFrames &output, uint64_t &dropped)
+{
+    NodeState &head = _nodes[stage.nodes.front()];
+    switch (head.desc.type)
+    {
+        case HostNodeType::SYNC:
+            return runSync(head, message.input, message.frames, output, dropped);
+        case HostNodeType::SINK:
+            head.desc.callback(message.frames);
+            return false;
+        case HostNodeType::DECODE_NN:
+            return runDecodeNN(head, message.frames.front(), output);
+        case HostNodeType::CONVERT:
+            if (_nodes[head.desc.inputs[0]].format == HostFrameFormat::YUV420)
+            {
+                return runConvertYuv(head, message.frames.front(), output);
+            }
+            return runPixelChain(stage.nodes, message.frames.front(), output);
+        case HostNodeType::COLORIZE:
+            return runPixelChain(stage.nodes, message.frames.front(), output);
+        case HostNodeType::SOURCE:
+            break;
+    }
+    return false;
+}
+
+bool HostGraph::runPixelChain(const std::vector<NodeId> &chain, const std::shared_ptr<HostDataPacket> &input, HostFrames &output)
+{
+    const NodeState &last = _nodes[chain.back()];
+
+    // interleaved 8-bit frames, RAW ones are gray or BGR by their dimensions
+    HostFrameFormat format = _nodes[_nodes[chain.front()].desc.inputs[0]].format;
+    if (format == HostFrameFormat::RAW)
+    {
+        const auto &dims = input->dimensions;
+        format = dims.size() == 3 && dims[2] == 3 ? HostFrameFormat::BGR : HostFrameFormat::GRAY;
+        if (dims.size() > 3 || (dims.size() == 3 && dims[2] != 3 && dims[2] != 1))
+        {
+            format = HostFrameFormat::NONE;
+        }
+    }
+
+    std::vector<PixelStep> steps;
+    for (NodeId id : chain)
+    {
+        PixelStep step;
+        if (format == HostFrameFormat::NONE || !get_pixel_step(_nodes[id].desc.type, format, _nodes[id].format, step))
+        {
+            Logger::instance().count(LogLevel::warn, "host graph: %u frames of unsupported format for %s", _nodes[id].desc.name.c_str());
+            return false;
+        }
+        steps.push_back(step);
+        format = _nodes[id].format;
+    }
+
+    const int in_channels = steps.front().in_channels;
+    const int out_channels = steps.back().out_channels;
+    if (input->elem_size != 1 || input->size() % in_channels != 0)
+    {
+        Logger::instance().count(LogLevel::warn, "host graph: %u frames of unsupported size for %s", last.desc.name.c_str());
+        return false;
+    }
+
+    const int pixels = input->size() / in_channels;
+    int height = 1, width = pixels;
+    if (input->dimensions.size() >= 2 && input->dimensions[0] * input->dimensions[1] == pixels)
+    {
+        height = input->dimensions[0];
+        width = input->dimensions[1];
+    }
+
+    auto buffer = std::make_shared<FrameBuffer>((size_t) pixels * out_channels);
+    const uint8_t *src = input->getData();
+    uint8_t *dst = buffer->data();
+
+    // chunks go through the chain in a stack scratch, no intermediate frames
+    parallel_for(0, pixels, [&](int range_begin, int range_end)
+    {
+        uint8_t scratch[2][c_pixel_chunk * 3];
+        for (int begin = range_begin; begin < range_end; begin += c_pixel_chunk)
+        {
+            const int count = std::min(c_pixel_chunk, range_end - begin);
+            const uint8_t *step_src = src + (size_t) begin * in_channels;
+            for (size_t s = 0; s < steps.size(); s++)
+            {
+                uint8_t *step_dst = s + 1 == steps.size() ? dst + (size_t) begin * out_channels : scratch[s & 1];
+                apply_pixel_step(steps[s], step_src, step_dst, count);
+                step_src = step_dst;
+            }
+        }
+    }, c_parallel_pixels);
+
+    output.push_back(std::make_shared<HostDataPacket>(
+        last.desc.name, buffer, image_dimensions(height, width, out_channels), 1,
+        output_metadata(input, buffer->size(), width, height, out_channels)));
+    return true;
+}
+
+bool HostGraph::runConvertYuv(const NodeState &node, const std::shared_ptr<HostDataPacket> &input, HostFrames &output)
+{
+    // frame geometry is only known from the metadata
+    YuvLayout layout;
+    if (!input->opt_metadata || !ColorConversionPostProcessor::getYuvLayout(input->stream_name, layout))
+    {
+        Logger::instance().count(LogLevel::warn, "host graph: %u frames without metadata for %s", node.desc.name.c_str());
+        return false;
+    }
+
+    const FrameMetadata &metadata = *input->opt_metadata;
+    const int width  = metadata.spec.width;
+    const int height = metadata.spec.height;
+    const int stride = metadata.spec.stride != 0 ? metadata.spec.stride : width;
+    if (width <= 0 || height <= 0 || (width | height) & 1 || input->size() < (size_t) stride * height * 3 / 2)
+    {
+        Logger::instance().count(LogLevel::warn, "host graph: %u frames with invalid metadata for %s", node.desc.name.c_str());
+        return false;
+    }
+
+    const int channels = get_pixel_format_channels(node.desc.format);
+    const int out_w = node.desc.downscale ? width / 2 : width;
+    const int out_h = node.desc.downscale ? height / 2 : height;
+    auto buffer = std::make_shared<FrameBuffer>(get_converted_size(width, height, node.desc.format, node.desc.downscale));
+    convert_yuv420(input->getData(), layout, width, height, stride, buffer->data(), node.desc.format, node.desc.downscale);
+
+    output.push_back(std::make_shared<HostDataPacket>(
+        node.desc.name, buffer, image_dimensions(out_h, out_w, channels), 1,
+        output_metadata(input, buffer->size(), out_w, out_h, channels)));
+    return true;
+}
+
+bool HostGraph::runDecodeNN(const NodeState &node, const std::shared_ptr<HostDataPacket> &input, HostFrames &output)
+{
+    const size_t header = offsetof(dai::Detections, detections);
+    if (input->size() < header)
+    {
+        Logger::instance().count(LogLevel::warn, "host graph: %u invalid detection packets for %s", node.desc.name.c_str());
+        return false;
+    }
+
+    uint32_t count;
+    memcpy(&count, input->getData(), sizeof(count));
+    count = std::min<uint32_t>(count, (input->size() - header) / sizeof(dai::Detection));
+
+    auto buffer = std::make_shared<FrameBuffer>();
+    buffer->reserve(count * sizeof(dai::Detection));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        dai::Detection detection;
+        memcpy(&detection, input->getData() + header + i * sizeof(dai::Detection), sizeof(detection));
+        if (detection.confidence >= node.desc.min_confidence)
+        {
+            const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&detection);
+            buffer->insert(buffer->end(), bytes, bytes + sizeof(detection));
+        }
+    }
+
+    const int detections = buffer->size() / sizeof(dai::Detection);
+    output.push_back(std::make_shared<HostDataPacket>(
+        node.desc.name, buffer, std::vector<int>{detections}, (int) sizeof(dai::Detection), input->opt_metadata));
+    return true;
+}
+
+bool HostGraph::runSync(NodeState &node, int input, const HostFrames &frames, HostFrames &output, uint64_t &dropped)
+{
+    const std::shared_ptr<HostDataPacket> &packet = frames.front();
+    if (!packet->opt_metadata)
+    {
+        dropped++;
+        Logger::instance().count(LogLevel::warn, "host graph: %u packets without sequence number for %s", node.desc.name.c_str());
+        return false;
+    }
+
+    const int sequence = packet->opt_metadata->getSequenceNum();
+    if (node.last_sequence >= 0 && sequence <= node.last_sequence)
+    {
+        if (node.last_sequence - sequence < c_sync_restart_gap)
+        {
+            dropped++;  // its set was already emitted or given up
+            return false;
+        }
+        node.pending.clear();
+        node.last_sequence = -1;
+    }
+
+    auto entry = std::find_if(node.pending.begin(), node.pending.end(),
+        [sequence](const std::pair<int, HostFrames> &pending) { return pending.first == sequence; });
+    if (entry == node.pending.end())
+    {
+        node.pending.push_back(std::make_pair(sequence, HostFrames(node.desc.inputs.size())));
+        entry = node.pending.end() - 1;
+    }
+    entry->second[input] = packet;
+
+    const bool complete = std::all_of(entry->second.begin(), entry->second.end(),
+        [](const std::shared_ptr<HostDataPacket> &frame) { return frame != nullptr; });
+    if (complete)
+    {
+        output = entry->second;
+        node.last_sequence = sequence;
+
+        // incomplete older sets can't complete anymore
+        const size_t before = node.pending.size();
+        node.pending.erase(std::remove_if(node.pending.begin(), node.pending.end(),
+            [sequence](const std::pair<int, HostFrames> &pending) { return pending.first <= sequence; }),
+            node.pending.end());
+        dropped += before - node.pending.size() - 1;
+        return true;
+    }
+
+    if (node.pending.size() > node.desc.queue_size)
+    {
+        node.pending.pop_front();
+        dropped++;
+    }
+    return false;
+}
+
+std::string HostGraph::toString()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::string result;
+    char line[256];
+    snprintf(line, sizeof(line), "host graph: %zu nodes, %zu stages, %zu workers\n",
+             _nodes.size(), _stages.size(), _workers.size());
+    result += line;
+
+    for (size_t id = 0; id < _nodes.size(); id++)
+    {
+        const NodeState &node = _nodes[id];
+
+        std::string inputs, consumers;
+        for (NodeId input : node.desc.inputs)
+        {
+            inputs += (inputs.empty() ? "" : ",") + std::to_string(input);
+        }
+        for (const auto &consumer : node.consumers)
+        {
+            consumers += (consumers.empty() ? "" : ",") + std::to_string(consumer.first);
+        }
+
+        snprintf(line, sizeof(line), "  [%zu] %-9s %-20s %-10s <- %-6s -> %-6s",
+                 id, node_type_name(node.desc.type), node.desc.name.c_str(), frame_format_name(node.format),
+                 inputs.empty() ? "-" : inputs.c_str(), consumers.empty() ? "-" : consumers.c_str());
+        result += line;
+
+        if (node.stage >= 0)
+        {
+            const Stage &stage = _stages[node.stage];
+            if (stage.nodes.front() != (NodeId) id)
+            {
+                snprintf(line, sizeof(line), " fused into [%d]\n", stage.nodes.front());
+            }
+            else
+            {
+                snprintf(line, sizeof(line), " stage %d%s: %llu runs, avg %.3f ms, max %.3f ms, queued %zu, dropped %llu\n",
+                         node.stage, stage.nodes.size() > 1 ? " (fused)" : "",
+                         (unsigned long long) stage.runs, stage.runs ? stage.total_ms / stage.runs : 0.0, stage.max_ms,
+                         stage.queue.size(), (unsigned long long) stage.dropped);
+            }
+            result += line;
+        }
+        else
+        {
+            result += "\n";
+        }
+    }
+    return result;
+}
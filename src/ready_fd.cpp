@@ -0,0 +1,121 @@
+#include <errno.h>
+#include <string.h>
+
+#include <cstdint>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "ready_fd.hpp"
+#include "logger.hpp"
+
+
+ReadyFd::~ReadyFd()
+{
+#ifndef _WIN32
+    const int read_fd = _read_fd.load();
+    if (read_fd >= 0)
+    {
+        close(read_fd);
+        if (_write_fd != read_fd)
+        {
+            close(_write_fd);
+        }
+    }
+#endif
+}
+
+int ReadyFd::getFd()
+{
+    int read_fd = _read_fd.load(std::memory_order_acquire);
+    if (read_fd >= 0)
+    {
+        return read_fd;
+    }
+
+    std::lock_guard<std::mutex> lock(_open_mutex);
+    read_fd = _read_fd.load(std::memory_order_relaxed);
+    if (read_fd >= 0 || _open_failed)
+    {
+        return read_fd;
+    }
+
+    do
+    {
+#if defined(__linux__)
+        read_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (read_fd < 0)
+        {
+            log_error("can't create eventfd: %s", strerror(errno));
+            break;
+        }
+        _write_fd = read_fd;
+#elif !defined(_WIN32)
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            log_error("can't create ready pipe: %s", strerror(errno));
+            break;
+        }
+        for (int fd : fds)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        read_fd = fds[0];
+        _write_fd = fds[1];
+#else
+        log_error("pollable ready descriptors are not supported on this platform");
+        break;
+#endif
+        // packets queued before the first call are not signalled, report them once
+        _pending = false;
+        _read_fd.store(read_fd, std::memory_order_release);
+        notify();
+        return read_fd;
+    }
+    while (false);
+
+    _open_failed = true;
+    return -1;
+}
+
+void ReadyFd::notify()
+{
+#ifndef _WIN32
+    if (_read_fd.load(std::memory_order_acquire) < 0 || _pending.exchange(true))
+    {
+        return;
+    }
+
+    const uint64_t one = 1;   // eventfd needs 8 bytes, a pipe takes them too
+    if (write(_write_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        Logger::instance().count(LogLevel::warn, "ready descriptor write failed %u times: %s", strerror(errno));
+    }
+#endif
+}
+
+void ReadyFd::clear()
+{
+#ifndef _WIN32
+    const int read_fd = _read_fd.load(std::memory_order_acquire);
+    if (read_fd < 0 || !_pending.load())
+    {
+        return;
+    }
+
+    // drain before resetting _pending: a notify() in between is kept pending
+    // and its data is taken by the caller right after this returns
+    uint64_t value[8];
+    while (read(read_fd, value, sizeof(value)) > 0 && read_fd != _write_fd)
+    {
+    }
+    _pending = false;
+#endif
+}
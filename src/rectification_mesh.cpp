@@ -0,0 +1,432 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "rectification_mesh.hpp"
+#include "parallel_for.hpp"
+#include "logger.hpp"
+
+
+namespace
+{
+
+// Read-only memory mapped file. Falls back to reading the file on platforms without mmap
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (file.is_open())
+        {
+            _buffer.resize((size_t) file.tellg());
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(_buffer.data()), _buffer.size());
+            _data = _buffer.data();
+            _size = _buffer.size();
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                _data = static_cast<const uint8_t*>(addr);
+                _size = st.st_size;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (_data != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(_data), _size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return _data != nullptr; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> _buffer;
+#endif
+};
+
+
+struct MeshCacheHeader
+{
+    char     magic[8];
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t cell_size;
+    uint32_t count;     // number of floats following the header
+};
+
+constexpr char c_mesh_cache_magic[8] = {'D', 'A', 'I', 'M', 'E', 'S', 'H', '1'};
+
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t hash_mat3(const Mat3f &m, uint64_t hash)
+{
+    for (int r = 0; r < 3; r++)
+    {
+        hash = fnv1a(m.m[r], 3 * sizeof(float), hash);
+    }
+    return hash;
+}
+
+// cols / rows of the mesh grid, including the right / bottom edge
+int mesh_points(int size, int cell_size)
+{
+    return (size + cell_size - 1) / cell_size + 1;
+}
+
+int mesh_row_stride(int width, int cell_size)
+{
+    const int cols = mesh_points(width, cell_size);
+    return 2 * (cols + (cols & 1));
+}
+
+void make_dirs(const std::string &path)
+{
+    for (size_t pos = 1; pos <= path.size(); pos++)
+    {
+        if (pos == path.size() || path[pos] == '/' || path[pos] == '\\')
+        {
+            const std::string dir = path.substr(0, pos);
+#ifdef _WIN32
+            _mkdir(dir.c_str());
+#else
+            mkdir(dir.c_str(), 0755);
+#endif
+        }
+    }
+}
+
+std::string mesh_cache_file(uint64_t key, int width, int height, int cell_size)
+{
+    char name[96];
+    snprintf(name, sizeof(name), "/mesh_%016llx_%dx%d_c%d.bin",
+        (unsigned long long) key, width, height, cell_size);
+    return get_mesh_cache_dir() + name;
+}
+
+bool load_cached_mesh(uint64_t key, int width, int height, int cell_size, std::vector<float> &mesh)
+{
+    MappedFile file(mesh_cache_file(key, width, height, cell_size));
+    if (!file.isOpen() || file.size() < sizeof(MeshCacheHeader))
+    {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, c_mesh_cache_magic, sizeof(header.magic)) != 0 ||
+        header.key != key ||
+        header.width != (uint32_t) width ||
+        header.height != (uint32_t) height ||
+        header.cell_size != (uint32_t) cell_size ||
+        file.size() != sizeof(header) + header.count * sizeof(float))
+    {
+        return false;
+    }
+
+    mesh.resize(header.count);
+    memcpy(mesh.data(), file.data() + sizeof(header), header.count * sizeof(float));
+    return true;
+}
+
+void store_cached_mesh(uint64_t key, int width, int height, int cell_size, const std::vector<float> &mesh)
+{
+    make_dirs(get_mesh_cache_dir());
+
+    MeshCacheHeader header;
+    memcpy(header.magic, c_mesh_cache_magic, sizeof(header.magic));
+    header.key = key;
+    header.width = width;
+    header.height = height;
+    header.cell_size = cell_size;
+    header.count = mesh.size();
+
+    // write + rename, so concurrent readers never see a partial file
+    const std::string path = mesh_cache_file(key, width, height, cell_size);
+    const std::string tmp_path = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            log_warn("depthai: mesh cache directory is not writable: %s", get_mesh_cache_dir().c_str());
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(mesh.data()), mesh.size() * sizeof(float));
+        if (!file.good())
+        {
+            file.close();
+            remove(tmp_path.c_str());
+            return;
+        }
+    }
+#ifdef _WIN32
+    remove(path.c_str());
+#endif
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp_path.c_str());
+    }
+}
+
+} // namespace
+
+
+RectificationModel::RectificationModel(
+    const Mat3f &M,
+    const Mat3f &R,
+    const Mat3f &M_new,
+    const std::vector<float> &d
+)
+{
+    if (!mat_inv(M_new * R, _iR))
+    {
+        _iR = Mat3f::identity();
+    }
+
+    _fx = M(0, 0);
+    _fy = M(1, 1);
+    _u0 = M(0, 2);
+    _v0 = M(1, 2);
+
+    for (int i = 0; i < 14; i++)
+    {
+        _k[i] = i < (int) d.size() ? d[i] : 0.f;
+    }
+
+    // tilted sensor model (tauX, tauY)
+    const float c_tau_x = cosf(_k[12]), s_tau_x = sinf(_k[12]);
+    const float c_tau_y = cosf(_k[13]), s_tau_y = sinf(_k[13]);
+    const Mat3f rot_x(1.f, 0.f, 0.f,
+                      0.f, c_tau_x, s_tau_x,
+                      0.f, -s_tau_x, c_tau_x);
+    const Mat3f rot_y(c_tau_y, 0.f, -s_tau_y,
+                      0.f, 1.f, 0.f,
+                      s_tau_y, 0.f, c_tau_y);
+    const Mat3f rot_xy = rot_y * rot_x;
+    const Mat3f proj_z(rot_xy(2, 2), 0.f, -rot_xy(0, 2),
+                       0.f, rot_xy(2, 2), -rot_xy(1, 2),
+                       0.f, 0.f, 1.f);
+    _tilt = proj_z * rot_xy;
+
+    _hash = hash_mat3(M, 14695981039346656037ULL);
+    _hash = hash_mat3(R, _hash);
+    _hash = hash_mat3(M_new, _hash);
+    _hash = fnv1a(_k, sizeof(_k), _hash);
+}
+
+void RectificationModel::mapRow(const float *xs, int count, float y, float *src_x, float *src_y) const
+{
+    // Hoisted constants, the loop body is branch-free so it is vectorized by the compiler
+    const float ir0 = _iR(0, 0), ir1 = _iR(0, 1), ir2 = _iR(0, 2) + y * ir1;
+    const float ir3 = _iR(1, 0), ir4 = _iR(1, 1), ir5 = _iR(1, 2) + y * ir4;
+    const float ir6 = _iR(2, 0), ir7 = _iR(2, 1), ir8 = _iR(2, 2) + y * ir7;
+
+    const float k1 = _k[0], k2 = _k[1], p1 = _k[2], p2 = _k[3], k3 = _k[4];
+    const float k4 = _k[5], k5 = _k[6], k6 = _k[7];
+    const float s1 = _k[8], s2 = _k[9], s3 = _k[10], s4 = _k[11];
+
+    const float t0 = _tilt(0, 0), t1 = _tilt(0, 1), t2 = _tilt(0, 2);
+    const float t3 = _tilt(1, 0), t4 = _tilt(1, 1), t5 = _tilt(1, 2);
+    const float t6 = _tilt(2, 0), t7 = _tilt(2, 1), t8 = _tilt(2, 2);
+
+    const float fx = _fx, fy = _fy, u0 = _u0, v0 = _v0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const float j = xs[i];
+        const float w = 1.f / (j * ir6 + ir8);
+        const float x = (j * ir0 + ir2) * w;
+        const float yy = (j * ir3 + ir5) * w;
+
+        const float x2 = x * x, y2 = yy * yy;
+        const float r2 = x2 + y2, _2xy = 2.f * x * yy;
+        const float kr = (1.f + ((k3 * r2 + k2) * r2 + k1) * r2) / (1.f + ((k6 * r2 + k5) * r2 + k4) * r2);
+        const float xd = x * kr + p1 * _2xy + p2 * (r2 + 2.f * x2) + s1 * r2 + s2 * r2 * r2;
+        const float yd = yy * kr + p1 * (r2 + 2.f * y2) + p2 * _2xy + s3 * r2 + s4 * r2 * r2;
+
+        const float tx = t0 * xd + t1 * yd + t2;
+        const float ty = t3 * xd + t4 * yd + t5;
+        const float tz = t6 * xd + t7 * yd + t8;
+        const float inv_proj = tz != 0.f ? 1.f / tz : 1.f;
+
+        src_x[i] = fx * inv_proj * tx + u0;
+        src_y[i] = fy * inv_proj * ty + v0;
+    }
+}
+
+
+void create_rectification_mesh(
+    const RectificationModel &model,
+    int width, int height,
+    std::vector<float> &mesh,
+    int cell_size
+)
+{
+    const int cols = mesh_points(width, cell_size);
+    const int rows = mesh_points(height, cell_size);
+    const int stride = mesh_row_stride(width, cell_size);
+
+    mesh.assign(stride * rows, 0.f);
+
+    std::vector<float> xs(cols);
+    for (int c = 0; c < cols; c++)
+    {
+        xs[c] = std::min(c * cell_size, width - 1);
+    }
+
+    parallel_for(0, rows, [&](int row_begin, int row_end)
+    {
+        std::vector<float> src_x(cols), src_y(cols);
+        for (int r = row_begin; r < row_end; r++)
+        {
+            model.mapRow(xs.data(), cols, std::min(r * cell_size, height - 1), src_x.data(), src_y.data());
+
+            float *out = mesh.data() + r * stride;
+            for (int c = 0; c < cols; c++)
+            {
+                out[2 * c]     = src_y[c];
+                out[2 * c + 1] = src_x[c];
+            }
+        }
+    }, 4);
+}
+
+void create_rectification_mesh_cached(
+    const RectificationModel &model,
+    int width, int height,
+    std::vector<float> &mesh,
+    int cell_size
+)
+{
+    if (load_cached_mesh(model.hash(), width, height, cell_size, mesh))
+    {
+        return;
+    }
+
+    create_rectification_mesh(model, width, height, mesh, cell_size);
+    store_cached_mesh(model.hash(), width, height, cell_size, mesh);
+}
+
+bool create_rectification_mesh_from_map_file(
+    const std::string &map_file,
+    int map_w, int map_h,
+    int width, int height,
+    std::vector<float> &mesh,
+    int cell_size
+)
+{
+    MappedFile file(map_file);
+    const size_t map_size = (size_t) map_w * map_h;
+    if (!file.isOpen() || file.size() != 2 * map_size * sizeof(float))
+    {
+        return false;
+    }
+
+    const float *map_x = reinterpret_cast<const float*>(file.data());
+    const float *map_y = map_x + map_size;
+
+    // half resolution is binned, lower resolutions are center-cropped
+    const int scale = (height * 2 == map_h) ? 2 : 1;
+    const int offset_y = (scale == 2) ? 0 : (map_h - height) / 2;
+
+    const int cols = mesh_points(width, cell_size);
+    const int rows = mesh_points(height, cell_size);
+    const int stride = mesh_row_stride(width, cell_size);
+
+    mesh.assign(stride * rows, 0.f);
+
+    parallel_for(0, rows, [&](int row_begin, int row_end)
+    {
+        for (int r = row_begin; r < row_end; r++)
+        {
+            const int y = std::min(r * cell_size, height - 1);
+            const int my = std::min(y * scale + offset_y, map_h - 1);
+
+            float *out = mesh.data() + r * stride;
+            for (int c = 0; c < cols; c++)
+            {
+                const int x = std::min(c * cell_size, width - 1);
+                const int mx = std::min(x * scale, map_w - 1);
+                out[2 * c]     = map_y[my * map_w + mx] / scale - offset_y;
+                out[2 * c + 1] = map_x[my * map_w + mx] / scale;
+            }
+        }
+    }, 4);
+
+    return true;
+}
+
+std::string get_mesh_cache_dir()
+{
+    const char *dir = getenv("DEPTHAI_MESH_CACHE_DIR");
+    if (dir != nullptr && dir[0] != 0)
+    {
+        return dir;
+    }
+
+#ifdef _WIN32
+    const char *base = getenv("LOCALAPPDATA");
+    return std::string(base != nullptr ? base : ".") + "/depthai/mesh";
+#else
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg != nullptr && xdg[0] != 0)
+    {
+        return std::string(xdg) + "/depthai/mesh";
+    }
+    const char *home = getenv("HOME");
+    return std::string(home != nullptr ? home : "/tmp") + "/.cache/depthai/mesh";
+#endif
+}
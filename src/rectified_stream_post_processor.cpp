@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "rectified_stream_post_processor.hpp"
+#include "logger.hpp"
+#include "thread_settings.hpp"
+#include "depthai-shared/metadata/frame_metadata.hpp"
+
+
+RectifiedStreamPostProcessor::RectifiedStreamPostProcessor(
+    const RectificationModel &left_model,
+    const RectificationModel &right_model
+)
+    : _left(left_model)
+    , _right(right_model)
+{
+
+}
+
+std::string RectifiedStreamPostProcessor::getOutputStreamName(const std::string &raw_stream_name)
+{
+    return raw_stream_name + "_rect";
+}
+
+StreamInfo RectifiedStreamPostProcessor::getOutputStreamInfo(const StreamInfo &raw_stream)
+{
+    const std::string name = getOutputStreamName(raw_stream.name);
+    return StreamInfo(name.c_str(),
+        raw_stream.dimensions[0] * raw_stream.dimensions[1] + sizeof(FrameMetadata),
+        {raw_stream.dimensions[0], raw_stream.dimensions[1]});
+}
+
+void RectifiedStreamPostProcessor::onNewData(
+    const StreamInfo &data_info,
+    const StreamData &data
+)
+{
+    apply_thread_settings(ThreadClass::POST_PROCESSING, data_info.name);
+
+    Channel *channel = nullptr;
+    if (data_info.name == std::string("left"))
+    {
+        channel = &_left;
+    }
+    else if (data_info.name == std::string("right"))
+    {
+        channel = &_right;
+    }
+    else
+    {
+        return;
+    }
+
+    const int height = data_info.dimensions[0];
+    const int width  = data_info.dimensions[1];
+    const unsigned frame_size = width * height;
+
+    if (data.size < frame_size + sizeof(FrameMetadata))
+    {
+        Logger::instance().count(LogLevel::warn, "RectifiedStreamPostProcessor: %u %s frames of wrong size", data_info.name.c_str());
+        return;
+    }
+
+    // remap table is built once per resolution
+    if (!channel->table.matches(width, height))
+    {
+        channel->table.init(channel->model, width, height);
+    }
+
+    StreamInfo rect_si = getOutputStreamInfo(data_info);
+
+    channel->output.resize(rect_si.size);
+    const unsigned char *raw = (const unsigned char*) data.data;
+    channel->table.remap(raw, channel->output.data());
+
+    memcpy(channel->output.data() + frame_size, raw + data.size - sizeof(FrameMetadata), sizeof(FrameMetadata));
+
+    StreamData rect_d;
+    rect_d.packet_number = data.packet_number;
+    rect_d.data = channel->output.data();
+    rect_d.size = channel->output.size();
+
+    notifyObservers(rect_si, rect_d);
+}
@@ -0,0 +1,366 @@
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "shm_ring.hpp"
+#include "logger.hpp"
+
+
+static constexpr uint32_t c_shm_magic = 0x44414952;    // "DAIR"
+static constexpr uint32_t c_shm_version = 1;
+
+// Shared memory layout: ShmRingHeader, then slot_count slots of slot_stride
+// bytes, each a ShmSlotHeader followed by the payload
+struct ShmRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint64_t slot_stride;
+    uint64_t data_offset;
+    uint32_t metadata_size;             // sizeof(FrameMetadata) of the publisher
+
+    alignas(64) std::atomic<uint64_t> write_sequence;  // frames published
+    alignas(64) std::atomic<uint32_t> notify;          // futex word, bumped on publish
+};
+
+struct ShmSlotHeader
+{
+    std::atomic<uint64_t> sequence;     // 2 * frame + 1 while written, 2 * frame + 2 when complete
+    uint32_t size;
+    int32_t  elem_size;
+    int32_t  dimensions[4];
+    int32_t  dimension_count;
+    int32_t  has_metadata;
+    FrameMetadata metadata;
+};
+
+
+namespace
+{
+
+size_t align64(size_t size)
+{
+    return (size + 63) & ~size_t(63);
+}
+
+std::string shm_path(const std::string &name)
+{
+    std::string path = "/depthai_" + name;
+    std::replace(path.begin() + 1, path.end(), '/', '_');
+    return path;
+}
+
+inline ShmSlotHeader* slot_at(const ShmRingHeader *header, uint64_t sequence)
+{
+    const uint8_t *base = reinterpret_cast<const uint8_t*>(header) + header->data_offset;
+    return reinterpret_cast<ShmSlotHeader*>(const_cast<uint8_t*>(base + (sequence % header->slot_count) * header->slot_stride));
+}
+
+void wake_subscribers(ShmRingHeader *header)
+{
+    header->notify.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->notify), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+// Returns when notify changed from value, or after timeout_ms (-1: forever)
+void wait_for_publish(const ShmRingHeader *header, uint32_t value, int timeout_ms)
+{
+#ifdef __linux__
+    struct timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&header->notify), FUTEX_WAIT, value,
+            timeout_ms < 0 ? nullptr : &timeout, nullptr, 0);
+#else
+    // no cross process futex, poll
+    (void) value;
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms < 0 ? 1 : std::min(timeout_ms, 1)));
+#endif
+}
+
+} // namespace
+
+
+ShmPublisher::ShmPublisher(const std::string &name, uint32_t slot_count, uint32_t slot_size)
+    : _path(shm_path(name))
+{
+#ifdef _WIN32
+    log_error("shm ring %s: shared memory transport is not supported on this platform", name.c_str());
+#else
+    do
+    {
+        if (slot_count < 2)
+        {
+            log_error("shm ring %s: at least 2 slots are needed", name.c_str());
+            break;
+        }
+
+        const size_t data_offset = align64(sizeof(ShmRingHeader));
+        const size_t slot_stride = align64(sizeof(ShmSlotHeader) + slot_size);
+        _mapping_size = data_offset + slot_stride * slot_count;
+
+        // subscribers of a previous publisher keep their mapping of the old ring
+        shm_unlink(_path.c_str());
+        const int fd = shm_open(_path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+        {
+            log_error("shm ring %s: shm_open failed: %s", _path.c_str(), strerror(errno));
+            break;
+        }
+        if (ftruncate(fd, _mapping_size) != 0)
+        {
+            log_error("shm ring %s: can't allocate %zu bytes: %s", _path.c_str(), _mapping_size, strerror(errno));
+            close(fd);
+            shm_unlink(_path.c_str());
+            break;
+        }
+        void *mapping = mmap(nullptr, _mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            log_error("shm ring %s: mmap failed: %s", _path.c_str(), strerror(errno));
+            shm_unlink(_path.c_str());
+            break;
+        }
+        _mapping = mapping;
+
+        // the new file is zero filled, slot sequences start at 0 (empty)
+        ShmRingHeader *header = new (mapping) ShmRingHeader();
+        header->version = c_shm_version;
+        header->slot_count = slot_count;
+        header->slot_size = slot_size;
+        header->slot_stride = slot_stride;
+        header->data_offset = data_offset;
+        header->metadata_size = sizeof(FrameMetadata);
+        header->write_sequence.store(0, std::memory_order_relaxed);
+        header->notify.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = c_shm_magic;
+
+        _header = header;
+        log_info("shm ring %s: %u slots of %u bytes", _path.c_str(), slot_count, slot_size);
+    }
+    while (false);
+#endif
+}
+
+ShmPublisher::~ShmPublisher()
+{
+#ifndef _WIN32
+    if (_mapping != nullptr)
+    {
+        munmap(_mapping, _mapping_size);
+        shm_unlink(_path.c_str());
+    }
+#endif
+}
+
+bool ShmPublisher::publish(const HostDataPacket &packet)
+{
+    if (_header == nullptr)
+    {
+        return false;
+    }
+
+    const uint32_t size = packet.size();
+    if (size > _header->slot_size)
+    {
+        Logger::instance().count(LogLevel::warn, "shm ring: %u %s frames larger than the slot size", packet.stream_name.c_str());
+        return false;
+    }
+
+    const uint64_t sequence = _header->write_sequence.load(std::memory_order_relaxed);
+    ShmSlotHeader *slot = slot_at(_header, sequence);
+
+    slot->sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->size = size;
+    slot->elem_size = packet.elem_size;
+    slot->dimension_count = (int32_t) std::min<size_t>(packet.dimensions.size(), 4);
+    for (int i = 0; i < slot->dimension_count; i++)
+    {
+        slot->dimensions[i] = packet.dimensions[i];
+    }
+    slot->has_metadata = packet.opt_metadata ? 1 : 0;
+    if (packet.opt_metadata)
+    {
+        memcpy(&slot->metadata, &*packet.opt_metadata, sizeof(FrameMetadata));
+    }
+    memcpy(reinterpret_cast<uint8_t*>(slot) + sizeof(ShmSlotHeader), packet.getData(), size);
+
+    slot->sequence.store(2 * sequence + 2, std::memory_order_release);
+    _header->write_sequence.store(sequence + 1, std::memory_order_release);
+    wake_subscribers(_header);
+    return true;
+}
+
+uint64_t ShmPublisher::getPublishedFrames() const
+{
+    return _header ? _header->write_sequence.load(std::memory_order_relaxed) : 0;
+}
+
+
+ShmSubscriber::ShmSubscriber(const std::string &name)
+{
+#ifdef _WIN32
+    log_error("shm ring %s: shared memory transport is not supported on this platform", name.c_str());
+#else
+    const std::string path = shm_path(name);
+    do
+    {
+        const int fd = shm_open(path.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            log_error("shm ring %s: shm_open failed: %s", path.c_str(), strerror(errno));
+            break;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ShmRingHeader))
+        {
+            log_error("shm ring %s: ring is not initialized", path.c_str());
+            close(fd);
+            break;
+        }
+        void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            log_error("shm ring %s: mmap failed: %s", path.c_str(), strerror(errno));
+            break;
+        }
+        _mapping = mapping;
+        _mapping_size = st.st_size;
+
+        const ShmRingHeader *header = static_cast<const ShmRingHeader*>(mapping);
+        const bool valid = header->magic == c_shm_magic;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!valid || header->version != c_shm_version || header->metadata_size != sizeof(FrameMetadata)
+            || header->data_offset + header->slot_stride * header->slot_count > _mapping_size)
+        {
+            log_error("shm ring %s: incompatible ring", path.c_str());
+            break;
+        }
+        _header = header;
+    }
+    while (false);
+#endif
+}
+
+ShmSubscriber::~ShmSubscriber()
+{
+#ifndef _WIN32
+    if (_mapping != nullptr)
+    {
+        munmap(_mapping, _mapping_size);
+    }
+#endif
+}
+
+bool ShmSubscriber::next(ShmFrame &frame, int timeout_ms)
+{
+    if (_header == nullptr)
+    {
+        return false;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    while (true)
+    {
+        const uint32_t notify = _header->notify.load(std::memory_order_acquire);
+        const uint64_t written = _header->write_sequence.load(std::memory_order_acquire);
+
+        if (!_started && written > 0)
+        {
+            _next_sequence = written - 1;
+            _started = true;
+        }
+
+        if (_started && _next_sequence < written)
+        {
+            // the oldest slot is the next one the publisher overwrites
+            const uint64_t oldest = written > _header->slot_count - 1 ? written - (_header->slot_count - 1) : 0;
+            if (_next_sequence < oldest)
+            {
+                _lost_frames += oldest - _next_sequence;
+                _next_sequence = oldest;
+            }
+
+            const uint64_t sequence = _next_sequence++;
+            const ShmSlotHeader *slot = slot_at(_header, sequence);
+            const uint64_t slot_sequence = slot->sequence.load(std::memory_order_acquire);
+            if (slot_sequence != 2 * sequence + 2)
+            {
+                _lost_frames++;
+                continue;
+            }
+
+            frame.size = std::min(slot->size, _header->slot_size);
+            frame.elem_size = slot->elem_size;
+            frame.dimension_count = std::min(std::max(slot->dimension_count, 0), 4);
+            memcpy(frame.dimensions, slot->dimensions, sizeof(frame.dimensions));
+            frame.has_metadata = slot->has_metadata != 0;
+            memcpy(&frame.metadata, &slot->metadata, sizeof(FrameMetadata));
+
+            // the copied fields are consistent only if the slot was not reused meanwhile
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) != slot_sequence)
+            {
+                _lost_frames++;
+                continue;
+            }
+
+            frame.data = reinterpret_cast<const uint8_t*>(slot) + sizeof(ShmSlotHeader);
+            frame.sequence = sequence;
+            frame._slot = &slot->sequence;
+            frame._slot_sequence = slot_sequence;
+            return true;
+        }
+
+        if (timeout_ms == 0)
+        {
+            return false;
+        }
+        int wait_ms = -1;
+        if (timeout_ms > 0)
+        {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0)
+            {
+                return false;
+            }
+            wait_ms = (int) left;
+        }
+        wait_for_publish(_header, notify, wait_ms);
+    }
+}
+
+bool ShmSubscriber::isValid(const ShmFrame &frame) const
+{
+    if (frame._slot == nullptr)
+    {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame._slot->load(std::memory_order_relaxed) == frame._slot_sequence;
+}
@@ -0,0 +1,498 @@
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "stream_server.hpp"
+#include "logger.hpp"
+
+
+static constexpr size_t c_max_batch_messages = 16;     // per sendmsg
+static constexpr size_t c_max_client_input = 4096;     // pending command bytes
+static constexpr int    c_client_send_buffer = 4 * 1024 * 1024;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // SO_NOSIGPIPE is set instead
+#endif
+
+
+namespace
+{
+
+#ifndef _WIN32
+bool set_nonblocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0
+        && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+#endif
+
+} // namespace
+
+
+const uint8_t* StreamServer::Message::payload() const
+{
+    return packet ? packet->getData() : reinterpret_cast<const uint8_t*>(name.data());
+}
+
+StreamServer::StreamServer(const std::string &socket_path, size_t client_queue_size)
+    : _socket_path(socket_path)
+    , _client_queue_size(std::max<size_t>(1, client_queue_size))
+    , _wake_pending(false)
+    , _quit(false)
+    , _sent_bytes(0)
+    , _skipped_frames(0)
+{
+#ifdef _WIN32
+    log_error("stream server %s: unix domain sockets are not supported on this platform", socket_path.c_str());
+#else
+    do
+    {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path))
+        {
+            log_error("stream server: invalid socket path '%s'", socket_path.c_str());
+            break;
+        }
+        strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        if (pipe(_wake_fds) != 0 || !set_nonblocking(_wake_fds[0]) || !set_nonblocking(_wake_fds[1]))
+        {
+            log_error("stream server: can't create wake pipe: %s", strerror(errno));
+            break;
+        }
+
+        _listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_listen_fd < 0 || !set_nonblocking(_listen_fd))
+        {
+            log_error("stream server: socket failed: %s", strerror(errno));
+            break;
+        }
+
+        // stale socket of a previous run
+        unlink(socket_path.c_str());
+        if (bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || listen(_listen_fd, 16) != 0)
+        {
+            log_error("stream server %s: bind failed: %s", socket_path.c_str(), strerror(errno));
+            break;
+        }
+
+        _thread = std::thread(&StreamServer::ioThread, this);
+        log_info("stream server listening on %s", socket_path.c_str());
+    }
+    while (false);
+#endif
+}
+
+StreamServer::~StreamServer()
+{
+    stop();
+}
+
+void StreamServer::stop()
+{
+#ifndef _WIN32
+    _quit = true;
+    if (_thread.joinable())
+    {
+        wake();
+        _thread.join();
+        unlink(_socket_path.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &client : _clients)
+    {
+        close(client.first);
+    }
+    _clients.clear();
+
+    for (int *fd : {&_listen_fd, &_wake_fds[0], &_wake_fds[1]})
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+#endif
+}
+
+size_t StreamServer::getClientCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _clients.size();
+}
+
+bool StreamServer::isSubscribed(const Client &client, const std::string &stream_name)
+{
+    return client.subscribed_all || client.subscriptions.count(stream_name) > 0;
+}
+
+void StreamServer::onPacket(const std::shared_ptr<HostDataPacket> &packet)
+{
+    if (!isRunning())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto stream = _streams.find(packet->stream_name);
+        if (stream == _streams.end())
+        {
+            StreamState state;
+            state.id = (uint16_t) _streams.size();
+            state.sequence = 0;
+            stream = _streams.emplace(packet->stream_name, state).first;
+        }
+        const uint64_t sequence = stream->second.sequence++;
+        if (_clients.empty())
+        {
+            return;
+        }
+
+        Message data;
+        memset(&data.header, 0, sizeof(data.header));
+        data.header.magic = c_stream_packet_magic;
+        data.header.type = (uint16_t) StreamPacketType::DATA;
+        data.header.stream_id = stream->second.id;
+        data.header.sequence = sequence;
+        data.header.timestamp = packet->opt_metadata ? packet->opt_metadata->getTimestamp() : NAN;
+        data.header.payload_size = packet->size();
+        data.header.elem_size = packet->elem_size;
+        data.header.dimension_count = (int32_t) std::min<size_t>(packet->dimensions.size(), 4);
+        for (int i = 0; i < data.header.dimension_count; i++)
+        {
+            data.header.dimensions[i] = packet->dimensions[i];
+        }
+        data.packet = packet;
+
+        for (auto &entry : _clients)
+        {
+            Client &client = *entry.second;
+            if (!isSubscribed(client, packet->stream_name))
+            {
+                continue;
+            }
+
+            if (client.announced.insert(stream->second.id).second)
+            {
+                Message info;
+                info.header = data.header;
+                info.header.type = (uint16_t) StreamPacketType::STREAM_INFO;
+                info.header.payload_size = (uint32_t) packet->stream_name.size();
+                info.name = packet->stream_name;
+                client.queue.push_back(info);
+            }
+
+            if (client.data_count >= _client_queue_size)
+            {
+                // skip the oldest frame that is not being sent
+                const size_t busy = std::max<size_t>(client.in_flight, client.sent_offset > 0 ? 1 : 0);
+                auto it = client.queue.begin();
+                std::advance(it, std::min(busy, client.queue.size()));
+                while (it != client.queue.end() && it->packet == nullptr)
+                {
+                    ++it;
+                }
+                _skipped_frames++;
+                if (it == client.queue.end())
+                {
+                    continue;
+                }
+                client.queue.erase(it);
+                client.data_count--;
+            }
+
+            client.queue.push_back(data);
+            client.data_count++;
+        }
+    }
+
+    wake();
+}
+
+void StreamServer::wake()
+{
+#ifndef _WIN32
+    if (!_wake_pending.exchange(true))
+    {
+        const char byte = 0;
+        if (write(_wake_fds[1], &byte, 1) < 0 && errno != EAGAIN)
+        {
+            log_error("stream server: wake failed: %s", strerror(errno));
+        }
+    }
+#endif
+}
+
+void StreamServer::ioThread()
+{
+#ifndef _WIN32
+    std::vector<pollfd> fds;
+    std::vector<std::shared_ptr<Client>> clients;
+
+    while (!_quit)
+    {
+        fds.clear();
+        fds.push_back({_wake_fds[0], POLLIN, 0});
+        fds.push_back({_listen_fd, POLLIN, 0});
+        clients.clear();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &entry : _clients)
+            {
+                const short events = POLLIN | (entry.second->queue.empty() ? 0 : POLLOUT);
+                fds.push_back({entry.first, events, 0});
+                clients.push_back(entry.second);
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+        {
+            log_error("stream server: poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            char buffer[64];
+            while (read(_wake_fds[0], buffer, sizeof(buffer)) > 0)
+            {}
+            _wake_pending = false;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            acceptClients();
+        }
+
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            const short revents = fds[i + 2].revents;
+            Client &client = *clients[i];
+            bool ok = true;
+            if (revents & POLLIN)
+            {
+                ok = readClient(client);
+            }
+            else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+            {
+                ok = false;
+            }
+
+            // queued data is sent right away, POLLOUT only after a full socket buffer
+            if (ok)
+            {
+                ok = flushClient(client);
+            }
+            if (!ok)
+            {
+                closeClient(client.fd);
+            }
+        }
+    }
+#endif
+}
+
+void StreamServer::acceptClients()
+{
+#ifndef _WIN32
+    while (true)
+    {
+        const int fd = accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                log_error("stream server: accept failed: %s", strerror(errno));
+            }
+            return;
+        }
+        if (!set_nonblocking(fd))
+        {
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &c_client_send_buffer, sizeof(c_client_send_buffer));
+#ifdef SO_NOSIGPIPE
+        const int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+        std::shared_ptr<Client> client = std::make_shared<Client>();
+        client->fd = fd;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _clients[fd] = client;
+        log_info("stream server: client %d connected", fd);
+    }
+#endif
+}
+
+bool StreamServer::readClient(Client &client)
+{
+#ifdef _WIN32
+    return false;
+#else
+    char buffer[1024];
+    const ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (received == 0)
+    {
+        return false;
+    }
+    if (received < 0)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    client.input.append(buffer, received);
+
+    size_t line_end;
+    while ((line_end = client.input.find('\n')) != std::string::npos)
+    {
+        std::string line = client.input.substr(0, line_end);
+        client.input.erase(0, line_end + 1);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        const size_t space = line.find(' ');
+        const std::string command = line.substr(0, space);
+        const std::string stream = space == std::string::npos ? "" : line.substr(space + 1);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (command == "subscribe" && !stream.empty())
+        {
+            if (stream == "*")
+            {
+                client.subscribed_all = true;
+            }
+            else
+            {
+                client.subscriptions.insert(stream);
+            }
+        }
+        else if (command == "unsubscribe" && !stream.empty())
+        {
+            if (stream == "*")
+            {
+                client.subscribed_all = false;
+                client.subscriptions.clear();
+            }
+            else
+            {
+                client.subscriptions.erase(stream);
+            }
+        }
+        else if (!line.empty())
+        {
+            Logger::instance().count(LogLevel::warn, "stream server: %u unknown commands '%s'", line.c_str());
+        }
+    }
+
+    return client.input.size() <= c_max_client_input;
+#endif
+}
+
+bool StreamServer::flushClient(Client &client)
+{
+#ifdef _WIN32
+    return false;
+#else
+    std::vector<iovec> iov;
+    while (true)
+    {
+        iov.clear();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            size_t skip = client.sent_offset;
+            for (const Message &message : client.queue)
+            {
+                if (client.in_flight == c_max_batch_messages)
+                {
+                    break;
+                }
+                client.in_flight++;
+
+                // the front message may be partially sent already
+                const uint8_t *parts[2] = {reinterpret_cast<const uint8_t*>(&message.header), message.payload()};
+                const size_t sizes[2] = {sizeof(StreamPacketHeader), message.header.payload_size};
+                for (int p = 0; p < 2; p++)
+                {
+                    if (skip >= sizes[p])
+                    {
+                        skip -= sizes[p];
+                        continue;
+                    }
+                    iov.push_back({const_cast<uint8_t*>(parts[p] + skip), sizes[p] - skip});
+                    skip = 0;
+                }
+            }
+        }
+        if (iov.empty())
+        {
+            return true;
+        }
+
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = iov.size();
+        ssize_t sent = sendmsg(client.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        client.in_flight = 0;
+        if (sent < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        _sent_bytes += sent;
+
+        // drop the completely sent messages
+        size_t done = client.sent_offset + sent;
+        while (!client.queue.empty())
+        {
+            const size_t size = sizeof(StreamPacketHeader) + client.queue.front().header.payload_size;
+            if (done < size)
+            {
+                break;
+            }
+            done -= size;
+            if (client.queue.front().packet)
+            {
+                client.data_count--;
+            }
+            client.queue.pop_front();
+        }
+        client.sent_offset = done;
+    }
+#endif
+}
+
+void StreamServer::closeClient(int fd)
+{
+#ifndef _WIN32
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_clients.erase(fd) > 0)
+    {
+        close(fd);
+        log_info("stream server: client %d disconnected", fd);
+    }
+#endif
+}
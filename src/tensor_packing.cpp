@@ -0,0 +1,453 @@
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "tensor_packing.hpp"
+#include "parallel_for.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEPTHAI_TENSOR_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DEPTHAI_TENSOR_NEON
+#endif
+
+
+// pixels per parallel task
+static constexpr int c_pack_min_range = 16 * 1024;
+
+
+namespace
+{
+
+// Images are processed as a sequence of pixels: pixel i of channel c is at
+// c * count + i in CHW and at i * channels + c in HWC
+struct PackJob
+{
+    const uint8_t *src;
+    TensorLayout   src_layout;
+    TensorLayout   dst_layout;
+    int            channels;
+    size_t         count;           // height * width
+    bool           swap_rb;
+    float          scale[3];        // used by the SIMD paths (3 channels)
+    float          bias[3];         // -mean * scale
+};
+
+inline int source_channel(const PackJob &job, int c)
+{
+    return (job.swap_rb && job.channels == 3) ? 2 - c : c;
+}
+
+inline uint8_t load_scalar(const PackJob &job, size_t i, int c)
+{
+    const int sc = source_channel(job, c);
+    return job.src_layout == TensorLayout::CHW ? job.src[sc * job.count + i] : job.src[i * job.channels + sc];
+}
+
+inline size_t dst_index(const PackJob &job, size_t i, int c)
+{
+    return job.dst_layout == TensorLayout::CHW ? c * job.count + i : i * job.channels + c;
+}
+
+void pack_u8_scalar(const PackJob &job, uint8_t *dst, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        for (int c = 0; c < job.channels; c++)
+        {
+            dst[dst_index(job, i, c)] = load_scalar(job, i, c);
+        }
+    }
+}
+
+void pack_f32_scalar(const PackJob &job, const float *scale, const float *bias, float *dst, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        for (int c = 0; c < job.channels; c++)
+        {
+            dst[dst_index(job, i, c)] = load_scalar(job, i, c) * scale[c] + bias[c];
+        }
+    }
+}
+
+#if defined(DEPTHAI_TENSOR_SSE2)
+
+// 3 x 4 transposes on 32-bit lanes:
+// (r0 r1 r2 r3) (g..) (b..) <-> (r0 g0 b0 r1) (g1 b1 r2 g2) (b2 r3 g3 b3)
+inline void interleave3(__m128 r, __m128 g, __m128 b, __m128 &o0, __m128 &o1, __m128 &o2)
+{
+    const __m128 rg_lo = _mm_unpacklo_ps(r, g);
+    const __m128 rg_hi = _mm_unpackhi_ps(r, g);
+    o0 = _mm_shuffle_ps(rg_lo, _mm_unpacklo_ps(b, r), _MM_SHUFFLE(3, 0, 1, 0));
+    o1 = _mm_shuffle_ps(_mm_unpacklo_ps(g, b), rg_hi, _MM_SHUFFLE(1, 0, 3, 2));
+    o2 = _mm_shuffle_ps(_mm_unpackhi_ps(b, r), _mm_unpackhi_ps(g, b), _MM_SHUFFLE(3, 2, 3, 0));
+}
+
+inline void deinterleave3(__m128 a, __m128 b, __m128 c, __m128 &r, __m128 &g, __m128 &bl)
+{
+    r  = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    g  = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    bl = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+// 16 bytes -> 4 x 4 int32 lanes
+inline void expand_u8(__m128i v, __m128i out[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+    out[0] = _mm_unpacklo_epi16(lo, zero);
+    out[1] = _mm_unpackhi_epi16(lo, zero);
+    out[2] = _mm_unpacklo_epi16(hi, zero);
+    out[3] = _mm_unpackhi_epi16(hi, zero);
+}
+
+inline __m128i narrow_u8(const __m128i in[4])
+{
+    return _mm_packus_epi16(_mm_packs_epi32(in[0], in[1]), _mm_packs_epi32(in[2], in[3]));
+}
+
+// 16 pixels of 3 channels as int32 lanes: ch[c][k] holds pixels 4k .. 4k+3
+inline void load_3ch_16(const PackJob &job, size_t i, __m128i ch[3][4])
+{
+    if (job.src_layout == TensorLayout::CHW)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            expand_u8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(job.src + source_channel(job, c) * job.count + i)), ch[c]);
+        }
+        return;
+    }
+
+    __m128i e[12];
+    const uint8_t *p = job.src + i * 3;
+    for (int k = 0; k < 3; k++)
+    {
+        expand_u8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k)), e + 4 * k);
+    }
+    for (int k = 0; k < 4; k++)
+    {
+        __m128 c0, c1, c2;
+        deinterleave3(_mm_castsi128_ps(e[3 * k]), _mm_castsi128_ps(e[3 * k + 1]), _mm_castsi128_ps(e[3 * k + 2]), c0, c1, c2);
+        ch[source_channel(job, 0)][k] = _mm_castps_si128(c0);
+        ch[1][k]                      = _mm_castps_si128(c1);
+        ch[source_channel(job, 2)][k] = _mm_castps_si128(c2);
+    }
+}
+
+size_t pack_u8_simd(const PackJob &job, uint8_t *dst, size_t begin, size_t end)
+{
+    size_t i = begin;
+    if (job.channels == 1)
+    {
+        memcpy(dst + begin, job.src + begin, end - begin);
+        return end;
+    }
+    if (job.channels != 3)
+    {
+        return begin;
+    }
+
+    for (; i + 16 <= end; i += 16)
+    {
+        __m128i ch[3][4];
+        load_3ch_16(job, i, ch);
+
+        if (job.dst_layout == TensorLayout::CHW)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + c * job.count + i), narrow_u8(ch[c]));
+            }
+            continue;
+        }
+
+        __m128i e[12];
+        for (int k = 0; k < 4; k++)
+        {
+            __m128 o0, o1, o2;
+            interleave3(_mm_castsi128_ps(ch[0][k]), _mm_castsi128_ps(ch[1][k]), _mm_castsi128_ps(ch[2][k]), o0, o1, o2);
+            e[3 * k]     = _mm_castps_si128(o0);
+            e[3 * k + 1] = _mm_castps_si128(o1);
+            e[3 * k + 2] = _mm_castps_si128(o2);
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3 + 16 * k), narrow_u8(e + 4 * k));
+        }
+    }
+    return i;
+}
+
+size_t pack_f32_simd(const PackJob &job, float *dst, size_t begin, size_t end)
+{
+    size_t i = begin;
+
+    if (job.channels == 1)
+    {
+        const __m128 scale = _mm_set1_ps(job.scale[0]);
+        const __m128 bias  = _mm_set1_ps(job.bias[0]);
+        for (; i + 16 <= end; i += 16)
+        {
+            __m128i v[4];
+            expand_u8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(job.src + i)), v);
+            for (int k = 0; k < 4; k++)
+            {
+                _mm_storeu_ps(dst + i + 4 * k, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(v[k]), scale), bias));
+            }
+        }
+        return i;
+    }
+    if (job.channels != 3)
+    {
+        return begin;
+    }
+
+    const __m128 scale[3] = {_mm_set1_ps(job.scale[0]), _mm_set1_ps(job.scale[1]), _mm_set1_ps(job.scale[2])};
+    const __m128 bias[3]  = {_mm_set1_ps(job.bias[0]),  _mm_set1_ps(job.bias[1]),  _mm_set1_ps(job.bias[2])};
+
+    for (; i + 16 <= end; i += 16)
+    {
+        __m128i ch[3][4];
+        load_3ch_16(job, i, ch);
+
+        for (int k = 0; k < 4; k++)
+        {
+            __m128 f[3];
+            for (int c = 0; c < 3; c++)
+            {
+                f[c] = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(ch[c][k]), scale[c]), bias[c]);
+            }
+
+            if (job.dst_layout == TensorLayout::CHW)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    _mm_storeu_ps(dst + c * job.count + i + 4 * k, f[c]);
+                }
+            }
+            else
+            {
+                __m128 o0, o1, o2;
+                interleave3(f[0], f[1], f[2], o0, o1, o2);
+                float *p = dst + (i + 4 * k) * 3;
+                _mm_storeu_ps(p, o0);
+                _mm_storeu_ps(p + 4, o1);
+                _mm_storeu_ps(p + 8, o2);
+            }
+        }
+    }
+    return i;
+}
+
+#elif defined(DEPTHAI_TENSOR_NEON)
+
+inline uint8x16x3_t load_3ch_16(const PackJob &job, size_t i)
+{
+    uint8x16x3_t v;
+    if (job.src_layout == TensorLayout::CHW)
+    {
+        v.val[0] = vld1q_u8(job.src + source_channel(job, 0) * job.count + i);
+        v.val[1] = vld1q_u8(job.src + job.count + i);
+        v.val[2] = vld1q_u8(job.src + source_channel(job, 2) * job.count + i);
+    }
+    else
+    {
+        v = vld3q_u8(job.src + i * 3);
+        if (job.swap_rb)
+        {
+            const uint8x16_t t = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = t;
+        }
+    }
+    return v;
+}
+
+inline void expand_f32(uint8x16_t v, float32x4_t out[4])
+{
+    const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+    const uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+    out[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo)));
+    out[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo)));
+    out[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi)));
+    out[3] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi)));
+}
+
+size_t pack_u8_simd(const PackJob &job, uint8_t *dst, size_t begin, size_t end)
+{
+    size_t i = begin;
+    if (job.channels == 1)
+    {
+        memcpy(dst + begin, job.src + begin, end - begin);
+        return end;
+    }
+    if (job.channels != 3)
+    {
+        return begin;
+    }
+
+    for (; i + 16 <= end; i += 16)
+    {
+        const uint8x16x3_t v = load_3ch_16(job, i);
+        if (job.dst_layout == TensorLayout::CHW)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                vst1q_u8(dst + c * job.count + i, v.val[c]);
+            }
+        }
+        else
+        {
+            vst3q_u8(dst + i * 3, v);
+        }
+    }
+    return i;
+}
+
+size_t pack_f32_simd(const PackJob &job, float *dst, size_t begin, size_t end)
+{
+    size_t i = begin;
+
+    if (job.channels == 1)
+    {
+        for (; i + 16 <= end; i += 16)
+        {
+            float32x4_t f[4];
+            expand_f32(vld1q_u8(job.src + i), f);
+            for (int k = 0; k < 4; k++)
+            {
+                vst1q_f32(dst + i + 4 * k, vmlaq_n_f32(vdupq_n_f32(job.bias[0]), f[k], job.scale[0]));
+            }
+        }
+        return i;
+    }
+    if (job.channels != 3)
+    {
+        return begin;
+    }
+
+    for (; i + 16 <= end; i += 16)
+    {
+        const uint8x16x3_t v = load_3ch_16(job, i);
+        float32x4_t f[3][4];
+        for (int c = 0; c < 3; c++)
+        {
+            expand_f32(v.val[c], f[c]);
+            for (int k = 0; k < 4; k++)
+            {
+                f[c][k] = vmlaq_n_f32(vdupq_n_f32(job.bias[c]), f[c][k], job.scale[c]);
+            }
+        }
+
+        for (int k = 0; k < 4; k++)
+        {
+            if (job.dst_layout == TensorLayout::CHW)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    vst1q_f32(dst + c * job.count + i + 4 * k, f[c][k]);
+                }
+            }
+            else
+            {
+                float32x4x3_t px;
+                px.val[0] = f[0][k];
+                px.val[1] = f[1][k];
+                px.val[2] = f[2][k];
+                vst3q_f32(dst + (i + 4 * k) * 3, px);
+            }
+        }
+    }
+    return i;
+}
+
+#else
+
+size_t pack_u8_simd(const PackJob &, uint8_t *, size_t begin, size_t) { return begin; }
+size_t pack_f32_simd(const PackJob &, float *, size_t begin, size_t) { return begin; }
+
+#endif
+
+PackJob make_job(const uint8_t *src, TensorLayout src_layout, TensorLayout dst_layout, int channels, int height, int width, bool swap_rb)
+{
+    PackJob job;
+    job.src        = src;
+    job.src_layout = src_layout;
+    job.dst_layout = dst_layout;
+    job.channels   = channels;
+    job.count      = (size_t) height * width;
+    job.swap_rb    = swap_rb;
+    for (int c = 0; c < 3; c++)
+    {
+        job.scale[c] = 1.f;
+        job.bias[c]  = 0.f;
+    }
+    return job;
+}
+
+} // namespace
+
+
+void pack_tensor_u8(
+    const uint8_t *src, TensorLayout src_layout,
+    uint8_t *dst, TensorLayout dst_layout,
+    int channels, int height, int width,
+    bool swap_rb
+)
+{
+    const PackJob job = make_job(src, src_layout, dst_layout, channels, height, width, swap_rb);
+    if (job.count == 0 || channels <= 0)
+    {
+        return;
+    }
+
+    parallel_for(0, (int) ((job.count + 15) / 16), [&](int block_begin, int block_end)
+    {
+        const size_t begin = (size_t) block_begin * 16;
+        const size_t end = std::min(job.count, (size_t) block_end * 16);
+        pack_u8_scalar(job, dst, pack_u8_simd(job, dst, begin, end), end);
+    }, c_pack_min_range / 16);
+}
+
+void pack_tensor_f32(
+    const uint8_t *src, TensorLayout src_layout,
+    float *dst, TensorLayout dst_layout,
+    int channels, int height, int width,
+    const float *mean,
+    const float *scale,
+    bool swap_rb
+)
+{
+    PackJob job = make_job(src, src_layout, dst_layout, channels, height, width, swap_rb);
+    if (job.count == 0 || channels <= 0)
+    {
+        return;
+    }
+
+    // per channel scale and bias, the SIMD paths keep their own copy in job
+    std::vector<float> scale_bias(2 * channels);
+    float *scales = scale_bias.data();
+    float *biases = scale_bias.data() + channels;
+    for (int c = 0; c < channels; c++)
+    {
+        scales[c] = scale ? scale[c] : 1.f;
+        biases[c] = -(mean ? mean[c] : 0.f) * scales[c];
+        if (c < 3)
+        {
+            job.scale[c] = scales[c];
+            job.bias[c]  = biases[c];
+        }
+    }
+
+    parallel_for(0, (int) ((job.count + 15) / 16), [&](int block_begin, int block_end)
+    {
+        const size_t begin = (size_t) block_begin * 16;
+        const size_t end = std::min(job.count, (size_t) block_end * 16);
+        pack_f32_scalar(job, scales, biases, dst, pack_f32_simd(job, dst, begin, end), end);
+    }, c_pack_min_range / 16);
+}
@@ -0,0 +1,260 @@
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "thread_settings.hpp"
+#include "logger.hpp"
+
+
+static constexpr int c_thread_class_count = 3;
+static constexpr size_t c_max_thread_name = 15;   // pthread limit without '\0'
+
+static const char *c_default_thread_names[c_thread_class_count] = {
+    "dai_wdog",
+    "dai_rx",
+    "dai_pp",
+};
+
+
+namespace
+{
+
+struct ThreadRecord
+{
+    std::string name;
+    ThreadClass thread_class;
+#ifdef __linux__
+    bool        has_clock = false;
+    clockid_t   clock;
+#endif
+};
+
+struct ThreadRegistry
+{
+    std::mutex mutex;
+    ThreadSettings settings[c_thread_class_count];
+    std::atomic<uint32_t> generation{1};
+    std::set<const ThreadRecord*> threads;
+};
+
+// never destroyed, reader threads may outlive static destructors
+ThreadRegistry& registry()
+{
+    static ThreadRegistry *instance = new ThreadRegistry();
+    return *instance;
+}
+
+// Per thread state, unregistered when the thread exits
+struct LocalThread
+{
+    uint32_t     generation = 0;
+    int          thread_class = -1;
+    bool         registered = false;
+    bool         affinity_set = false;
+    bool         fifo_set = false;
+    bool         nice_set = false;
+    ThreadRecord record;
+
+    ~LocalThread()
+    {
+        if (registered)
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            registry().threads.erase(&record);
+        }
+    }
+};
+
+thread_local LocalThread t_local_thread;
+
+
+void set_affinity(LocalThread &local, const ThreadSettings &settings)
+{
+    if (settings.cpu_affinity.empty() && !local.affinity_set)
+    {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (settings.cpu_affinity.empty())
+    {
+        // back to all CPUs, the kernel limits the mask to the allowed ones
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    for (int cpu : settings.cpu_affinity)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0)
+    {
+        log_warn("thread %s: can't set cpu affinity: %s", local.record.name.c_str(), strerror(error));
+    }
+    local.affinity_set = !settings.cpu_affinity.empty();
+#else
+    log_warn("thread %s: cpu affinity is not supported on this platform", local.record.name.c_str());
+#endif
+}
+
+void set_priority(LocalThread &local, const ThreadSettings &settings)
+{
+#ifndef _WIN32
+    if (settings.fifo_priority > 0 || local.fifo_set)
+    {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = settings.fifo_priority > 0 ? std::min(settings.fifo_priority, 99) : 0;
+        const int error = pthread_setschedparam(pthread_self(), settings.fifo_priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param);
+        if (error != 0)
+        {
+            // EPERM without CAP_SYS_NICE / RLIMIT_RTPRIO
+            log_warn("thread %s: can't set SCHED_FIFO priority %d: %s",
+                     local.record.name.c_str(), settings.fifo_priority, strerror(error));
+        }
+        else
+        {
+            local.fifo_set = settings.fifo_priority > 0;
+        }
+    }
+
+    if (settings.fifo_priority <= 0 && (settings.nice != 0 || local.nice_set))
+    {
+#ifdef __linux__
+        // per thread on Linux, the tid is the "process" of setpriority
+        if (setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), settings.nice) != 0)
+        {
+            log_warn("thread %s: can't set nice %d: %s", local.record.name.c_str(), settings.nice, strerror(errno));
+        }
+        local.nice_set = settings.nice != 0;
+#else
+        log_warn("thread %s: per thread nice is not supported on this platform", local.record.name.c_str());
+#endif
+    }
+#else
+    (void) local;
+    (void) settings;
+#endif
+}
+
+void set_name(const std::string &name)
+{
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), name.c_str());
+#elif defined(__APPLE__)
+    pthread_setname_np(name.c_str());
+#else
+    (void) name;
+#endif
+}
+
+} // namespace
+
+
+void set_thread_settings(ThreadClass thread_class, const ThreadSettings &settings)
+{
+    ThreadRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.settings[(int) thread_class] = settings;
+    reg.generation.fetch_add(1, std::memory_order_release);
+}
+
+void apply_thread_settings(ThreadClass thread_class, const std::string &name_suffix)
+{
+    LocalThread &local = t_local_thread;
+    ThreadRegistry &reg = registry();
+
+    const uint32_t generation = reg.generation.load(std::memory_order_acquire);
+    const int effective_class = std::max(local.thread_class, (int) thread_class);
+    if (effective_class == local.thread_class && generation == local.generation)
+    {
+        return;
+    }
+
+    ThreadSettings settings;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        settings = reg.settings[effective_class];
+    }
+
+    std::string name = settings.name.empty() ? c_default_thread_names[effective_class] : settings.name;
+    if (!name_suffix.empty())
+    {
+        name += "_" + name_suffix;
+    }
+    if (name.size() > c_max_thread_name)
+    {
+        name.resize(c_max_thread_name);
+    }
+
+    local.generation = generation;
+    local.thread_class = effective_class;
+    {
+        // the record is read by get_thread_stats()
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        local.record.name = name;
+        local.record.thread_class = (ThreadClass) effective_class;
+        if (!local.registered)
+        {
+#ifdef __linux__
+            local.record.has_clock = pthread_getcpuclockid(pthread_self(), &local.record.clock) == 0;
+#endif
+            reg.threads.insert(&local.record);
+            local.registered = true;
+        }
+    }
+
+    set_name(name);
+    set_affinity(local, settings);
+    set_priority(local, settings);
+}
+
+std::vector<ThreadStats> get_thread_stats()
+{
+    std::vector<ThreadStats> result;
+
+    // threads unregister under the lock before they exit, their clocks are valid here
+    ThreadRegistry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const ThreadRecord *record : reg.threads)
+    {
+        ThreadStats stats;
+        stats.name = record->name;
+        stats.thread_class = record->thread_class;
+        stats.cpu_time_s = NAN;
+#ifdef __linux__
+        timespec ts;
+        if (record->has_clock && clock_gettime(record->clock, &ts) == 0)
+        {
+            stats.cpu_time_s = ts.tv_sec + ts.tv_nsec * 1e-9;
+        }
+#endif
+        result.push_back(stats);
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const ThreadStats &a, const ThreadStats &b) { return a.name < b.name; });
+    return result;
+}